@@ -0,0 +1,46 @@
+/*
+Title: Instanced Rendering
+File Name: benchmark.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Runs a function a number of times, and prints the fastest and the median time in milliseconds.
+// The fastest run is closest to what the code can do, the median shows how much the rest wander off.
+template <typename F>
+void Time(const std::string& name, unsigned int runs, F function)
+{
+    std::vector<double> times;
+    for (unsigned int run = 0; run < runs; run++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        times.push_back(time.count());
+    }
+    std::sort(times.begin(), times.end());
+    std::cout << name << ": best " << times[0] << " ms, median " << times[times.size() / 2] << " ms" << std::endl;
+}
@@ -0,0 +1,121 @@
+/*
+Title: Instanced Rendering
+File Name: jobSystemBenchmark.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Compares the job system with std::async and OpenMP on the demo's per frame work: turning every transform a little,
+// then rebuilding all of their world matrices. Runs it for 1000 up to a million transforms.
+// OpenMP is only timed when the compiler was given it. Run a release build.
+
+#include "benchmark.h"
+#include "../header/jobSystem.h"
+#include "../header/transformSystem.h"
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const unsigned int RUNS = 20;
+// Transforms per job. A multiple of four, so simd groups stay whole.
+static const unsigned int BATCH_SIZE = 1024;
+
+static float Random(float range)
+{
+    return (rand() / (float)RAND_MAX - .5f) * range;
+}
+
+// The work for transforms [first, first + count).
+static void Update(TransformSystem& system, std::vector<glm::mat4>& output, unsigned int first, unsigned int count)
+{
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        system.GetHandle(i).RotateY(.001f);
+    }
+    system.BuildMatrices(output.data(), first, count);
+}
+
+int main(int argc, char **argv)
+{
+    srand(1);
+    JobSystem jobs;
+    unsigned int threadCount = jobs.GetThreadCount();
+    std::cout << "Using " << threadCount << " threads, " << RUNS << " runs each" << std::endl;
+
+    for (unsigned int transformCount = 1000; transformCount <= 1000000; transformCount *= 10)
+    {
+        TransformSystem system;
+        for (unsigned int i = 0; i < transformCount; i++)
+        {
+            system.Add(glm::vec3(Random(100), Random(100), Random(100)), glm::vec3(Random(20), Random(20), Random(20)), Random(4) + 2.5f);
+        }
+        std::vector<glm::mat4> output(transformCount);
+        std::string size = std::to_string(transformCount) + " transforms, ";
+
+        Time(size + "one thread", RUNS, [&]()
+        {
+            Update(system, output, 0, transformCount);
+        });
+
+        Time(size + "JobSystem::ParallelFor", RUNS, [&]()
+        {
+            jobs.ParallelFor(transformCount, BATCH_SIZE, [&](unsigned int first, unsigned int count)
+            {
+                Update(system, output, first, count);
+            });
+        });
+
+        // std::async can't steal work, so give each thread one even (whole group) share.
+        Time(size + "std::async", RUNS, [&]()
+        {
+            unsigned int share = (transformCount / threadCount + 3) & ~3u;
+            std::vector<std::future<void>> futures;
+            for (unsigned int first = 0; first < transformCount; first += share)
+            {
+                unsigned int count = transformCount - first < share ? transformCount - first : share;
+                futures.push_back(std::async(std::launch::async, [&system, &output, first, count]()
+                {
+                    Update(system, output, first, count);
+                }));
+            }
+            for (unsigned int i = 0; i < futures.size(); i++)
+            {
+                futures[i].wait();
+            }
+        });
+
+#ifdef _OPENMP
+        Time(size + "OpenMP", RUNS, [&]()
+        {
+            int batchCount = (int)((transformCount + BATCH_SIZE - 1) / BATCH_SIZE);
+            #pragma omp parallel for schedule(dynamic)
+            for (int batch = 0; batch < batchCount; batch++)
+            {
+                unsigned int first = batch * BATCH_SIZE;
+                unsigned int count = transformCount - first < BATCH_SIZE ? transformCount - first : BATCH_SIZE;
+                Update(system, output, first, count);
+            }
+        });
+#endif
+    }
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+Title: Instanced Rendering
+File Name: transformBenchmark.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Shows what a transform costs per frame, in nanoseconds per transform:
+//  - Transform3D as it used to be, with euler angles and five full matrices built (and multiplied) for the world
+//    matrix, then all over again for the inverse, next to Transform3D as it is now, with a cached quaternion and the
+//    inverse taken straight from the world matrix.
+//  - TransformSystem building one matrix at a time with plain floats, next to four at a time with simd.
+// Every transform turns a little each run, so nothing comes out of a cache. Run a release build.
+
+#include "benchmark.h"
+#include "../header/transform3d.h"
+#include "../header/transformSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static const unsigned int TRANSFORM_COUNT = 100000;
+static const unsigned int RUNS = 20;
+
+// The old Transform3D math, kept here to compare against.
+struct EulerTransform
+{
+    float m_scale;
+    glm::vec3 m_rotation;
+    glm::vec3 m_position;
+
+    glm::mat4 GetMatrix()
+    {
+        glm::mat4 s = glm::mat4(
+            m_scale, 0, 0, 0,
+            0, m_scale, 0, 0,
+            0, 0, m_scale, 0,
+            0, 0, 0, 1);
+        glm::mat4 rx = glm::mat4(
+            1, 0, 0, 0,
+            0, cos(m_rotation.x), sin(m_rotation.x), 0,
+            0, -sin(m_rotation.x), cos(m_rotation.x), 0,
+            0, 0, 0, 1);
+        glm::mat4 ry = glm::mat4(
+            cos(m_rotation.y), 0, sin(m_rotation.y), 0,
+            0, 1, 0, 0,
+            -sin(m_rotation.y), 0, cos(m_rotation.y), 0,
+            0, 0, 0, 1);
+        glm::mat4 rz = glm::mat4(
+            cos(m_rotation.z), sin(m_rotation.z), 0, 0,
+            -sin(m_rotation.z), cos(m_rotation.z), 0, 0,
+            0, 0, 1, 0,
+            0, 0, 0, 1);
+        glm::mat4 t = glm::mat4(
+            1, 0, 0, 0,
+            0, 1, 0, 0,
+            0, 0, 1, 0,
+            m_position.x, m_position.y, m_position.z, 1);
+        return t * (ry * rx * rz) * s;
+    }
+
+    glm::mat4 GetInverseMatrix()
+    {
+        glm::mat4 s = glm::mat4(
+            1.f / m_scale, 0, 0, 0,
+            0, 1.f / m_scale, 0, 0,
+            0, 0, 1.f / m_scale, 0,
+            0, 0, 0, 1);
+        glm::mat4 rx = glm::mat4(
+            1, 0, 0, 0,
+            0, cos(m_rotation.x), -sin(m_rotation.x), 0,
+            0, sin(m_rotation.x), cos(m_rotation.x), 0,
+            0, 0, 0, 1);
+        glm::mat4 ry = glm::mat4(
+            cos(m_rotation.y), 0, -sin(m_rotation.y), 0,
+            0, 1, 0, 0,
+            sin(m_rotation.y), 0, cos(m_rotation.y), 0,
+            0, 0, 0, 1);
+        glm::mat4 rz = glm::mat4(
+            cos(m_rotation.z), -sin(m_rotation.z), 0, 0,
+            sin(m_rotation.z), cos(m_rotation.z), 0, 0,
+            0, 0, 1, 0,
+            0, 0, 0, 1);
+        glm::mat4 t = glm::mat4(
+            1, 0, 0, 0,
+            0, 1, 0, 0,
+            0, 0, 1, 0,
+            -m_position.x, -m_position.y, -m_position.z, 1);
+        return s * (rz * rx * ry) * t;
+    }
+};
+
+static float Random(float range)
+{
+    return (rand() / (float)RAND_MAX - .5f) * range;
+}
+
+static float Difference(const glm::mat4& a, const glm::mat4& b)
+{
+    float difference = 0;
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            difference = std::max(difference, std::fabs(a[column][row] - b[column][row]));
+        }
+    }
+    return difference;
+}
+
+int main(int argc, char **argv)
+{
+    srand(1);
+    std::vector<EulerTransform> eulers(TRANSFORM_COUNT);
+    std::vector<Transform3D> transforms(TRANSFORM_COUNT);
+    TransformSystem system;
+    for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+    {
+        glm::vec3 position(Random(100), Random(100), Random(100));
+        glm::vec3 rotation(Random(6), Random(6), Random(6));
+        float scale = Random(4) + 2.5f;
+        eulers[i].m_position = position;
+        eulers[i].m_rotation = rotation;
+        eulers[i].m_scale = scale;
+        transforms[i].SetPosition(position);
+        transforms[i].SetRotation(rotation);
+        transforms[i].SetScale(scale);
+        system.Add(position, rotation, scale);
+    }
+
+    // All of them should agree.
+    float maxMatrix = 0;
+    float maxInverse = 0;
+    float maxSystem = 0;
+    for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+    {
+        maxMatrix = std::max(maxMatrix, Difference(eulers[i].GetMatrix(), transforms[i].GetMatrix()));
+        maxInverse = std::max(maxInverse, Difference(eulers[i].GetInverseMatrix(), transforms[i].GetInverseMatrix()));
+        maxSystem = std::max(maxSystem, Difference(system.GetMatrix(i), transforms[i].GetMatrix()));
+    }
+    std::cout << "Largest difference from the euler math: " << maxMatrix << " (matrix), " << maxInverse << " (inverse)" << std::endl;
+    std::cout << "Largest difference between TransformSystem and Transform3D: " << maxSystem << std::endl;
+
+    std::vector<glm::mat4> matrices(TRANSFORM_COUNT);
+    std::vector<glm::mat4> inverses(TRANSFORM_COUNT);
+    std::cout << "Times are for " << TRANSFORM_COUNT << " transforms, divide by " << TRANSFORM_COUNT / 1000
+        << " for nanoseconds per transform." << std::endl;
+
+    std::cout << "World and inverse matrix:" << std::endl;
+    Time("  euler angles", RUNS, [&]()
+    {
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+        {
+            eulers[i].m_rotation.y += .001f;
+            matrices[i] = eulers[i].GetMatrix();
+            inverses[i] = eulers[i].GetInverseMatrix();
+        }
+    });
+    Time("  Transform3D", RUNS, [&]()
+    {
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+        {
+            transforms[i].RotateY(.001f);
+            matrices[i] = transforms[i].GetMatrix();
+            inverses[i] = transforms[i].GetInverseMatrix();
+        }
+    });
+
+    std::cout << "World matrix only:" << std::endl;
+    Time("  euler angles", RUNS, [&]()
+    {
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+        {
+            eulers[i].m_rotation.y += .001f;
+            matrices[i] = eulers[i].GetMatrix();
+        }
+    });
+    Time("  Transform3D", RUNS, [&]()
+    {
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+        {
+            transforms[i].RotateY(.001f);
+            matrices[i] = transforms[i].GetMatrix();
+        }
+    });
+    Time("  TransformSystem, scalar", RUNS, [&]()
+    {
+        system.RotateAllY(.001f);
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+        {
+            matrices[i] = system.GetMatrix(i);
+        }
+    });
+    Time("  TransformSystem, simd", RUNS, [&]()
+    {
+        system.RotateAllY(.001f);
+        system.BuildMatrices(matrices.data(), 0, TRANSFORM_COUNT);
+    });
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+Title: Instanced Rendering
+File Name: transformSystemBenchmark.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Times building world matrices for 100k transforms with TransformSystem (simd on one thread, simd split across the
+// job system, and one at a time without simd), next to the same transforms as Transform3Ds.
+// Matrices are checked against Transform3D::GetMatrix too.
+// Run a release build: the numbers mean nothing without optimizations.
+
+#include "benchmark.h"
+#include "../header/jobSystem.h"
+#include "../header/transformSystem.h"
+#include "../header/transform3d.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static const unsigned int TRANSFORM_COUNT = 100000;
+static const unsigned int RUNS = 50;
+// Transforms per job when the work is split across threads. Keep it a multiple of four, so groups stay whole.
+static const unsigned int BATCH_SIZE = 4096;
+
+static float Random(float range)
+{
+    return (rand() / (float)RAND_MAX - .5f) * range;
+}
+
+int main(int argc, char **argv)
+{
+    srand(1);
+    TransformSystem system;
+    std::vector<Transform3D> transforms(TRANSFORM_COUNT);
+    for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+    {
+        glm::vec3 position(Random(100), Random(100), Random(100));
+        glm::vec3 rotation(Random(20), Random(20), Random(20));
+        float scale = Random(4) + 2.5f;
+        system.Add(position, rotation, scale);
+        transforms[i].SetPosition(position);
+        transforms[i].SetRotation(rotation);
+        transforms[i].SetScale(scale);
+    }
+
+    // Both ways should give the same matrices.
+    std::vector<glm::mat4> output(TRANSFORM_COUNT);
+    system.BuildMatrices(output.data(), 0, TRANSFORM_COUNT);
+    float maxError = 0;
+    for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+    {
+        glm::mat4 expected = transforms[i].GetMatrix();
+        for (int column = 0; column < 4; column++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                maxError = std::max(maxError, std::fabs(output[i][column][row] - expected[column][row]));
+            }
+        }
+    }
+    std::cout << "Largest difference from Transform3D: " << maxError << std::endl;
+
+    std::cout << "Building " << TRANSFORM_COUNT << " world matrices, " << RUNS << " runs each:" << std::endl;
+    Time("TransformSystem::BuildMatrices", RUNS, [&]()
+    {
+        system.BuildMatrices(output.data(), 0, TRANSFORM_COUNT);
+    });
+    JobSystem jobs;
+    Time("TransformSystem::BuildMatrices across " + std::to_string(jobs.GetThreadCount()) + " threads", RUNS, [&]()
+    {
+        jobs.ParallelFor(TRANSFORM_COUNT, BATCH_SIZE, [&](unsigned int first, unsigned int count)
+        {
+            system.BuildMatrices(output.data(), first, count);
+        });
+    });
+    Time("TransformSystem::GetMatrix, one at a time", RUNS, [&]()
+    {
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++) output[i] = system.GetMatrix(i);
+    });
+    Time("Transform3D::GetMatrix", RUNS, [&]()
+    {
+        // Touch each transform so the matrix is really rebuilt, like a moving object would.
+        for (unsigned int i = 0; i < TRANSFORM_COUNT; i++)
+        {
+            transforms[i].RotateY(0);
+            output[i] = transforms[i].GetMatrix();
+        }
+    });
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+# Precompiles one shader, as part of the shaders target. Run with cmake -P:
+#   -DINPUT=<source .glsl>  -DOUTPUT=<minified .glsl to write>  -DSTAGE=<vert|frag>
+#   -DVALIDATOR=<glslangValidator, or empty to skip checking>  -DSPIRV_OUTPUT=<.spv to write, or empty>
+#
+# Every combination of the shader's "#pragma keywords" (see shaderVariants.h) is checked with glslangValidator,
+# so a mistake in any variant fails the build instead of showing up at runtime.
+# Then comments, indentation and blank lines are stripped, and the rest is written out for the program to load.
+# None of this needs a gpu.
+
+file(READ "${INPUT}" source)
+
+# Find the keywords this shader can be built with.
+set(keywords "")
+string(REGEX MATCHALL "#pragma[ \t]+keywords[^\n]*" keywordLines "${source}")
+foreach(keywordLine ${keywordLines})
+    string(REGEX REPLACE "#pragma[ \t]+keywords" "" keywordLine "${keywordLine}")
+    string(REGEX MATCHALL "[A-Za-z_][A-Za-z0-9_]*" lineKeywords "${keywordLine}")
+    list(APPEND keywords ${lineKeywords})
+endforeach()
+list(LENGTH keywords keywordCount)
+
+if(VALIDATOR)
+    # Count through every combination of keywords, using the bits of variant to say which are defined.
+    math(EXPR variantCount "1 << ${keywordCount}")
+    math(EXPR lastVariant "${variantCount} - 1")
+    foreach(variant RANGE ${lastVariant})
+        set(defines "")
+        set(index 0)
+        foreach(keyword ${keywords})
+            math(EXPR bit "(${variant} >> ${index}) & 1")
+            if(bit)
+                list(APPEND defines "-D${keyword}")
+            endif()
+            math(EXPR index "${index} + 1")
+        endforeach()
+
+        execute_process(
+            COMMAND "${VALIDATOR}" -S ${STAGE} ${defines} "${INPUT}"
+            RESULT_VARIABLE result
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE output
+        )
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${INPUT} failed to compile with [${defines}]:\n${output}")
+        endif()
+    endforeach()
+
+    # SPIR-V for GL_ARB_gl_spirv, built with no keywords defined.
+    # Locations and bindings are filled in automatically, since the sources don't give them.
+    if(SPIRV_OUTPUT)
+        execute_process(
+            COMMAND "${VALIDATOR}" -G -S ${STAGE} --auto-map-locations --auto-map-bindings -o "${SPIRV_OUTPUT}" "${INPUT}"
+            RESULT_VARIABLE result
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE output
+        )
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${INPUT} failed to compile to SPIR-V:\n${output}")
+        endif()
+    endif()
+endif()
+
+# Strip block comments, then go through line by line.
+# Semicolons and brackets would confuse cmake's lists, so they're swapped for placeholders until the end.
+string(REGEX REPLACE "/\\*([^*]|\\*+[^*/])*\\*+/" "" source "${source}")
+string(REPLACE ";" "@SEMICOLON@" source "${source}")
+string(REPLACE "[" "@OPEN@" source "${source}")
+string(REPLACE "]" "@CLOSE@" source "${source}")
+string(REPLACE "\r" "" source "${source}")
+string(REPLACE "\n" ";" lines "${source}")
+
+set(minified "")
+foreach(line IN LISTS lines)
+    string(REGEX REPLACE "//.*$" "" line "${line}")
+    string(STRIP "${line}" line)
+    if(NOT line STREQUAL "")
+        # Preprocessor lines have to stay on their own line, but nothing else needs a line break.
+        if(line MATCHES "^#")
+            set(minified "${minified}\n${line}\n")
+        else()
+            set(minified "${minified}${line} ")
+        endif()
+    endif()
+endforeach()
+
+string(REPLACE "@SEMICOLON@" ";" minified "${minified}")
+string(REPLACE "@OPEN@" "[" minified "${minified}")
+string(REPLACE "@CLOSE@" "]" minified "${minified}")
+string(REPLACE "\n\n" "\n" minified "${minified}")
+string(STRIP "${minified}" minified)
+file(WRITE "${OUTPUT}" "${minified}\n")
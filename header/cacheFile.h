@@ -0,0 +1,41 @@
+/*
+Title: Instanced Rendering
+File Name: cacheFile.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// The pieces shared by everything that keeps files on disk between runs (ProgramCache, TextureCache),
+// and the hashing used to name those files.
+
+// 64 bit FNV-1a. To hash several things into one key, pass each result back in as the hash for the next.
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET);
+// Hashes a zero terminated string (null counts as empty), then a marker so "ab" + "c" doesn't hash the same as "a" + "bc".
+uint64_t HashString(const char* string, uint64_t hash = FNV_OFFSET);
+
+// The file in directory named after the key, in hex, plus the extension (e.g. ".bin").
+std::string GetCacheFilePath(const std::string& directory, uint64_t key, const char* extension);
+// Makes the directory if it isn't there yet.
+void MakeCacheDirectory(const std::string& directory);
@@ -0,0 +1,220 @@
+/*
+Title: Instanced Rendering
+File Name: commandBuffer.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+// Commands only hold on to these, so the recording side doesn't need to know anything about them.
+class Material;
+class Mesh;
+class InstanceBuffer;
+
+// Hands out memory by bumping an offset, and frees all of it at once with Reset.
+// Memory comes in chunks, and full chunks are kept, so after the first few frames nothing gets allocated.
+// Not thread safe: every thread records into its own allocator.
+class LinearAllocator
+{
+private:
+    static const unsigned int CHUNK_SIZE = 64 * 1024;
+
+    struct Chunk
+    {
+        char* m_memory;
+        unsigned int m_size;
+        unsigned int m_used;
+    };
+
+    std::vector<Chunk> m_chunks;
+    // The chunk being allocated from.
+    unsigned int m_current;
+
+public:
+    LinearAllocator();
+    ~LinearAllocator();
+
+    // Returns size bytes, aligned to 16. Everything handed out stays put until Reset.
+    void* Allocate(unsigned int size);
+    // Forgets everything allocated, but keeps the memory for next time.
+    void Reset();
+
+    // For walking back over what was allocated, in order.
+    unsigned int GetChunkCount();
+    char* GetChunk(unsigned int chunk);
+    unsigned int GetChunkUsed(unsigned int chunk);
+};
+
+class CommandBackend;
+
+// A list of draw commands that any thread can record, and the GL thread replays later.
+// Opengl calls all have to come from the thread that owns the context, but working out what to draw doesn't,
+// so each worker records into its own command buffer, and the GL thread plays them back one after another.
+// Commands are packed one after another in a linear allocator, and anything they point at has to live until the replay.
+class CommandBuffer
+{
+public:
+    enum CommandType
+    {
+        BIND_MATERIAL,
+        SET_INSTANCES,
+        DRAW_MESH,
+        DRAW_INSTANCED,
+        DRAW_INSTANCE_BUFFER
+    };
+
+    // Every command starts with this. The size includes the header, so the next command is m_size bytes further on.
+    struct CommandHeader
+    {
+        unsigned int m_type;
+        unsigned int m_size;
+    };
+
+private:
+    struct BindMaterialCommand
+    {
+        CommandHeader m_header;
+        Material* m_material;
+    };
+
+    // The matrices are copied in right after this.
+    struct SetInstancesCommand
+    {
+        CommandHeader m_header;
+        unsigned int m_count;
+    };
+
+    struct DrawCommand
+    {
+        CommandHeader m_header;
+        Mesh* m_mesh;
+        InstanceBuffer* m_instances;
+    };
+
+    LinearAllocator m_allocator;
+    unsigned int m_commandCount;
+
+    void* AddCommand(CommandType type, unsigned int size);
+
+public:
+    CommandBuffer();
+
+    // Uses a material for the draws after this.
+    void BindMaterial(Material* material);
+    // Sets the instance matrices for the DrawInstanced calls after this. The matrices are copied.
+    void SetInstances(const glm::mat4* matrices, unsigned int count);
+    void SetInstances(const std::vector<glm::mat4>& matrices);
+    // Draws a mesh once.
+    void DrawMesh(Mesh* mesh);
+    // Draws a mesh once for each of the last instances set.
+    void DrawInstanced(Mesh* mesh);
+    // Draws a mesh once for every slot in an instance buffer.
+    void DrawInstanced(Mesh* mesh, InstanceBuffer* instances);
+
+    // Empties the buffer, ready to record the next frame.
+    void Reset();
+    unsigned int GetCommandCount();
+
+    // Sends every command to a backend, in the order they were recorded.
+    // Instances set by a buffer replayed before this one don't carry over: each buffer has to set its own.
+    void Replay(CommandBackend& backend);
+};
+
+// Receives replayed commands, checks that they make sense, and counts them.
+// What actually happens for each command is up to the backend deriving from this: NullCommandBackend does nothing,
+// and GLCommandBackend draws with opengl.
+// Instanced draws of the same mesh with the same material, one after another, are merged into a single draw:
+// their matrices are collected, and only drawn once something else comes along (or Flush is called).
+// So buffers recorded by many threads, each drawing its share of the same thing, still come out as one draw.
+class CommandBackend
+{
+private:
+    Material* m_material;
+    // False while the current material can't be drawn with yet, so its draws are dropped.
+    bool m_materialReady;
+    const glm::mat4* m_instances;
+    unsigned int m_instanceCount;
+    bool m_instancesSet;
+
+    // Instanced draws waiting to be merged.
+    Mesh* m_pendingMesh;
+    std::vector<glm::mat4> m_pendingInstances;
+
+    unsigned int m_commandCount;
+    unsigned int m_drawCount;
+    unsigned int m_materialChanges;
+    unsigned int m_errorCount;
+
+    void Error(const char* message);
+
+protected:
+    // What the backend does for each command, once it's been checked.
+    // Returns whether the material can be drawn with.
+    virtual bool OnBindMaterial(Material* material) = 0;
+    virtual void OnDrawMesh(Mesh* mesh) = 0;
+    virtual void OnDrawInstanced(Mesh* mesh, const glm::mat4* matrices, unsigned int count) = 0;
+    virtual void OnDrawInstanced(Mesh* mesh, InstanceBuffer* instances) = 0;
+
+public:
+    CommandBackend();
+    virtual ~CommandBackend();
+
+    // Clears the counts and forgets the current material, instances and anything waiting to be drawn.
+    void Reset();
+    // Tells the backend a material is already bound (by someone else), so commands binding it again are skipped.
+    void SetBoundMaterial(Material* material, bool ready);
+    // Forgets the instances set by the last buffer, which point into its memory. Replay calls this first.
+    // The material and anything waiting to be merged are kept, so draws still merge across buffers.
+    void BeginBuffer();
+
+    // Each of these returns false if the command is broken (which gets printed and counted).
+    bool BindMaterial(Material* material);
+    bool SetInstances(const glm::mat4* matrices, unsigned int count);
+    bool DrawMesh(Mesh* mesh);
+    bool DrawInstanced(Mesh* mesh);
+    bool DrawInstanced(Mesh* mesh, InstanceBuffer* instances);
+    // Called for commands that can't be read.
+    void BadCommand(unsigned int type);
+    // Draws whatever instanced draws are waiting to be merged. Call this after replaying the last buffer.
+    void Flush();
+
+    // The material the commands left bound, and whether it can be drawn with.
+    Material* GetMaterial();
+    bool IsMaterialReady();
+
+    unsigned int GetCommandCount();
+    // Draws actually issued, after merging.
+    unsigned int GetDrawCount();
+    unsigned int GetMaterialChanges();
+    unsigned int GetErrorCount();
+};
+
+// Checks and counts replayed commands, but doesn't draw anything.
+// That makes it handy for trying out recording code without a gpu.
+class NullCommandBackend : public CommandBackend
+{
+protected:
+    virtual bool OnBindMaterial(Material* material);
+    virtual void OnDrawMesh(Mesh* mesh);
+    virtual void OnDrawInstanced(Mesh* mesh, const glm::mat4* matrices, unsigned int count);
+    virtual void OnDrawInstanced(Mesh* mesh, InstanceBuffer* instances);
+};
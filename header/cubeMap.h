@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 #include "FreeImage.h"
+#include "../header/textureCache.h"
 #include <iostream>
 #include <vector>
 
@@ -37,9 +38,13 @@ private:
 
 public:
     CubeMap(std::vector<char*> filePaths);
+    // A cube map with 1x1 faces of one color, for streaming into later. (see TextureStreamer)
+    CubeMap(unsigned char red, unsigned char green, unsigned char blue);
     ~CubeMap();
     void IncRefCount();
     void DecRefCount();
     GLuint GetGLCubeMap();
+    // Replaces the OpenGL cube map with another one, deleting the old one. (see Texture::SetGLTexture)
+    void SetGLCubeMap(GLuint cubeMap);
 
 };
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+Title: Instanced Rendering
+File Name: frameUniforms.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+
+// One point light, laid out the way std140 lays out the matching glsl struct.
+struct PointLight
+{
+    // xyz is the position, w is the range.
+    glm::vec4 m_position;
+    glm::vec4 m_color;
+    // Quadratic, linear and constant falloff are x, y and z, with distance measured in ranges. w is unused.
+    glm::vec4 m_attenuation;
+};
+
+// Everything shaders need to know about the current frame.
+// This has to match the FrameUniforms block in the shaders byte for byte, using std140 layout rules.
+struct FrameUniformData
+{
+    static const int MAX_LIGHTS = 4;
+
+    glm::mat4 m_view;
+    glm::mat4 m_projection;
+    glm::mat4 m_viewProjection;
+    // Projection with only the rotation of the view, for the skybox.
+    glm::mat4 m_skyViewProjection;
+    // A float can sit in the last 4 bytes of a vec3 in std140.
+    glm::vec3 m_cameraPosition;
+    float m_time;
+    glm::vec4 m_ambientLight;
+    int m_lightCount;
+    // The light array starts on the next multiple of 16 bytes.
+    int m_padding[3];
+    PointLight m_lights[MAX_LIGHTS];
+};
+
+// Holds the per frame uniform block, shared by every shader program.
+// Instead of each material setting its own copy of the camera and lights, they're written here once per frame
+// and bound to one binding point, which every program's FrameUniforms block is hooked up to when it links.
+// The buffer is mapped once and kept mapped. It holds a few frames of data, and each frame writes to the next one,
+// with a fence making sure the gpu is done reading a frame's data before it gets written over.
+class FrameUniforms
+{
+public:
+    // The uniform buffer binding point the block is attached to.
+    static const GLuint BINDING = 0;
+    // The name of the block in the shaders.
+    static const char* BLOCK_NAME;
+
+private:
+    // How many frames can be in flight at once.
+    static const unsigned int FRAMES = 3;
+
+    GLuint m_buffer;
+    char* m_mappedData;
+    // Size of each frame's data, rounded up to the required alignment.
+    GLsizeiptr m_frameSize;
+    unsigned int m_frame;
+    GLsync m_fences[FRAMES];
+
+    FrameUniformData m_data;
+
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    // Fill this in each frame before calling Upload.
+    FrameUniformData& GetData();
+
+    // Copies the data into this frame's part of the buffer, and binds it. Call once per frame, before drawing.
+    void Upload();
+    // Call after the frame's draw calls, so the gpu can tell us when it's done with this frame's data.
+    void EndFrame();
+};
@@ -0,0 +1,36 @@
+/*
+Title: Instanced Rendering
+File Name: glCommandBackend.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "../header/commandBuffer.h"
+
+// Replays commands with opengl. Only use this on the thread that owns the context.
+// It lives apart from CommandBuffer, so recording (and testing it) doesn't pull in anything that draws.
+class GLCommandBackend : public CommandBackend
+{
+protected:
+    virtual bool OnBindMaterial(Material* material);
+    virtual void OnDrawMesh(Mesh* mesh);
+    virtual void OnDrawInstanced(Mesh* mesh, const glm::mat4* matrices, unsigned int count);
+    virtual void OnDrawInstanced(Mesh* mesh, InstanceBuffer* instances);
+};
@@ -0,0 +1,105 @@
+/*
+Title: Instanced Rendering
+File Name: glState.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+
+// Remembers what is bound in opengl, so binding something that's already bound can be skipped.
+// Every bind of programs, vertex arrays, buffers and textures should go through here, or the cache would get out of date.
+// The same goes for turning depth testing and blending on and off, and for the blend function.
+// (If something has to call opengl directly, call Invalidate afterwards.)
+// Objects should also be deleted through here, since opengl unbinds deleted objects, and their names get reused.
+class GLState
+{
+private:
+    static const unsigned int MAX_TEXTURE_UNITS = 32;
+    // Texture targets that are tracked: 2d, cube map, and 2d array.
+    static const unsigned int TEXTURE_TARGETS = 3;
+    // Buffer targets that are tracked.
+    static const unsigned int BUFFER_TARGETS = 8;
+    // Capabilities that are tracked: depth testing and blending.
+    static const unsigned int CAPABILITIES = 2;
+    // Means we don't know what's bound.
+    static const GLuint UNKNOWN = 0xffffffff;
+
+    static GLuint s_program;
+    static GLuint s_vertexArray;
+    static GLuint s_buffers[BUFFER_TARGETS];
+    static unsigned int s_activeTexture;
+    static GLuint s_textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+    // 1 if a capability is on, 0 if it's off, or UNKNOWN.
+    static GLuint s_capabilities[CAPABILITIES];
+    static GLuint s_blendSource;
+    static GLuint s_blendDestination;
+
+    static unsigned int s_callsMade;
+    static unsigned int s_callsSkipped;
+    static bool s_debugUnbind;
+
+    // Where a target lives in the arrays above, or -1 if it isn't tracked.
+    static int TextureTargetIndex(GLenum target);
+    static int BufferTargetIndex(GLenum target);
+    static int CapabilityIndex(GLenum capability);
+
+public:
+    static void UseProgram(GLuint program);
+    static void BindVertexArray(GLuint vertexArray);
+    static void BindBuffer(GLenum target, GLuint buffer);
+    // Binds a range of a buffer to an indexed binding point. This always goes through to opengl,
+    // but it binds the buffer to the target as well, so the cache has to know about it.
+    static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    // Points a vertex buffer binding of the bound vertex array at a buffer. That's part of the vertex array,
+    // so it isn't cached, but it goes through here so that it's counted with the other binds.
+    static void BindVertexBuffer(GLuint bindingIndex, GLuint buffer, GLintptr offset, GLsizei stride);
+    static void ActiveTexture(unsigned int unit);
+    // Binds a texture to the active texture unit.
+    static void BindTexture(GLenum target, GLuint texture);
+    // Binds a texture to the given texture unit.
+    static void BindTexture(unsigned int unit, GLenum target, GLuint texture);
+
+    // Turns a capability on or off, like glEnable and glDisable.
+    static void SetEnabled(GLenum capability, bool enabled);
+    // Whether a capability is on. This only asks opengl if the cache doesn't know.
+    static bool IsEnabled(GLenum capability);
+    static void BlendFunc(GLenum source, GLenum destination);
+    static void GetBlendFunc(GLenum& source, GLenum& destination);
+
+    // Deletes objects, and forgets them if they were bound.
+    static void DeleteProgram(GLuint program);
+    static void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+    static void DeleteBuffers(GLsizei count, const GLuint* buffers);
+    static void DeleteTextures(GLsizei count, const GLuint* textures);
+
+    // Forgets everything, so the next bind of anything goes through to opengl.
+    static void Invalidate();
+
+    // How many binds went through to opengl, and how many were skipped, since the counters were reset.
+    static unsigned int GetCallsMade();
+    static unsigned int GetCallsSkipped();
+    static void ResetCounters();
+
+    // With debug unbinding on, things unbind after themselves when they're done (like they used to).
+    // That's slower, but makes it easy to catch code that relies on something else having been left bound.
+    static void SetDebugUnbind(bool debugUnbind);
+    static bool GetDebugUnbind();
+};
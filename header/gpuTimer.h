@@ -0,0 +1,60 @@
+/*
+Title: Instanced Rendering
+File Name: gpuTimer.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+
+// Times gpu work with GL_TIME_ELAPSED queries. The cpu's clock can't do this: draw calls only queue work up,
+// and the gpu gets around to it later.
+// Results come in a few frames late. A small ring of queries means reading them never has to wait for the gpu.
+class GpuTimer
+{
+private:
+    static const unsigned int QUERY_COUNT = 4;
+    GLuint m_queries[QUERY_COUNT];
+    // Whether each query has been issued and not read back yet.
+    bool m_pending[QUERY_COUNT];
+    // The query the next Begin uses, and whether one is running.
+    unsigned int m_next = 0;
+    bool m_running = false;
+
+    // Adds up finished results, for an average.
+    double m_totalMilliseconds = 0;
+    unsigned int m_sampleCount = 0;
+
+    // Reads back any queries that are finished.
+    void Collect();
+
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    // Everything sent to opengl between these is timed. Timers can't overlap each other.
+    void Begin();
+    void End();
+
+    // The average time of the results that have come in since the last reset.
+    double GetAverageMilliseconds();
+    void ResetAverage();
+};
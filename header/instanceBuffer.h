@@ -0,0 +1,107 @@
+/*
+Title: Instanced Rendering
+File Name: instanceBuffer.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "../header/transform3d.h"
+#include "../header/instanceMotion.h"
+#include <vector>
+
+// Holds instance matrices on the gpu, giving every instance a slot that doesn't move.
+// Instead of re-uploading everything each frame, changed slots are marked dirty,
+// and only those are sent to the gpu, merged into as few ranges as possible.
+class InstanceBuffer
+{
+private:
+    // GL buffers holding one matrix and one motion per slot. They're made by the first Update,
+    // so slots can be handed out before there's a gl context.
+    GLuint m_buffer;
+    GLuint m_motionBuffer;
+    // Number of slots the gpu side buffers have room for.
+    unsigned int m_capacity;
+
+    // Cpu side copy of every slot, and the transform (if any) that fills it.
+    std::vector<glm::mat4> m_matrices;
+    std::vector<InstanceMotion> m_motions;
+    std::vector<Transform3D*> m_transforms;
+
+    // Slots waiting to be uploaded, with a flag per slot so a slot is only listed once.
+    // Motions rarely change, so they are tracked separately from the matrices.
+    std::vector<unsigned int> m_dirtySlots;
+    std::vector<bool> m_slotDirty;
+    std::vector<unsigned int> m_dirtyMotionSlots;
+    std::vector<bool> m_motionDirty;
+
+    // Slots that were removed and can be handed out again, with a flag per slot so a slot can't be freed twice.
+    std::vector<unsigned int> m_freeSlots;
+    std::vector<bool> m_slotFree;
+
+    // Middle of the box around every used slot's position, as of the last Update.
+    glm::vec3 m_center;
+
+    // What the last call to Update sent to the gpu.
+    unsigned int m_bytesUploaded;
+    unsigned int m_rangesUploaded;
+
+    // Finds m_center again.
+    void UpdateCenter();
+    // Uploads the given dirty slots of one array to the buffer bound to GL_ARRAY_BUFFER, then clears the list.
+    void UploadRanges(std::vector<unsigned int>& dirtySlots, std::vector<bool>& slotDirty, const char* data, unsigned int stride);
+
+public:
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    // Gives the transform a slot, and returns it. The transform marks its slot whenever it changes.
+    unsigned int AddInstance(Transform3D* transform);
+    // Gives a slot to a matrix that is set by hand with SetMatrix.
+    unsigned int AddInstance(glm::mat4 matrix);
+    // Frees a slot. Until it's reused, the slot holds a zero matrix, which draws nothing.
+    // Freeing a slot that's already free (or was never handed out) is an error, and does nothing.
+    void RemoveInstance(unsigned int slot);
+    // Called by a transform that was moved, so its slot follows it to its new address.
+    void MoveInstance(unsigned int slot, Transform3D* transform);
+
+    // Sets the matrix for a slot that doesn't belong to a transform.
+    void SetMatrix(unsigned int slot, glm::mat4 matrix);
+    // Sets the motion the vertex shader applies on top of a slot's matrix.
+    void SetMotion(unsigned int slot, InstanceMotion motion);
+    // Flags a slot for upload.
+    void MarkDirty(unsigned int slot);
+
+    // Rebuilds the matrices of changed transforms, and uploads every dirty range.
+    void Update();
+
+    GLuint GetGLBuffer();
+    GLuint GetGLMotionBuffer();
+    // Number of slots, including free ones. This is the instance count to draw.
+    unsigned int GetCount();
+    // Middle of all the instances as of the last Update, for sorting by depth.
+    // (It doesn't know about motion the vertex shader adds.)
+    glm::vec3 GetCenter();
+
+    // Bytes uploaded and glBufferSubData calls made by the last Update.
+    unsigned int GetBytesUploaded();
+    unsigned int GetRangesUploaded();
+};
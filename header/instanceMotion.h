@@ -0,0 +1,48 @@
+/*
+Title: Instanced Rendering
+File Name: instanceMotion.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "glm/glm.hpp"
+
+// Describes simple motion that the vertex shader works out by itself from the current time.
+// Instances that only spin, orbit or bob never need their matrix touched on the cpu,
+// so they cost nothing to update and nothing to upload after the first frame.
+// The motions can be combined, and are applied in the order spin, orbit, bob.
+struct InstanceMotion
+{
+    // xyz: world space axis to spin around (through the instance's own origin), w: angular speed (radians per second)
+    glm::vec4 m_spin;
+    // xyz: point to orbit around the world y axis, w: angular speed (radians per second)
+    glm::vec4 m_orbit;
+    // xyz: direction to bob in, scaled by the amplitude, w: frequency (radians per second)
+    glm::vec4 m_bob;
+    // Starting angles of the spin, orbit and bob in x, y and z, so that instances can be out of step.
+    glm::vec4 m_phase;
+
+    // Makes a motion that doesn't move at all.
+    InstanceMotion();
+
+    void SetSpin(glm::vec3 axis, float speed, float phase = 0);
+    void SetOrbit(glm::vec3 center, float speed, float phase = 0);
+    void SetBob(glm::vec3 direction, float amplitude, float frequency, float phase = 0);
+};
@@ -0,0 +1,60 @@
+/*
+Title: Instanced Rendering
+File Name: instanceSorter.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+class JobSystem;
+
+// Sorts instance matrices front to back by their distance from the camera.
+// Drawing close objects first lets the depth test throw away hidden fragments
+// before the fragment shader runs, instead of shading them and overwriting them later.
+// Sorting is optional: while it's turned off, Sort hands the matrices back as they are.
+class InstanceSorter
+{
+private:
+    bool m_enabled;
+    // Lends its threads to big sorts, if there is one.
+    JobSystem* m_jobs;
+
+    // Last frame's draw order, stored as indices into the caller's matrices.
+    std::vector<unsigned int> m_order;
+    // Depth keys for each entry in m_order.
+    std::vector<unsigned int> m_keys;
+    // Matrices copied out in sorted order, ready to upload.
+    std::vector<glm::mat4> m_sorted;
+
+public:
+    InstanceSorter();
+
+    // Turns sorting on and off. It's on to begin with.
+    void SetEnabled(bool enabled);
+    bool GetEnabled();
+    // Lets big sorts run on a job system's threads. Without one (to begin with), everything runs on this thread.
+    void SetJobSystem(JobSystem* jobs);
+
+    // Returns the matrices ordered front to back for the given view matrix.
+    // The reference is only valid until the next call to Sort (and, while sorting is off, is matrices itself).
+    const std::vector<glm::mat4>& Sort(const std::vector<glm::mat4>& matrices, glm::mat4 view);
+};
@@ -0,0 +1,209 @@
+/*
+Title: Instanced Rendering
+File Name: jobSystem.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A unit of work for the job system.
+// Jobs can have children (the parent isn't finished until they all are),
+// and dependencies (the job isn't started until they are all finished).
+struct Job
+{
+    // How many continuations a single job can have.
+    static const int MAX_CONTINUATIONS = 15;
+    // How many bytes a job's function (with everything it captured) can take up.
+    // That's room for about a dozen references, plus what a parallel for needs for itself.
+    static const unsigned int WORK_SIZE = 96;
+
+    // The work is stored right inside the job instead of in a std::function, so creating a job never allocates.
+    // m_call knows the real type of whatever is in m_work, and calls it.
+    void (*m_call)(Job* job);
+    alignas(16) unsigned char m_work[WORK_SIZE];
+    Job* m_parent;
+
+    // This job plus any children that haven't finished yet.
+    std::atomic<int> m_unfinished;
+    // Dependencies that haven't finished yet, plus one until Run is called.
+    std::atomic<int> m_waitingOn;
+
+    // Jobs that depend on this one, and get started when it finishes.
+    Job* m_continuations[MAX_CONTINUATIONS];
+    std::atomic<int> m_continuationCount;
+};
+
+// A double ended queue of jobs owned by one thread.
+// The owner pushes and pops at the bottom, while other threads steal from the top, all without locks.
+// (This is the Chase-Lev work stealing deque.)
+class JobQueue
+{
+private:
+    // Must be a power of two.
+    static const unsigned int CAPACITY = 4096;
+
+    std::atomic<Job*> m_jobs[CAPACITY];
+    std::atomic<long long> m_top;
+    std::atomic<long long> m_bottom;
+
+public:
+    JobQueue();
+
+    // Only the owning thread may push and pop. Push returns false if the queue is full.
+    bool Push(Job* job);
+    Job* Pop();
+    // Any thread may steal.
+    Job* Steal();
+};
+
+// Runs jobs on a pool of worker threads. Each thread keeps its own queue, and idle threads steal from the others,
+// so work spreads out over every core without a shared lock. The thread that creates the job system takes part too,
+// whenever it waits on a job.
+class JobSystem
+{
+private:
+    // Jobs are handed out from a ring per thread, and reused once it wraps around.
+    // No thread should have more than this many jobs in flight at once.
+    static const unsigned int JOBS_PER_THREAD = 4096;
+
+    // Everything one thread owns.
+    struct ThreadData
+    {
+        JobQueue m_queue;
+        Job* m_jobs;
+        unsigned int m_nextJob;
+    };
+
+    std::vector<ThreadData*> m_threadData;
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running;
+
+    // Idle workers sleep here, and get woken when new jobs are pushed.
+    // Every push bumps m_pushCount, so a worker can tell if something was pushed after it last looked for work.
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    std::atomic<int> m_sleepingWorkers;
+    std::atomic<unsigned int> m_pushCount;
+
+    // Calls the function of type F stored in a job.
+    template <typename F>
+    static void Call(Job* job)
+    {
+        (*reinterpret_cast<F*>(job->m_work))();
+    }
+
+    void WorkerLoop(unsigned int threadIndex);
+    ThreadData* GetThreadData();
+    Job* AllocateJob();
+    // Finds something to do: our own queue first, then steal from the others.
+    Job* GetJob();
+    void Push(Job* job);
+    void Execute(Job* job);
+    void Finish(Job* job);
+    // Sets up a freshly allocated job with no work.
+    Job* CreateEmptyJob();
+    // Copies work into the job. Whatever it captures must fit in the job, and can't need a destructor
+    // (lambdas that capture references and plain values are fine).
+    template <typename F>
+    static void SetWork(Job* job, const F& work)
+    {
+        static_assert(sizeof(F) <= Job::WORK_SIZE, "Job work captures too much, capture a struct by reference instead");
+        static_assert(std::is_trivially_destructible<F>::value, "Job work is never destroyed, so it can't need a destructor");
+        new (job->m_work) F(work);
+        job->m_call = &Call<F>;
+    }
+
+public:
+    // Creates workerCount worker threads. Zero means one for every core besides the calling thread.
+    JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    // Workers plus the calling thread.
+    unsigned int GetThreadCount();
+
+    // Work is anything that can be called with no arguments, usually a lambda.
+    template <typename F>
+    Job* CreateJob(const F& work)
+    {
+        Job* job = CreateEmptyJob();
+        SetWork(job, work);
+        return job;
+    }
+    // Creates a job that has to finish before its parent counts as finished.
+    template <typename F>
+    Job* CreateChildJob(Job* parent, const F& work)
+    {
+        // The parent can't finish until this one does.
+        parent->m_unfinished++;
+
+        Job* job = CreateJob(work);
+        job->m_parent = parent;
+        return job;
+    }
+    // Makes job wait until dependency finishes. Call this before running either of them.
+    // Returns false (and adds nothing) if dependency already has MAX_CONTINUATIONS jobs waiting on it.
+    bool AddDependency(Job* job, Job* dependency);
+
+    // Queues a job. It starts once all of its dependencies have finished.
+    void Run(Job* job);
+    // Runs other jobs until the given job (and all its children) has finished.
+    void Wait(Job* job);
+
+    // Splits [0, count) into batches, and calls work(first, count) for each batch across all threads.
+    // Returns a job that finishes when every batch has; run it (and maybe wait on it) yourself.
+    // Batches are only queued once the returned job starts, so it can be given dependencies like any other job.
+    template <typename F>
+    Job* CreateParallelFor(unsigned int count, unsigned int batchSize, const F& work)
+    {
+        if (batchSize == 0)
+        {
+            batchSize = 1;
+        }
+
+        // The root job splits the work up when it runs, so nothing starts before the root's own dependencies are done.
+        // It then finishes once every batch has. Batches call the copy of work kept in the root, which outlives them.
+        Job* root = CreateEmptyJob();
+        SetWork(root, [this, root, count, batchSize, work]()
+        {
+            const F* rootWork = &work;
+            for (unsigned int first = 0; first < count; first += batchSize)
+            {
+                unsigned int batchCount = count - first < batchSize ? count - first : batchSize;
+                Run(CreateChildJob(root, [rootWork, first, batchCount]() { (*rootWork)(first, batchCount); }));
+            }
+        });
+        return root;
+    }
+    // Same as above, but runs it and waits for it.
+    template <typename F>
+    void ParallelFor(unsigned int count, unsigned int batchSize, const F& work)
+    {
+        Job* root = CreateParallelFor(count, batchSize, work);
+        Run(root);
+        Wait(root);
+    }
+};
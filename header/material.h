@@ -25,8 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../header/shaderProgram.h"
 #include "../header/texture.h"
 #include "../header/cubeMap.h"
+#include "../header/textureArray.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include <vector>
+#include <string>
+#include <unordered_map>
 
 class Material
 {
@@ -45,31 +48,95 @@ private:
     // Cubemap objects.
     std::vector<CubeMap*> m_cubeMaps;
 
-    // Uniform for matrix.
-    std::vector<GLuint> m_matrixUniforms;
-    // Matrices to bind with material.
-    std::vector<glm::mat4> m_matrices;
-
-    // Uniform for vector.
-    std::vector<GLuint> m_vec4Uniforms;
-    std::vector<GLuint> m_vec3Uniforms;
-    std::vector<GLuint> m_vec2Uniforms;
-    std::vector<GLuint> m_floatUniforms;
-    std::vector<GLuint> m_intUniforms;
-    // vectors to bind with material.
-    std::vector<glm::vec4> m_vec4s;
-    std::vector<glm::vec3> m_vec3s;
-    std::vector<glm::vec2> m_vec2s;
-    std::vector<float> m_floats;
-    std::vector<int> m_ints;
+    // Texture array uniforms in use.
+    std::vector<GLuint> m_textureArrayUniforms;
+    // Texture array objects.
+    std::vector<TextureArray*> m_textureArrays;
+
+    // Where one uniform's value lives in the parameter block.
+    struct Parameter
+    {
+        std::string m_name;
+        // Location in the program, or -1 for values in the material parameter block.
+        GLint m_location;
+        GLenum m_type;
+        unsigned int m_offset;
+        unsigned int m_size;
+        // Whether a value has been given yet. Uniforms that were never set are left alone.
+        bool m_set;
+        bool m_dirty;
+    };
+
+    // Every value the program takes, found from the program's uniform table when the material is made.
+    std::vector<Parameter> m_parameters;
+    // Parameter indices by uniform location (-1 where there's none), and by name hash.
+    std::vector<int> m_locationParameters;
+    std::unordered_multimap<unsigned int, int> m_nameParameters;
+
+    // The values themselves, all in one 16 byte aligned block.
+    // If the program has a material parameter block, its values come first, laid out exactly as the shader wants them,
+    // followed by the ordinary uniforms, each in its own 16 bytes (or 64 for a matrix).
+    struct alignas(16) BlockChunk
+    {
+        unsigned char m_bytes[16];
+    };
+    std::vector<BlockChunk> m_block;
+
+    // Ordinary uniforms changed since the last bind.
+    // If another material used the program in between, everything is uploaded instead.
+    std::vector<int> m_dirtyParameters;
+
+    // The material parameter block lives in this buffer, which is rewritten in one go when anything in it changes.
+    GLuint m_parameterBuffer = 0;
+    GLint m_parameterBlockSize = 0;
+    bool m_parameterBlockDirty = false;
+
+    // Texture units have to be reassigned to sampler uniforms.
+    bool m_samplersDirty = true;
+
+    // Whether the program was ready, and the parameters have been laid out.
+    bool m_parametersBuilt = false;
+    // Values set by name before the program was ready. Textures are held by m_object, with their sampler type.
+    struct PendingValue
+    {
+        std::string m_name;
+        GLenum m_type;
+        void* m_object;
+        unsigned char m_value[64];
+    };
+    std::vector<PendingValue> m_pendingValues;
+
+    // Drawn with instead, while the program is still building.
+    Material* m_fallback = nullptr;
+
+    // Bytes needed for a uniform type, or 0 for types that aren't plain values.
+    static unsigned int TypeSize(GLenum type);
+    // Finds each uniform's place in the block.
+    void BuildParameters();
+    void Defer(const char* name, GLenum type, void* object, const void* value);
+    void ApplyPendingValues();
+    // Returns the parameter for a uniform, or -1.
+    int FindParameter(const char* name);
+    int FindParameter(GLint uniform);
+    // Copies a value into the block, if it's the right type and it changed.
+    void SetValue(const char* name, GLenum type, const void* value);
+    void SetValue(int parameter, GLenum type, const void* value);
+    // Sends a single ordinary uniform to the program.
+    void UploadValue(int parameter);
 
 public:
+    // Programs can put their material values in a uniform block with this name, to have them sent in one go.
+    static const char* PARAMETER_BLOCK_NAME;
+    static const GLuint PARAMETER_BINDING;
+
     // Create a material using a given shader program.
     // If you want to use a different shader program, create a new material.
     Material(ShaderProgram* shaderProgram);
     ~Material();
+    // Set uniforms by name. The name is looked up in the shader program's table of uniforms.
     void SetTexture(char* name, Texture* texture);
     void SetCubeMap(char* name, CubeMap* cubeMap);
+    void SetTextureArray(char* name, TextureArray* textureArray);
     void SetMatrix(char* name, glm::mat4 matrix);
     void SetVec4(char* name, glm::vec4 vector);
     void SetVec3(char* name, glm::vec3 vector);
@@ -77,6 +144,28 @@ public:
     void SetFloat(char* name, float f);
     void SetInt(char* name, int i);
 
-    void Bind();
+    // Set uniforms by location, from ShaderProgram::GetUniformLocation.
+    // Look locations up once, and use these for anything set every frame.
+    // (Values in the material parameter block don't have locations, so those can only be set by name.)
+    void SetTexture(GLint uniform, Texture* texture);
+    void SetCubeMap(GLint uniform, CubeMap* cubeMap);
+    void SetTextureArray(GLint uniform, TextureArray* textureArray);
+    void SetMatrix(GLint uniform, glm::mat4 matrix);
+    void SetVec4(GLint uniform, glm::vec4 vector);
+    void SetVec3(GLint uniform, glm::vec3 vector);
+    void SetVec2(GLint uniform, glm::vec2 vector);
+    void SetFloat(GLint uniform, float f);
+    void SetInt(GLint uniform, int i);
+
+    ShaderProgram* GetShaderProgram();
+
+    // Whether the program has finished building, so the material can be drawn with. Never waits.
+    bool IsReady();
+    // A material to bind instead while this one's program is still building (or if it failed).
+    void SetFallback(Material* fallback);
+
+    // Binds the program and textures, and sends any values that changed since the last bind.
+    // Returns false if nothing could be bound, because the program isn't ready and there's no fallback. Skip the draw then.
+    bool Bind();
     void Unbind();
 };
\ No newline at end of file
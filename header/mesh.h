@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "GLFW/glfw3.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "../header/instanceBuffer.h"
 #include <vector>
 #include <string>
 #include <iostream>
@@ -66,7 +67,19 @@ public:
 
     // Draws the shape using a given world matrix
     void Draw();
-    void DrawInstanced(std::vector<glm::mat4> matrices);
+    void DrawInstanced(const std::vector<glm::mat4>& matrices);
+    void DrawInstanced(const glm::mat4* matrices, unsigned int count);
+    // Draws one instance for every slot in an instance buffer, without uploading anything itself.
+    void DrawInstanced(InstanceBuffer* instances);
+
+    // Vertex and index data, for anything that wants to copy this mesh into its own buffers.
+    const std::vector<Vertex3dUVNormal>& GetVertices();
+    const std::vector<unsigned int>& GetIndices();
+
+    // Creates a vao reading our vertex format, per instance matrices, and per instance motions from the given buffers.
+    // The motion buffer is read with a stride of 0, so every instance gets the same motion.
+    // The buffers have to be real buffer objects already (made with glCreateBuffers, or bound at least once).
+    static GLuint CreateInstancedVAO(GLuint vertexBuffer, GLuint indexBuffer, GLuint instanceBuffer, GLuint noMotionBuffer);
 
 private:
 	// Vectors of shape information
@@ -77,6 +90,8 @@ private:
 	GLuint m_vertexBuffer;
 	GLuint m_indexBuffer;
     GLuint m_instanceBuffer;
+    // Holds a single motion that doesn't move, read by every instance drawn from a plain vector of matrices.
+    GLuint m_noMotionBuffer;
 
     // A vao will keep track of our buffer attributes so we don't have to set them up over and over again.
     // This way we can swtich between rendering single objects, and rendering instanced objects more quickly.
@@ -86,4 +101,6 @@ private:
 
     void CalculateTangents();
     void SetupBuffers();
+    // Sets up attributes 0-3 and the index buffer on a vao, for our vertex format.
+    static void SetupVertexFormat(GLuint vao, GLuint vertexBuffer, GLuint indexBuffer);
 };
\ No newline at end of file
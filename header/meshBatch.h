@@ -0,0 +1,126 @@
+/*
+Title: Instanced Rendering
+File Name: meshBatch.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "../header/mesh.h"
+#include <vector>
+
+// Collects instanced draws of many different meshes over a frame, and submits them all with one draw call.
+// Every mesh added to the batch has its geometry copied into one shared vertex and index buffer,
+// so they can all be drawn through a single vao. Each frame, the instance matrices are uploaded together,
+// and one indirect command per mesh is written to a buffer that glMultiDrawElementsIndirect reads from.
+// All meshes share the Vertex3dUVNormal format; a different vertex format would need its own batch.
+class MeshBatch
+{
+private:
+    // Where a mesh's geometry lives in the shared buffers.
+    struct MeshRange
+    {
+        Mesh* m_mesh;
+        GLuint m_firstIndex;
+        GLuint m_indexCount;
+        GLint m_baseVertex;
+    };
+
+    // One group of instances of a mesh, added this frame.
+    struct DrawRange
+    {
+        unsigned int m_mesh;
+        unsigned int m_firstInstance;
+        unsigned int m_instanceCount;
+    };
+
+    // The layout glMultiDrawElementsIndirect expects for each command.
+    struct DrawElementsIndirectCommand
+    {
+        GLuint m_count;
+        GLuint m_instanceCount;
+        GLuint m_firstIndex;
+        GLint m_baseVertex;
+        GLuint m_baseInstance;
+    };
+
+    // Geometry of every mesh used with this batch, and whether it has to be uploaded again.
+    std::vector<MeshRange> m_meshes;
+    std::vector<Vertex3dUVNormal> m_vertices;
+    std::vector<unsigned int> m_indices;
+    bool m_geometryDirty;
+
+    // Everything added this frame.
+    std::vector<glm::mat4> m_instances;
+    std::vector<DrawRange> m_draws;
+
+    // Instances regrouped by mesh, and the commands that draw them.
+    std::vector<glm::mat4> m_sortedInstances;
+    std::vector<DrawElementsIndirectCommand> m_commands;
+
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    GLuint m_instanceBuffer;
+    GLuint m_noMotionBuffer;
+    GLuint m_commandBuffer;
+    GLuint m_vao;
+
+    // With batching off, every range is drawn on its own with Mesh::DrawInstanced, the way it was done before batches.
+    bool m_batching;
+
+    // What the last Submit did with batching on, and with it off.
+    // State changes are the binds counted by GLState while submitting.
+    unsigned int m_drawCalls;
+    unsigned int m_stateChanges;
+    unsigned int m_unbatchedDrawCalls;
+    unsigned int m_unbatchedStateChanges;
+    // Matrices of one range, for drawing it unbatched.
+    std::vector<glm::mat4> m_rangeInstances;
+
+    // Returns the index of a mesh in m_meshes, copying in its geometry the first time it's seen.
+    unsigned int FindMesh(Mesh* mesh);
+
+public:
+    MeshBatch();
+    ~MeshBatch();
+
+    // Adds count instances of a mesh, using matrices starting at first.
+    void Add(Mesh* mesh, const std::vector<glm::mat4>& matrices, unsigned int first, unsigned int count);
+    // Adds one instance of a mesh for every matrix.
+    void Add(Mesh* mesh, const std::vector<glm::mat4>& matrices);
+
+    // Middle of the box around every instance added since the last submit, for sorting by depth.
+    glm::vec3 GetCenter();
+
+    // Uploads everything added since the last submit, and draws it. Bind a material first.
+    void Submit();
+
+    // Turns batching on and off, to compare the two. It's on to begin with.
+    void SetBatching(bool batching);
+    bool GetBatching();
+
+    // Draw calls and state changes measured the last time Submit ran batched, and the last time it ran unbatched.
+    // (The unbatched ones stay 0 until batching is turned off once.)
+    unsigned int GetDrawCalls();
+    unsigned int GetStateChanges();
+    unsigned int GetUnbatchedDrawCalls();
+    unsigned int GetUnbatchedStateChanges();
+};
@@ -0,0 +1,57 @@
+/*
+Title: Instanced Rendering
+File Name: programCache.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include <string>
+#include <cstdint>
+
+// Saves linked programs to disk with glGetProgramBinary, and loads them back with glProgramBinary on later runs,
+// which skips compiling and linking shaders altogether.
+// Binaries only work on the driver that made them, so the key covers the shader sources and the driver's vendor,
+// renderer and version strings. If anything doesn't match, or the driver rejects the binary, loading just fails,
+// and the program gets built from source like normal.
+class ProgramCache
+{
+private:
+    static std::string s_directory;
+    static bool s_enabled;
+
+    static std::string GetPath(uint64_t key);
+
+public:
+    // Where cache files go. The directory is made if it doesn't exist. Defaults to "shaderCache".
+    static void SetDirectory(const std::string& directory);
+    // Turns the cache on or off (on by default).
+    static void SetEnabled(bool enabled);
+    static bool GetEnabled();
+
+    // Combines the hashes of a program's shaders with the current driver's details.
+    // Needs a current opengl context.
+    static uint64_t MakeKey(const uint64_t* sourceHashes, unsigned int count);
+
+    // Fills a program from the cache, and returns true if it's now linked.
+    static bool Load(GLuint program, uint64_t key);
+    // Writes a linked program to the cache. (It should have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.)
+    static void Save(GLuint program, uint64_t key);
+};
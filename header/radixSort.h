@@ -0,0 +1,37 @@
+/*
+Title: Instanced Rendering
+File Name: radixSort.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <vector>
+#include <cstdint>
+
+class JobSystem;
+
+// Sorts values by their keys with a least significant digit radix sort, one byte per pass.
+// The sort is stable, so values with equal keys stay in the order they came in.
+// Only the lowest keyBytes bytes of each key are looked at, so short keys take fewer passes.
+// Given a job system, large inputs have each pass split across its threads. Without one, everything runs on this thread.
+// (Like any use of a job system, only call it from the thread that made it, or from one of its jobs.)
+void RadixSort(std::vector<unsigned int>& keys, std::vector<unsigned int>& values, unsigned int keyBytes, JobSystem* jobs = nullptr);
+// The same, for 64 bit keys (up to 8 key bytes).
+void RadixSort(std::vector<uint64_t>& keys, std::vector<unsigned int>& values, unsigned int keyBytes, JobSystem* jobs = nullptr);
@@ -0,0 +1,140 @@
+/*
+Title: Instanced Rendering
+File Name: renderQueue.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "../header/material.h"
+#include "../header/mesh.h"
+#include "../header/instanceBuffer.h"
+#include "../header/meshBatch.h"
+#include "../header/spriteBatch.h"
+#include "../header/glCommandBackend.h"
+#include "../header/sortKey.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Collects a frame's draws, and runs them in an order that keeps state changes down, instead of in the order they came in.
+// Every draw gets a 64 bit sort key (see SortKey for the layout):
+//   pass (4 bits) | program (10 bits) | material (14 bits) | mesh (12 bits) | depth (24 bits)
+// Sorting the keys puts passes in order, then groups draws by program, then by material (textures), then by mesh (vao).
+// Draws that share all of those are drawn front to back, so the depth test can throw out hidden pixels early.
+// In the transparent pass the depth is flipped, since blending needs back to front.
+// The key only holds small ids, so alongside it every draw keeps a payload saying what to actually draw.
+class RenderQueue
+{
+public:
+    // Passes run in this order. Each one sets up its own depth and blend state.
+    enum Pass
+    {
+        OPAQUE_PASS,
+        SKY_PASS,
+        TRANSPARENT_PASS,
+        OVERLAY_PASS
+    };
+
+private:
+    enum CommandType
+    {
+        DRAW_MESH,
+        DRAW_INSTANCE_BUFFER,
+        DRAW_MATRICES,
+        DRAW_MESH_BATCH,
+        DRAW_SPRITE_BATCH,
+        DRAW_COMMANDS
+    };
+
+    // What to draw, once the key has put it in order.
+    struct RenderCommand
+    {
+        CommandType m_type;
+        Material* m_material;
+        Mesh* m_mesh;
+        const void* m_data;
+    };
+
+    std::vector<uint64_t> m_keys;
+    std::vector<unsigned int> m_order;
+    std::vector<RenderCommand> m_commands;
+
+    // Small ids for everything the keys refer to, handed out the first time each one is submitted.
+    // Ids start at 1, so that 0 can mean "no mesh".
+    std::unordered_map<ShaderProgram*, unsigned int> m_programIds;
+    std::unordered_map<Material*, unsigned int> m_materialIds;
+    std::unordered_map<Mesh*, unsigned int> m_meshIds;
+
+    // Lends its threads to sorting big queues, if there is one.
+    JobSystem* m_jobs;
+
+    // Depths are stored as a fraction of this distance.
+    float m_maxDepth;
+
+    // Plays back command buffers, when their turn comes.
+    GLCommandBackend m_commandBackend;
+
+    // What the last Execute did.
+    unsigned int m_drawCount;
+    unsigned int m_programChanges;
+    unsigned int m_materialChanges;
+    unsigned int m_meshChanges;
+
+    // Returns the id for a pointer, handing out the next one if it's new.
+    template <typename T>
+    static unsigned int FindId(std::unordered_map<T*, unsigned int>& ids, T* object, unsigned int bits);
+
+    uint64_t MakeKey(Pass pass, Material* material, Mesh* mesh, float depth);
+    void Add(Pass pass, Material* material, Mesh* mesh, float depth, CommandType type, const void* data);
+    void BeginPass(Pass pass);
+
+public:
+    RenderQueue();
+
+    // Sets the distance that depths are measured against. Anything further away sorts as if it were at this distance.
+    void SetMaxDepth(float maxDepth);
+    // Lets big sorts run on a job system's threads. Without one (to begin with), everything runs on this thread.
+    void SetJobSystem(JobSystem* jobs);
+
+    // Queue up draws for this frame. Depth is the distance from the camera to the middle of what's drawn
+    // (InstanceBuffer and MeshBatch can say where that is).
+    // Nothing is drawn until Execute, so anything these point at has to stay alive until then.
+    void SubmitMesh(Pass pass, Material* material, Mesh* mesh, float depth);
+    void SubmitInstanced(Pass pass, Material* material, Mesh* mesh, InstanceBuffer* instances, float depth);
+    void SubmitInstanced(Pass pass, Material* material, Mesh* mesh, const std::vector<glm::mat4>* matrices, float depth);
+    void SubmitBatch(Pass pass, Material* material, MeshBatch* batch, float depth);
+    void SubmitSprites(Pass pass, Material* material, SpriteBatch* sprites, float depth);
+    // Plays back command buffers (usually recorded on other threads), one after another.
+    // The material is what they were recorded with, and sorts them like any other draw.
+    // Instanced draws of the same thing across all the buffers are merged, so they cost a single draw.
+    void SubmitCommands(Pass pass, Material* material, const std::vector<CommandBuffer*>* commands, float depth);
+
+    // Sorts everything submitted since the last call, draws it, and empties the queue.
+    void Execute();
+
+    unsigned int GetDrawCount();
+    unsigned int GetProgramChanges();
+    unsigned int GetMaterialChanges();
+    unsigned int GetMeshChanges();
+    // What replaying command buffers did in the last Execute.
+    CommandBackend& GetCommandBackend();
+};
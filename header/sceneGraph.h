@@ -0,0 +1,93 @@
+/*
+Title: Instanced Rendering
+File Name: sceneGraph.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+class Transform3D;
+
+// A hierarchy of transforms, where every node's world matrix is its parent's world matrix times its own local matrix.
+// Nodes are stored flattened in depth first order: a parent always comes before its children,
+// and a node's whole subtree sits in one contiguous range right after it.
+// That means updating a subtree is a single pass over neighbouring memory, where every parent is already done.
+// Nodes are referred to by ids, which stay the same even when nodes move around in the arrays.
+class SceneGraph
+{
+public:
+    // Parent of root nodes, and the id of nodes that don't exist.
+    static const unsigned int NO_NODE = 0xffffffff;
+
+private:
+    // Everything below is indexed by slot, in depth first order.
+    std::vector<glm::mat4> m_localMatrices;
+    std::vector<glm::mat4> m_worldMatrices;
+    // Slot of each node's parent, or NO_NODE for roots.
+    std::vector<unsigned int> m_parents;
+    // One past the last slot of each node's subtree.
+    std::vector<unsigned int> m_subtreeEnds;
+    std::vector<unsigned int> m_slotIds;
+    std::vector<unsigned char> m_dirty;
+
+    // Slot of each id, and ids that were removed and can be reused.
+    std::vector<unsigned int> m_idSlots;
+    std::vector<unsigned int> m_freeIds;
+
+    // Nodes changed since the last update. Everything under them needs updating too.
+    std::vector<unsigned int> m_dirtySlots;
+
+    unsigned int m_nodesUpdated;
+
+    // Marks a slot's subtree for updating.
+    void MarkDirty(unsigned int slot);
+    // Moves every array into a new order, where order[new slot] = old slot.
+    // Subtrees have to stay contiguous, and parents ahead of their children.
+    void Reorder(const std::vector<unsigned int>& order);
+
+public:
+    SceneGraph();
+
+    // Adds a node under the given parent (or as a root with NO_NODE), and returns its id.
+    unsigned int AddNode(unsigned int parent = NO_NODE, glm::mat4 local = glm::mat4());
+    // Removes a node and everything under it.
+    void RemoveNode(unsigned int node);
+    // Moves a node (and everything under it) to a new parent.
+    // Moving a node under one of its own descendants isn't allowed.
+    void SetParent(unsigned int node, unsigned int parent);
+
+    unsigned int GetParent(unsigned int node);
+    unsigned int GetCount();
+
+    void SetLocalMatrix(unsigned int node, glm::mat4 local);
+    // Uses the matrix of a transform as the node's local matrix.
+    void SetLocalTransform(unsigned int node, Transform3D& transform);
+    glm::mat4 GetLocalMatrix(unsigned int node);
+
+    // Recalculates world matrices, but only for subtrees under nodes that changed.
+    void Update();
+    // World matrices are valid as of the last update.
+    glm::mat4 GetWorldMatrix(unsigned int node);
+
+    // How many world matrices the last update recalculated.
+    unsigned int GetNodesUpdated();
+};
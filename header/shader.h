@@ -27,26 +27,71 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cstdint>
 
+// KHR_parallel_shader_compile (and the ARB version, which uses the same values) is newer than our glew,
+// so its constants are defined here, and its one function is looked up by hand.
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Holds the source for one shader stage. The source isn't compiled until something asks for the GL shader,
+// so a program that's restored from the program binary cache never has to compile it at all.
 class Shader
 {
 
 private:
-	GLuint m_shader;
+	GLuint m_shader = 0;
 	GLenum m_type;
 
+    std::string m_source;
+    uint64_t m_sourceHash = 0;
+    // Set once compiling fails, so it isn't tried again.
+    bool m_compileFailed = false;
+    // Whether the compile status has been looked at since compiling started.
+    bool m_compileChecked = false;
+
+    static int s_parallelCompile;
+    static std::string s_precompiledDirectory;
+
     // Reference Counter
     unsigned int m_refCount = 0;
 
 public:
 	Shader(std::string filePath, GLenum shaderType);
+    // An empty shader, for source that doesn't come straight from a file. (see InitFromString)
+    Shader(GLenum shaderType);
 	~Shader();
 
+    // Compiles the shader if it hasn't been yet. Returns 0 if it doesn't compile.
     GLuint GetGLShader();
     GLenum GetGLShaderType();
+    // Whether there's any source to compile.
+    bool HasSource();
+    // A hash of the stage and source, for recognizing the same shader in the program binary cache.
+    uint64_t GetSourceHash();
 
+    // These just store the source. Compiling happens in Compile, or the first time the GL shader is needed.
 	bool InitFromFile(std::string, GLenum shaderType);
 	bool InitFromString(std::string shaderCode, GLenum shaderType);
+    // Reads a whole shader file into a string. Returns false if it can't be read.
+    // If the shaders build target made a newer copy of the file, that's read instead.
+    static bool ReadSource(std::string filePath, std::string& fileContents);
+    // Where the shaders build target put its copies, relative to the working directory.
+    static void SetPrecompiledDirectory(std::string directory);
+    // Compiles and waits for the result.
+    bool Compile();
+    // Starts compiling without waiting. The driver may carry on with it in the background.
+    void StartCompile();
+    // Whether a started compile is done, so that checking it won't wait. Always true without parallel compile.
+    bool IsCompileComplete();
+
+    // Whether the driver can compile and link on its own threads, and tell us when it's finished.
+    // Turns that on the first time it's called (needs a current context).
+    static bool HasParallelCompile();
 
     void IncRefCount();
     void DecRefCount();
@@ -24,6 +24,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 #include "../header/shader.h"
 #include <iostream>
+#include <string>
+#include <unordered_map>
+
+class Material;
+
+// What reflection found out about one active uniform.
+struct UniformInfo
+{
+    std::string m_name;
+    GLint m_location;
+    // GL type (GL_FLOAT_MAT4, GL_SAMPLER_2D...) and array size.
+    GLenum m_type;
+    GLint m_size;
+    // Uniforms in the material parameter block (see Material) have no location, only a byte offset into the block.
+    // Everything else has an offset of -1.
+    GLint m_blockOffset;
+};
 
 // Wraps opengl shader program functionality
 class ShaderProgram
@@ -37,17 +54,72 @@ private:
     // GL index for shader program
     GLuint m_shaderProgram;
 
+    // Programs are built in steps, so that the driver can work on them in the background.
+    enum BuildState
+    {
+        NOT_BUILT,
+        COMPILING,
+        LINKING,
+        BUILT,
+        BUILD_FAILED
+    };
     // Keep track of if the program has been built and only build when needed
-    bool m_programBuilt = false;
+    BuildState m_buildState = NOT_BUILT;
+    // Where the program goes in the program cache.
+    uint64_t m_cacheKey = 0;
 
     // Reference Counter
     unsigned int m_refCount = 0;
 
+    // Every active uniform, found once when the program is linked, keyed by the hash of its name.
+    // Keyed by name hash. Two names can share a hash, so lookups compare the name as well.
+    std::unordered_multimap<unsigned int, UniformInfo> m_uniforms;
+    // Size in bytes of the material parameter block, or 0 if the program doesn't have one.
+    GLint m_parameterBlockSize = 0;
+
+    // The last material to set uniforms on this program. Its values are the ones still set.
+    Material* m_lastMaterial = nullptr;
+
+    // Asks opengl for every active uniform, and fills the table.
+    void ReflectUniforms();
+    // Takes the build as far as it can go. Unless wait is true, stops at any step the driver hasn't finished yet.
+    // Returns false if it had to stop.
+    bool AdvanceBuild(bool wait);
+    // Sets up uniform blocks and reflection once the program has linked.
+    void FinishBuild(bool linked);
+
 public:
     ShaderProgram();
     ~ShaderProgram();
     GLuint GetGLShaderProgram();
     void AttachShader(Shader* shader);
+    // Starts compiling and linking, without waiting for any of it to finish.
+    // Start every program that's going to be needed at once, so the driver can work on all of them together.
+    void StartBuild();
+    // Links the program if it hasn't been already, waiting until it's done. Returns false if linking failed.
+    bool Link();
+    // Moves the build along, and returns whether the program can be used yet. Never waits.
+    bool IsReady();
+    // Whether the program failed to compile or link, and will never be ready.
+    bool HasFailed();
+
+    // Hashes a uniform name. Hash a name once, and look it up as often as you like.
+    static unsigned int HashName(const char* name);
+    // Returns the location of a uniform, or -1 if the program has no such uniform.
+    // Locations are all found when the program links, so this only asks opengl about names that weren't
+    // (like a single element of an array).
+    // (Locations can change if shaders are attached after linking, so look them up again after that.)
+    GLint GetUniformLocation(const char* name);
+    // Looks a uniform up by hash alone. If two uniforms share the hash, this returns one of them,
+    // so only use it with hashes of names that are known not to collide.
+    GLint GetUniformLocation(unsigned int nameHash);
+    // Every active uniform in the program, by name hash.
+    const std::unordered_multimap<unsigned int, UniformInfo>& GetUniforms();
+    GLint GetParameterBlockSize();
+
+    // Used by materials to skip uploading uniforms that are already set.
+    Material* GetLastMaterial();
+    void SetLastMaterial(Material* material);
     void Bind();
     void Unbind();
     void IncRefCount();
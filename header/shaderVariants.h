@@ -0,0 +1,74 @@
+/*
+Title: Instanced Rendering
+File Name: shaderVariants.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "../header/shaderProgram.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// One pair of shader sources that can be built with different features turned on.
+// A source lists the features it knows about on a line like:
+//     #pragma keywords NORMAL_MAP TEXTURE_ARRAY
+// Each keyword gets a bit, and asking for a combination of bits gives a program built with a #define for each one,
+// so the shader can #ifdef the parts it doesn't always need.
+// Programs are only built the first time their combination is asked for, and then kept.
+class ShaderVariants
+{
+private:
+    // The original source of each stage.
+    std::string m_vertexSource;
+    std::string m_fragmentSource;
+
+    // Every keyword from both stages. A keyword's bit is 1 << its index.
+    std::vector<std::string> m_keywords;
+    // The keywords each stage declared. Bits a stage doesn't use are left out of its key,
+    // so variants that only differ in the other stage share the same shader.
+    uint32_t m_vertexKeywords = 0;
+    uint32_t m_fragmentKeywords = 0;
+
+    // Everything built so far, keyed by keyword bits.
+    std::unordered_map<uint32_t, ShaderProgram*> m_programs;
+    std::unordered_map<uint32_t, Shader*> m_vertexShaders;
+    std::unordered_map<uint32_t, Shader*> m_fragmentShaders;
+
+    // Adds the keywords declared in a source, and returns their bits.
+    uint32_t ParseKeywords(const std::string& source);
+    // Copies a source, with a #define for each keyword in keywords put right after its #version line.
+    std::string MakeSource(const std::string& source, uint32_t keywords);
+    Shader* GetShader(std::unordered_map<uint32_t, Shader*>& shaders, const std::string& source, GLenum shaderType, uint32_t keywords);
+
+public:
+    ShaderVariants(std::string vertexFilePath, std::string fragmentFilePath);
+    ~ShaderVariants();
+
+    // The bit for a keyword, or 0 if neither source declares it.
+    uint32_t GetKeyword(const char* keyword);
+
+    // The program for a combination of keyword bits. It's created, and starts building, the first time it's asked for.
+    ShaderProgram* GetProgram(uint32_t keywords);
+    // How many combinations have been built.
+    unsigned int GetProgramCount();
+};
@@ -0,0 +1,85 @@
+/*
+Title: Instanced Rendering
+File Name: sortKey.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <cstdint>
+
+// Packs what a draw needs into one 64 bit number, so sorting numbers sorts draws.
+// Laid out from the most significant bit down:
+//   pass (4 bits) | program (10 bits) | material (14 bits) | mesh (12 bits) | depth (24 bits)
+// Ids that don't fit are clamped to the largest one, and depth is a fraction from 0 (near) to 1 (far).
+// Everything is inline, since it's called for every draw and is only a few shifts.
+struct SortKey
+{
+    static const unsigned int PASS_BITS = 4;
+    static const unsigned int PROGRAM_BITS = 10;
+    static const unsigned int MATERIAL_BITS = 14;
+    static const unsigned int MESH_BITS = 12;
+    static const unsigned int DEPTH_BITS = 24;
+
+    static const unsigned int DEPTH_SHIFT = 0;
+    static const unsigned int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    static const unsigned int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+    static const unsigned int PROGRAM_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+    static const unsigned int PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+
+    // With backToFront, far things sort first instead (for blending).
+    static uint64_t Make(unsigned int pass, unsigned int program, unsigned int material, unsigned int mesh, float depth, bool backToFront)
+    {
+        if (!(depth > 0)) depth = 0;
+        if (depth > 1) depth = 1;
+        uint64_t maxDepth = Max(DEPTH_BITS);
+        uint64_t depthBits = (uint64_t)(depth * maxDepth);
+        if (backToFront) depthBits = maxDepth - depthBits;
+
+        return (Clamp(pass, PASS_BITS) << PASS_SHIFT)
+            | (Clamp(program, PROGRAM_BITS) << PROGRAM_SHIFT)
+            | (Clamp(material, MATERIAL_BITS) << MATERIAL_SHIFT)
+            | (Clamp(mesh, MESH_BITS) << MESH_SHIFT)
+            | (depthBits << DEPTH_SHIFT);
+    }
+
+    // Pulls the fields back out.
+    static unsigned int GetPass(uint64_t key) { return Field(key, PASS_SHIFT, PASS_BITS); }
+    static unsigned int GetProgram(uint64_t key) { return Field(key, PROGRAM_SHIFT, PROGRAM_BITS); }
+    static unsigned int GetMaterial(uint64_t key) { return Field(key, MATERIAL_SHIFT, MATERIAL_BITS); }
+    static unsigned int GetMesh(uint64_t key) { return Field(key, MESH_SHIFT, MESH_BITS); }
+    static unsigned int GetDepth(uint64_t key) { return Field(key, DEPTH_SHIFT, DEPTH_BITS); }
+
+    // The largest value a field of the given size holds.
+    static uint64_t Max(unsigned int bits)
+    {
+        return ((uint64_t)1 << bits) - 1;
+    }
+
+private:
+    static uint64_t Clamp(unsigned int value, unsigned int bits)
+    {
+        return value < Max(bits) ? value : Max(bits);
+    }
+
+    static unsigned int Field(uint64_t key, unsigned int shift, unsigned int bits)
+    {
+        return (unsigned int)((key >> shift) & Max(bits));
+    }
+};
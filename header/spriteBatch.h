@@ -0,0 +1,96 @@
+/*
+Title: Instanced Rendering
+File Name: spriteBatch.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "../header/texture.h"
+#include "../header/transform2d.h"
+#include <vector>
+
+class JobSystem;
+
+// The vertex format used by sprites.
+struct SpriteVertex
+{
+    // Position in pixels, from the top left of the screen.
+    glm::vec2 m_position;
+    glm::vec2 m_uv;
+    glm::vec4 m_color;
+};
+
+// Collects 2d sprites over a frame, and draws them with as few draw calls as possible.
+// Every sprite becomes four vertices in one streamed vertex buffer. When flushed, the sprites are sorted by layer
+// and then by texture, so each run of sprites sharing a texture is a single draw call.
+// Within a layer, sprites with different textures can end up drawn in any order, so put sprites that overlap on different layers.
+class SpriteBatch
+{
+private:
+    // Most sprites drawn by one draw call. The index buffer is built for this many.
+    static const unsigned int MAX_SPRITES = 16384;
+    // The vertex buffer holds this many flushes' worth of sprites before it's orphaned and started over.
+    static const unsigned int BUFFER_FLUSHES = 3;
+
+    GLuint m_vao;
+    GLuint m_vertexBuffer;
+    GLuint m_indexBuffer;
+    // Where the next flush writes to in the vertex buffer, in sprites.
+    unsigned int m_writeOffset;
+
+    // Sprites queued since the last flush, four vertices each.
+    std::vector<SpriteVertex> m_vertices;
+    std::vector<Texture*> m_textures;
+    std::vector<unsigned char> m_layers;
+
+    // Sort keys and order, kept around to avoid allocating every frame.
+    std::vector<unsigned int> m_keys;
+    std::vector<unsigned int> m_order;
+    // Lends its threads to big sorts, if there is one.
+    JobSystem* m_jobs;
+
+    unsigned int m_drawCalls;
+    unsigned int m_spriteCount;
+
+    // Draws sprites [first, first + count) in sorted order.
+    void FlushRange(unsigned int first, unsigned int count);
+
+public:
+    SpriteBatch();
+    ~SpriteBatch();
+
+    // Queues a sprite size pixels big, centered on the matrix's origin.
+    // uvRect is the part of the texture to use, as (left, top, right, bottom) from the top left of the image.
+    void Draw(Texture* texture, glm::mat3 matrix, glm::vec2 size, glm::vec4 color = glm::vec4(1, 1, 1, 1), glm::vec4 uvRect = glm::vec4(0, 0, 1, 1), unsigned char layer = 0);
+    // Same as above, but placed by a transform.
+    void Draw(Texture* texture, Transform2D& transform, glm::vec2 size, glm::vec4 color = glm::vec4(1, 1, 1, 1), glm::vec4 uvRect = glm::vec4(0, 0, 1, 1), unsigned char layer = 0);
+
+    // Draws every sprite queued since the last flush, over the top of everything. Bind a material using the sprite shaders first.
+    void Flush();
+
+    // Lets big sorts run on a job system's threads. Without one (to begin with), everything runs on this thread.
+    void SetJobSystem(JobSystem* jobs);
+
+    // What the last flush did.
+    unsigned int GetDrawCalls();
+    unsigned int GetSpriteCount();
+};
@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 #include "FreeImage.h"
+#include "../header/textureCache.h"
 #include <iostream>
 
 class Texture
@@ -34,10 +35,22 @@ private:
     unsigned int m_refCount = 0;
 
 public:
-    Texture(char* filePath);
+    // Normal maps are stored with only x and y when they're compressed. (see TextureCache)
+    Texture(char* filePath, TextureCache::Usage usage = TextureCache::COLOR);
+    // A 1x1 texture of one color. Streamed textures start out like this. (see TextureStreamer)
+    Texture(unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha);
     ~Texture();
     void IncRefCount();
     void DecRefCount();
     GLuint GetGLTexture();
+    // Replaces the OpenGL texture with another one (deleting the old one). Immutable storage can't be resized,
+    // so a streamed texture gets a new texture once its real size is known.
+    void SetGLTexture(GLuint texture);
 
+    // Switches between sampling the mip chain (trilinear, plus anisotropic if the driver has it) and just the full size image.
+    // Textures are mipmapped unless this turns it off.
+    void SetMipmapping(bool mipmapped);
+
+    // Sets the filtering of an OpenGL texture. Used by the other texture types too.
+    static void ApplyFiltering(GLuint texture, bool mipmapped);
 };
\ No newline at end of file
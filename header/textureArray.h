@@ -0,0 +1,64 @@
+/*
+Title: Instanced Rendering
+File Name: textureArray.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "GL/glew.h"
+#include "GLFW/glfw3.h"
+#include "FreeImage.h"
+#include "glm/glm.hpp"
+#include <iostream>
+
+// A stack of same sized textures, held in the layers of one GL_TEXTURE_2D_ARRAY.
+// A shader samples it with a sampler2DArray and a layer index, so objects that only differ by texture
+// can share a material, and be drawn together in one instanced draw.
+// Every layer has the same size and format. Images that don't match are rescaled when they're added.
+class TextureArray
+{
+private:
+    GLuint m_texture;
+    unsigned int m_refCount = 0;
+
+    unsigned int m_width;
+    unsigned int m_height;
+    unsigned int m_maxLayers;
+    unsigned int m_layerCount;
+
+public:
+    // Reserves space for maxLayers layers of width by height pixels.
+    TextureArray(unsigned int width, unsigned int height, unsigned int maxLayers);
+    ~TextureArray();
+    void IncRefCount();
+    void DecRefCount();
+    GLuint GetGLTexture();
+
+    // Loads an image into the next free layer, and returns its index (or -1 if the file couldn't be loaded, or the array is full).
+    int AddLayer(char* filePath);
+    unsigned int GetLayerCount();
+    // Layers are mipmapped like Texture. (see Texture::SetMipmapping)
+    void SetMipmapping(bool mipmapped);
+
+    // Instance data is just a world matrix. Its bottom row is always (0, 0, 0, 1) for any transform,
+    // so the layer index rides along in the first element of that row, and the vertex shader puts the 0 back.
+    static void SetLayer(glm::mat4& matrix, unsigned int layer);
+    static unsigned int GetLayer(const glm::mat4& matrix);
+};
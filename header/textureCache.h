@@ -0,0 +1,92 @@
+/*
+Title: Instanced Rendering
+File Name: textureCache.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+#include "FreeImage.h"
+#include <string>
+#include <vector>
+
+// One level (of one face) of an image, held in memory.
+struct ImageLevel
+{
+    unsigned int m_width;
+    unsigned int m_height;
+    std::vector<char> m_data;
+};
+
+// Block compressed textures take a quarter of the memory (or less) of plain 32 bit ones, and the gpu reads them
+// as they are, so sampling them moves less data too.
+// The first time an image is loaded, the driver compresses it while it's uploaded, and the compressed levels are read
+// back and saved as a .dds file. Later runs upload those straight away, and never decode the original image.
+// The cache file is remade whenever one of its source images is newer than it.
+class TextureCache
+{
+private:
+    static std::string s_directory;
+    static bool s_enabled;
+
+    // Gives a texture made with glCreateTextures its immutable storage, and fills it from levels (laid out face by face).
+    // dataFormat is the compressed format of the data, or 0 if it's BGRA pixels.
+    static void CreateStorage(GLuint texture, GLenum internalFormat, GLenum dataFormat, const std::vector<ImageLevel>& levels, unsigned int faceCount);
+
+public:
+    // Color textures get BC7 (or BC1, where BC7 isn't supported).
+    // Normal maps get BC5, which only keeps x and y. Shaders have to work out z themselves.
+    enum Usage
+    {
+        COLOR,
+        NORMAL_MAP
+    };
+
+    // Where cache files go. The directory is made if it doesn't exist. Defaults to "textureCache".
+    static void SetDirectory(const std::string& directory);
+    // Turns the cache on or off (on by default). When it's off, images are uploaded uncompressed.
+    static void SetEnabled(bool enabled);
+    static bool GetEnabled();
+
+    // The compressed format to use for a kind of texture, or 0 if there isn't one (or the cache is off).
+    static GLenum GetFormat(Usage usage);
+    // The cache file for a set of source images (one, or six for a cube map).
+    static std::string GetPath(const std::vector<char*>& sourcePaths, Usage usage);
+
+    // Gives a new texture of type target (GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP) its storage and contents from its cache file.
+    // Returns false if there's no usable file, or any of the sources are newer than it. Then the texture is left alone.
+    static bool Load(const std::string& path, const std::vector<char*>& sourcePaths, GLuint texture, GLenum target);
+    // Writes every level of a texture to a cache file, if it's compressed.
+    static void Save(const std::string& path, GLuint texture, GLenum target);
+
+    // Reads a cache file into memory, checking it the same way Load does. faceCount is 1, or 6 for a cube map.
+    // The levels come out face by face, largest first. Doesn't touch opengl, so it can run on any thread.
+    static bool ReadCompressed(const std::string& path, const std::vector<char*>& sourcePaths, unsigned int faceCount,
+        GLenum& format, std::vector<ImageLevel>& levels);
+    // Decodes an image into 32 bit BGRA levels, largest first. If mipmapped is true, the smaller levels are made
+    // with a box filter, down to 1x1. Doesn't touch opengl either.
+    static bool DecodeImage(char* filePath, bool mipmapped, std::vector<ImageLevel>& levels);
+
+    // Decodes images (one, or six faces for a cube map) and gives a new texture of type target its storage and contents, as internalFormat.
+    // If mipmapped is true, the smaller levels are made with a box filter and uploaded too.
+    // Returns false if the images can't be loaded.
+    static bool UploadImages(GLuint texture, GLenum target, const std::vector<char*>& filePaths, GLenum internalFormat, bool mipmapped);
+};
@@ -0,0 +1,135 @@
+/*
+Title: Instanced Rendering
+File Name: textureStreamer.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+#include "../header/texture.h"
+#include "../header/cubeMap.h"
+#include "../header/textureCache.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads textures while the program keeps running, instead of making it wait at startup.
+// Asking for a texture gives back a 1x1 placeholder right away. Loader threads decode the image (or read its
+// compressed copy from the texture cache), and then each frame Update sends some of it to opengl, smallest mip level first.
+// As each bigger level arrives, the texture's base level moves down to it, so textures sharpen as they stream in.
+//
+// Uploads go through a pixel buffer object that stays mapped. Pixels are copied into it, and the texture is filled
+// from it, so the copy to the gpu happens in the background. It's used as a ring, with a fence after each frame's uploads
+// so nothing gets written over until the gpu is done with it. If the ring is full, uploading waits for the next frame.
+class TextureStreamer
+{
+private:
+    // One texture being streamed in.
+    struct Request
+    {
+        // What's being filled in.
+        GLenum m_target;
+        GLuint m_texture;
+        Texture* m_ownerTexture;
+        CubeMap* m_ownerCubeMap;
+        std::vector<char*> m_sourcePaths;
+        TextureCache::Usage m_usage;
+        std::string m_cachePath;
+
+        // Written by a loader thread, and only read once m_loaded is set.
+        // The levels go face by face, largest first. m_format is 0 if they're plain BGRA pixels.
+        std::vector<ImageLevel> m_levels;
+        unsigned int m_faceCount;
+        unsigned int m_levelCount;
+        GLenum m_format;
+        GLenum m_internalFormat;
+        bool m_failed;
+        std::atomic<bool> m_loaded;
+
+        // The next level to upload (they go from smallest to largest), and whether the texture has its full size storage yet.
+        int m_nextLevel;
+        bool m_allocated;
+    };
+
+    // Each frame's uploads, and how much of the ring they used.
+    struct Fence
+    {
+        GLsync m_sync;
+        GLsizeiptr m_bytes;
+    };
+
+    // Every request that hasn't finished. Only touched by the opengl thread.
+    std::vector<Request*> m_requests;
+
+    // Requests waiting to be loaded, shared with the loader threads.
+    std::vector<std::thread> m_loaders;
+    std::deque<Request*> m_loadQueue;
+    std::mutex m_loadMutex;
+    std::condition_variable m_loadReady;
+    bool m_stopping;
+
+    // The ring buffer.
+    GLuint m_buffer;
+    char* m_mappedData;
+    GLsizeiptr m_size;
+    GLsizeiptr m_head;
+    GLsizeiptr m_used;
+    // Space taken this frame, which gets fenced at the end of Update.
+    GLsizeiptr m_frameBytes;
+    std::deque<Fence> m_fences;
+
+    // How much Update sends at most, so a big texture doesn't stall the frame it arrives in.
+    GLsizeiptr m_bytesPerUpdate;
+    GLsizeiptr m_bytesUploaded;
+
+    void LoaderLoop();
+    void Load(Request* request);
+    Request* CreateRequest(GLenum target, GLuint texture, const std::vector<char*>& sourcePaths, TextureCache::Usage usage, unsigned int faceCount);
+    // Frees ring space the gpu is done with.
+    void Reclaim();
+    // Takes bytes from the ring. Returns the offset, or -1 if there isn't room until the gpu catches up.
+    GLsizeiptr Allocate(GLsizeiptr bytes);
+    // Sends the request's next level. Returns false if there was no room for it.
+    bool UploadLevel(Request* request);
+    void Finish(Request* request);
+
+public:
+    // ringSize is the size of the pixel buffer. Levels bigger than that get uploaded straight from memory instead.
+    TextureStreamer(GLsizeiptr ringSize = 32 * 1024 * 1024, GLsizeiptr bytesPerUpdate = 8 * 1024 * 1024, unsigned int loaderCount = 2);
+    ~TextureStreamer();
+
+    // Start streaming a texture or cube map in, and return it as a placeholder for now.
+    // The streamer holds a reference until it's done.
+    Texture* LoadTexture(char* filePath, TextureCache::Usage usage = TextureCache::COLOR);
+    CubeMap* LoadCubeMap(std::vector<char*> filePaths);
+
+    // Sends loaded levels to opengl. Call once a frame, on the opengl thread.
+    void Update();
+
+    // How many textures haven't finished streaming in yet.
+    unsigned int GetPendingCount();
+    // Total bytes sent so far.
+    GLsizeiptr GetBytesUploaded();
+};
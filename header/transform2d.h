@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 
+#pragma once
 #include "glm/gtc/matrix_transform.hpp"
 
 class Transform2D {
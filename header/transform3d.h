@@ -24,6 +24,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+class InstanceBuffer;
 
 class Transform3D {
 
@@ -36,12 +39,44 @@ private:
     bool m_matrixDirty;
     bool m_inverseDirty;
 
-    glm::mat4 m_rotationMatrix;
+    // Rotation is kept as a quaternion, built from the sine and cosine of each half angle.
+    // Those are cached, so only the axes that changed need new trig.
+    glm::vec3 m_halfSin;
+    glm::vec3 m_halfCos;
+    // One bit per axis (x = 1, y = 2, z = 4) whose half angle needs recalculating.
+    unsigned char m_axisDirty;
+    bool m_rotationDirty;
+
+    glm::quat m_orientation;
+    glm::mat3 m_rotationMatrix;
     glm::mat4 m_matrix;
     glm::mat4 m_inverseMatrix;
 
+    // If this transform is drawn from an instance buffer, this is where its matrix lives.
+    // Any change marks that slot so that only changed matrices get uploaded.
+    InstanceBuffer* m_instanceBuffer;
+    unsigned int m_instanceSlot;
+
+    // Flags the matrices for recalculation, and the instance slot for upload.
+    void SetDirty();
+    // Same as above, but also flags the given rotation axes.
+    void SetRotationDirty(unsigned char axes);
+    // Rebuilds the orientation and rotation matrix if the rotation changed.
+    void UpdateRotation();
+    // Copies everything but the instance slot.
+    void CopyValues(const Transform3D& other);
+
 public:
     Transform3D();
+    // An instance slot belongs to exactly one transform. A copy starts out without one,
+    // and assigning to an attached transform keeps its own slot (and marks it for upload).
+    Transform3D(const Transform3D& other);
+    Transform3D& operator=(const Transform3D& other);
+    // Moving hands the slot over to the new transform, so transforms in a vector can be moved around freely.
+    Transform3D(Transform3D&& other) noexcept;
+    Transform3D& operator=(Transform3D&& other) noexcept;
+    // Frees the instance slot, if there is one.
+    ~Transform3D();
 
     // returns the scale
     float Scale();
@@ -65,9 +100,15 @@ public:
     // increments the position vector
     void Translate(glm::vec3 v);
 
+    // returns the rotation as a quaternion
+    glm::quat GetOrientation();
+
     glm::mat4 GetMatrix();
     glm::mat4 GetInverseMatrix();
     glm::vec3 GetUp();
     glm::vec3 GetForward();
     glm::vec3 GetRight();
+
+    // Called by InstanceBuffer when this transform is given a slot (or nullptr when it is removed).
+    void SetInstanceSlot(InstanceBuffer* instanceBuffer, unsigned int slot);
 };
\ No newline at end of file
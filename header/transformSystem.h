@@ -0,0 +1,120 @@
+/*
+Title: Instanced Rendering
+File Name: transformSystem.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+class TransformHandle;
+
+// Stores many transforms as a structure of arrays: one array per component, instead of one object per transform.
+// Neighbouring transforms' values sit next to each other in memory, so groups of four can be loaded straight into
+// simd registers, and their world matrices built together. The matrices match what Transform3D::GetMatrix returns.
+class TransformSystem
+{
+private:
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_rotationX;
+    std::vector<float> m_rotationY;
+    std::vector<float> m_rotationZ;
+    std::vector<float> m_scale;
+
+    // One flag per transform, set whenever it changes and cleared when its matrix is rebuilt.
+    std::vector<unsigned char> m_dirty;
+
+    // Builds matrices for transforms [first, first + count) into output[0...count) without touching dirty flags.
+    void BuildRange(glm::mat4* output, unsigned int first, unsigned int count);
+
+public:
+    TransformSystem();
+
+    // Adds a transform and returns its index.
+    unsigned int Add(glm::vec3 position, glm::vec3 rotation, float scale);
+    unsigned int GetCount();
+
+    // Returns a handle that can be used just like a Transform3D.
+    TransformHandle GetHandle(unsigned int index);
+
+    glm::vec3 GetPosition(unsigned int index);
+    glm::vec3 GetRotation(unsigned int index);
+    float GetScale(unsigned int index);
+    void SetPosition(unsigned int index, glm::vec3 position);
+    void SetRotation(unsigned int index, glm::vec3 rotation);
+    void SetScale(unsigned int index, float scale);
+
+    // Rotates every transform around the y axis at once.
+    void RotateAllY(float r);
+
+    // Writes world matrices for transforms [first, first + count) into output[first...], whether they changed or not.
+    // Output can point straight into a mapped instance buffer.
+    void BuildMatrices(glm::mat4* output, unsigned int first, unsigned int count);
+    // Writes world matrices only for groups of transforms that changed, and returns how many were written.
+    unsigned int BuildDirtyMatrices(glm::mat4* output);
+
+    // Builds a single matrix, the same way Transform3D would.
+    glm::mat4 GetMatrix(unsigned int index);
+};
+
+// A view into one transform in a TransformSystem, with the same interface as Transform3D.
+// Handles are small and cheap to copy; the values themselves stay in the system.
+// Transform3D itself isn't turned into a view like this: the camera, the scene graph and the demo all keep Transform3Ds
+// as plain values, copying them around freely, and each one caches its own matrices and may own an instance buffer slot.
+// A view would make every one of those copies alias the same transform. So code that wants the structure of arrays asks
+// for it with a handle, and everything else keeps working unchanged.
+class TransformHandle
+{
+private:
+    TransformSystem* m_system;
+    unsigned int m_index;
+
+public:
+    TransformHandle(TransformSystem* system, unsigned int index);
+
+    unsigned int GetIndex();
+
+    // returns the scale
+    float Scale();
+    // returns the rotation in radians
+    glm::vec3 Rotation();
+    // returns the position
+    glm::vec3 Position();
+
+    // sets the scale
+    void SetScale(float s);
+    // sets the rotation (radians)
+    void SetRotation(glm::vec3 r);
+    // sets the position vector
+    void SetPosition(glm::vec3 v);
+
+    // increments the rotation (radians)
+    void RotateX(float r);
+    void RotateY(float r);
+    void RotateZ(float r);
+
+    // increments the position vector
+    void Translate(glm::vec3 v);
+
+    glm::mat4 GetMatrix();
+};
@@ -25,35 +25,91 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #version 400 core
 
+// Features this shader can be built with. (see shaderVariants.h)
+// NORMAL_MAP: bump the surface with a normal map, instead of just using the mesh normal.
+// TEXTURE_ARRAY: every instance picks its own diffuse texture out of an array, so they can all be drawn at once.
+#pragma keywords NORMAL_MAP TEXTURE_ARRAY
+
 in vec3 position;
 in vec2 uv;
 in mat3 tbn;
 
+#ifdef TEXTURE_ARRAY
+flat in int layer;
+uniform sampler2DArray diffuseMaps;
+#else
 uniform sampler2D diffuseMap;
+#endif
+
+#ifdef NORMAL_MAP
 uniform sampler2D normalMap;
+#endif
 
-void main(void)
+// Per frame data, shared by every shader. This has to match FrameUniformData in frameUniforms.h.
+struct PointLight
+{
+	vec4 position;
+	vec4 color;
+	vec4 attenuation;
+};
+
+layout(std140) uniform FrameUniforms
 {
-	vec4 ambientLight = vec4(.1, .1, .2, 1);
-	vec3 pointLightPosition = vec3(1000, 500, 100);
-	vec4 pointLightColor = vec4(1, 1, 1, 1);
-	vec3 pointLightAttenuation = vec3(1, 1, 0);
-	float pointLightRange = 2000;
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 skyViewProjection;
+	vec3 cameraPosition;
+	float time;
+	vec4 ambientLight;
+	int lightCount;
+	PointLight lights[4];
+};
 
+// Values that belong to the material. Each material keeps its own copy of this block, and sends it in one go when it changes.
+layout(std140) uniform MaterialParameters
+{
+	vec4 tint;
+};
+
+// The color written to the screen. (gl_FragColor only exists in compatibility profiles)
+out vec4 fragColor;
+
+void main(void)
+{
+#ifdef NORMAL_MAP
 	// calculate normal from normal map
-	vec3 texnorm = normalize(vec3(texture(normalMap, uv)) * 2.0 - 1.0);
+	// Compressed normal maps only keep x and y. The normal is unit length, so z is whatever's left over.
+	vec3 texnorm;
+	texnorm.xy = texture(normalMap, uv).rg * 2.0 - 1.0;
+	texnorm.z = sqrt(max(1.0 - dot(texnorm.xy, texnorm.xy), 0.0));
 	vec3 norm = tbn * texnorm;
+#else
+	// The last column of the tbn matrix is the normal.
+	vec3 norm = tbn[2];
+#endif
 
 	
-	// Calculate diffuse lighting
-	vec3 lightDir = pointLightPosition - position;
-	float distance = length(lightDir) / pointLightRange;
-	float attenuation = 1 / (distance * distance * pointLightAttenuation.x + distance * pointLightAttenuation.y + pointLightAttenuation.z);
-	float diffuseLight = clamp(dot(normalize(lightDir), normalize(norm)), 0, 1);
-	vec4 finalDiffuseColor = clamp(pointLightColor * (diffuseLight) + ambientLight, 0, 1);
+	// Calculate diffuse lighting from every light
+	vec4 finalDiffuseColor = ambientLight;
+	for (int i = 0; i < lightCount; i++)
+	{
+		vec3 lightDir = lights[i].position.xyz - position;
+		float distance = length(lightDir) / lights[i].position.w;
+		vec3 falloff = lights[i].attenuation.xyz;
+		float attenuation = 1 / (distance * distance * falloff.x + distance * falloff.y + falloff.z);
+		float diffuseLight = clamp(dot(normalize(lightDir), normalize(norm)), 0, 1);
+		finalDiffuseColor += lights[i].color * diffuseLight * attenuation;
+	}
+	finalDiffuseColor = clamp(finalDiffuseColor, 0, 1);
 
 
 	// finally, sample from the texuture and apply the light.
+#ifdef TEXTURE_ARRAY
+	// The third coordinate picks the layer.
+	vec4 color = texture(diffuseMaps, vec3(uv, layer));
+#else
 	vec4 color = texture(diffuseMap, uv);
-	gl_FragColor = (color * finalDiffuseColor);
+#endif
+	fragColor = (color * tint * finalDiffuseColor);
 }
\ No newline at end of file
@@ -30,7 +30,10 @@ in vec3 position;
 // This is what a cubemap texture sampler looks like:
 uniform samplerCube cubeMap;
 
+// Final color of the pixel.
+out vec4 fragColor;
+
 void main(void)
 {
-	gl_FragColor = texture(cubeMap, -position);
+	fragColor = texture(cubeMap, -position);
 }
\ No newline at end of file
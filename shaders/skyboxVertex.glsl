@@ -28,8 +28,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // Vertex attribute for position
 layout(location = 0) in vec3 in_position;
 
-// Uniform for camera view
-uniform mat4 cameraView;
+// Per frame data, shared by every shader. This has to match FrameUniformData in frameUniforms.h.
+struct PointLight
+{
+	vec4 position;
+	vec4 color;
+	vec4 attenuation;
+};
+
+layout(std140) uniform FrameUniforms
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 skyViewProjection;
+	vec3 cameraPosition;
+	float time;
+	vec4 ambientLight;
+	int lightCount;
+	PointLight lights[4];
+};
 
 // We send the position out to the fragment shader to help read from the texture.
 out vec3 position;
@@ -37,7 +55,7 @@ out vec3 position;
 void main(void)
 {
 	// output the transformed vector
-	vec4 p = cameraView * vec4(in_position, 1);
+	vec4 p = skyViewProjection * vec4(in_position, 1);
 
 	// Instead of outputting p, we will swizzle the output to send x y w w.
 	// The gpu will end up dividing z by w to get depth between 0 and 1.
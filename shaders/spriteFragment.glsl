@@ -0,0 +1,40 @@
+/*
+Title: Instanced Rendering
+File Name: spriteFragment.glsl
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#version 400 core
+
+in vec2 uv;
+in vec4 color;
+
+// The sprite batch binds each sprite's texture to unit 0.
+uniform sampler2D spriteTexture;
+
+// Final color of the pixel.
+out vec4 fragColor;
+
+void main(void)
+{
+	fragColor = texture(spriteTexture, uv) * color;
+}
\ No newline at end of file
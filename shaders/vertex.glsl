@@ -25,6 +25,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #version 400 core
 
+// TEXTURE_ARRAY: pass each instance's texture array layer on to the fragment shader. (see shaderVariants.h)
+#pragma keywords TEXTURE_ARRAY
+
 // Vertex attribute for position
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec2 in_uv;
@@ -35,29 +38,109 @@ layout(location = 3) in vec3 in_tangent;
 // In reality, it's taking up locations 5, 6, and 7 as well, because each location is 4 floats.
 layout(location = 4) in mat4 in_worldMat;
 
+// Each instance can also describe some simple motion, which we work out here from the time.
+// (see instanceMotion.h for what each value means)
+layout(location = 8) in vec4 in_spin;
+layout(location = 9) in vec4 in_orbit;
+layout(location = 10) in vec4 in_bob;
+layout(location = 11) in vec4 in_phase;
+
+
+// Per frame data, shared by every shader. This has to match FrameUniformData in frameUniforms.h.
+struct PointLight
+{
+	vec4 position;
+	vec4 color;
+	vec4 attenuation;
+};
 
-uniform mat4 cameraView;
+layout(std140) uniform FrameUniforms
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 skyViewProjection;
+	vec3 cameraPosition;
+	float time;
+	vec4 ambientLight;
+	int lightCount;
+	PointLight lights[4];
+};
 
 out vec3 position;
 out vec2 uv;
 out mat3 tbn;
+#ifdef TEXTURE_ARRAY
+// Which layer of a texture array to sample. (see textureArray.h)
+flat out int layer;
+#endif
+
+// Builds a matrix that rotates around a unit length axis.
+mat3 axisAngle(vec3 axis, float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	float t = 1 - c;
+	return mat3(
+		t * axis.x * axis.x + c, t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y,
+		t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c, t * axis.y * axis.z + s * axis.x,
+		t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c
+		);
+}
+
+// Applies the instance's motion on top of its world matrix.
+mat4 animate(mat4 world)
+{
+	// Spin rotates the matrix axes, but leaves the position where it is.
+	if (in_spin.w != 0)
+	{
+		mat3 spin = axisAngle(in_spin.xyz, in_spin.w * time + in_phase.x);
+		world[0].xyz = spin * world[0].xyz;
+		world[1].xyz = spin * world[1].xyz;
+		world[2].xyz = spin * world[2].xyz;
+	}
+
+	// Orbit swings the whole matrix around the y axis through the orbit center.
+	if (in_orbit.w != 0)
+	{
+		mat3 orbit = axisAngle(vec3(0, 1, 0), in_orbit.w * time + in_phase.y);
+		world[0].xyz = orbit * world[0].xyz;
+		world[1].xyz = orbit * world[1].xyz;
+		world[2].xyz = orbit * world[2].xyz;
+		world[3].xyz = orbit * (world[3].xyz - in_orbit.xyz) + in_orbit.xyz;
+	}
+
+	// Bob slides the position back and forth. (With no bob, this adds zero)
+	world[3].xyz += in_bob.xyz * sin(in_bob.w * time + in_phase.z);
+
+	return world;
+}
 
 void main(void)
 {
+	mat4 worldMat = in_worldMat;
+#ifdef TEXTURE_ARRAY
+	// The bottom row of a world matrix is always (0, 0, 0, 1), so the texture layer is stored in its first element.
+	layer = int(in_worldMat[0][3]);
+#endif
+	// Put the 0 back before the matrix gets used. This happens in every variant, since matrices carrying a layer
+	// can still end up drawn without TEXTURE_ARRAY (by a fallback material, while the real one is still building).
+	worldMat[0][3] = 0;
+	worldMat = animate(worldMat);
 
 	// transform the vector
 	// also pass the world position of the surface forward to the fragment shader
-	vec4 worldPosition = (in_worldMat) * vec4(in_position, 1);
+	vec4 worldPosition = (worldMat) * vec4(in_position, 1);
 	position = vec3(worldPosition);
-	vec4 viewPosition = cameraView * worldPosition;
+	vec4 viewPosition = viewProjection * worldPosition;
 
 	// output the transformed vector
 	gl_Position = viewPosition;
 
 	// We have a little extra work here.
 	// Not only do we have to multiply the normal by the world matrix, we also have to multiply the tangent
-	vec3 normal = mat3(in_worldMat) * in_normal;
-	vec3 tangent = mat3(in_worldMat) * in_tangent;
+	vec3 normal = mat3(worldMat) * in_normal;
+	vec3 tangent = mat3(worldMat) * in_tangent;
 
 	// The third vector we need is a bitangent, or a vector perpendicular to both the normal and tangent.
 	// This can be easily accomplished with a cross product.
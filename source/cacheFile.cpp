@@ -0,0 +1,71 @@
+/*
+Title: Instanced Rendering
+File Name: cacheFile.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../header/cacheFile.h"
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t HashString(const char* string, uint64_t hash)
+{
+    for (const char* c = string; c != nullptr && *c != 0; c++)
+    {
+        hash = (hash ^ (unsigned char)*c) * FNV_PRIME;
+    }
+    return (hash ^ 0xff) * FNV_PRIME;
+}
+
+std::string GetCacheFilePath(const std::string& directory, uint64_t key, const char* extension)
+{
+    char name[17];
+    for (int i = 0; i < 16; i++)
+    {
+        name[i] = "0123456789abcdef"[(key >> (60 - i * 4)) & 0xf];
+    }
+    name[16] = 0;
+    return directory + "/" + name + extension;
+}
+
+void MakeCacheDirectory(const std::string& directory)
+{
+    // It's fine if it's already there.
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
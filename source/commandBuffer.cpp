@@ -0,0 +1,420 @@
+/*
+Title: Instanced Rendering
+File Name: commandBuffer.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../header/commandBuffer.h"
+#include <cstring>
+#include <iostream>
+
+// Commands are padded to this, so every command (and the matrices after SetInstances) starts aligned.
+static const unsigned int COMMAND_ALIGNMENT = 16;
+
+LinearAllocator::LinearAllocator()
+{
+    m_current = 0;
+}
+
+LinearAllocator::~LinearAllocator()
+{
+    for (unsigned int i = 0; i < m_chunks.size(); i++)
+    {
+        delete[] m_chunks[i].m_memory;
+    }
+}
+
+void* LinearAllocator::Allocate(unsigned int size)
+{
+    size = (size + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+
+    // Move on to the next chunk when this one is full, making one if there isn't one big enough.
+    while (m_current < m_chunks.size() && m_chunks[m_current].m_used + size > m_chunks[m_current].m_size)
+    {
+        m_current++;
+        if (m_current < m_chunks.size() && m_chunks[m_current].m_size < size)
+        {
+            // Too small for this, so swap in a bigger one.
+            delete[] m_chunks[m_current].m_memory;
+            m_chunks[m_current].m_size = size;
+            m_chunks[m_current].m_memory = new char[size];
+        }
+    }
+    if (m_current == m_chunks.size())
+    {
+        Chunk chunk;
+        chunk.m_size = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+        chunk.m_memory = new char[chunk.m_size];
+        chunk.m_used = 0;
+        m_chunks.push_back(chunk);
+    }
+
+    Chunk& chunk = m_chunks[m_current];
+    void* memory = chunk.m_memory + chunk.m_used;
+    chunk.m_used += size;
+    return memory;
+}
+
+void LinearAllocator::Reset()
+{
+    for (unsigned int i = 0; i < m_chunks.size(); i++)
+    {
+        m_chunks[i].m_used = 0;
+    }
+    m_current = 0;
+}
+
+unsigned int LinearAllocator::GetChunkCount()
+{
+    return m_chunks.size();
+}
+
+char* LinearAllocator::GetChunk(unsigned int chunk)
+{
+    return m_chunks[chunk].m_memory;
+}
+
+unsigned int LinearAllocator::GetChunkUsed(unsigned int chunk)
+{
+    return m_chunks[chunk].m_used;
+}
+
+
+CommandBuffer::CommandBuffer()
+{
+    m_commandCount = 0;
+}
+
+void* CommandBuffer::AddCommand(CommandType type, unsigned int size)
+{
+    // Commands never straddle two chunks, so the replay can walk each chunk on its own.
+    size = (size + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+    CommandHeader* header = (CommandHeader*)m_allocator.Allocate(size);
+    header->m_type = type;
+    header->m_size = size;
+    m_commandCount++;
+    return header;
+}
+
+void CommandBuffer::BindMaterial(Material* material)
+{
+    BindMaterialCommand* command = (BindMaterialCommand*)AddCommand(BIND_MATERIAL, sizeof(BindMaterialCommand));
+    command->m_material = material;
+}
+
+void CommandBuffer::SetInstances(const glm::mat4* matrices, unsigned int count)
+{
+    // The matrices go right after the command, at the next aligned spot.
+    unsigned int headerSize = (sizeof(SetInstancesCommand) + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+    SetInstancesCommand* command = (SetInstancesCommand*)AddCommand(SET_INSTANCES, headerSize + count * sizeof(glm::mat4));
+    command->m_count = count;
+    if (count > 0) memcpy((char*)command + headerSize, matrices, count * sizeof(glm::mat4));
+}
+
+void CommandBuffer::SetInstances(const std::vector<glm::mat4>& matrices)
+{
+    SetInstances(matrices.data(), matrices.size());
+}
+
+void CommandBuffer::DrawMesh(Mesh* mesh)
+{
+    DrawCommand* command = (DrawCommand*)AddCommand(DRAW_MESH, sizeof(DrawCommand));
+    command->m_mesh = mesh;
+    command->m_instances = nullptr;
+}
+
+void CommandBuffer::DrawInstanced(Mesh* mesh)
+{
+    DrawCommand* command = (DrawCommand*)AddCommand(DRAW_INSTANCED, sizeof(DrawCommand));
+    command->m_mesh = mesh;
+    command->m_instances = nullptr;
+}
+
+void CommandBuffer::DrawInstanced(Mesh* mesh, InstanceBuffer* instances)
+{
+    DrawCommand* command = (DrawCommand*)AddCommand(DRAW_INSTANCE_BUFFER, sizeof(DrawCommand));
+    command->m_mesh = mesh;
+    command->m_instances = instances;
+}
+
+void CommandBuffer::Reset()
+{
+    m_allocator.Reset();
+    m_commandCount = 0;
+}
+
+unsigned int CommandBuffer::GetCommandCount()
+{
+    return m_commandCount;
+}
+
+void CommandBuffer::Replay(CommandBackend& backend)
+{
+    unsigned int headerSize = (sizeof(SetInstancesCommand) + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+
+    backend.BeginBuffer();
+    for (unsigned int chunk = 0; chunk < m_allocator.GetChunkCount(); chunk++)
+    {
+        char* memory = m_allocator.GetChunk(chunk);
+        unsigned int used = m_allocator.GetChunkUsed(chunk);
+
+        unsigned int offset = 0;
+        while (offset < used)
+        {
+            CommandHeader* header = (CommandHeader*)(memory + offset);
+            switch (header->m_type)
+            {
+            case BIND_MATERIAL:
+                backend.BindMaterial(((BindMaterialCommand*)header)->m_material);
+                break;
+            case SET_INSTANCES:
+                backend.SetInstances((const glm::mat4*)((char*)header + headerSize), ((SetInstancesCommand*)header)->m_count);
+                break;
+            case DRAW_MESH:
+                backend.DrawMesh(((DrawCommand*)header)->m_mesh);
+                break;
+            case DRAW_INSTANCED:
+                backend.DrawInstanced(((DrawCommand*)header)->m_mesh);
+                break;
+            case DRAW_INSTANCE_BUFFER:
+                backend.DrawInstanced(((DrawCommand*)header)->m_mesh, ((DrawCommand*)header)->m_instances);
+                break;
+            default:
+                backend.BadCommand(header->m_type);
+                break;
+            }
+
+            // A zero size would loop forever, so give up on the rest of the chunk.
+            if (header->m_size == 0) break;
+            offset += header->m_size;
+        }
+    }
+}
+
+
+CommandBackend::CommandBackend()
+{
+    Reset();
+}
+
+CommandBackend::~CommandBackend()
+{
+}
+
+void CommandBackend::Reset()
+{
+    m_material = nullptr;
+    m_materialReady = false;
+    m_instances = nullptr;
+    m_instanceCount = 0;
+    m_instancesSet = false;
+    m_pendingMesh = nullptr;
+    m_pendingInstances.clear();
+    m_commandCount = m_drawCount = m_materialChanges = m_errorCount = 0;
+}
+
+void CommandBackend::SetBoundMaterial(Material* material, bool ready)
+{
+    Flush();
+    m_material = material;
+    m_materialReady = ready;
+}
+
+void CommandBackend::BeginBuffer()
+{
+    m_instances = nullptr;
+    m_instanceCount = 0;
+    m_instancesSet = false;
+}
+
+void CommandBackend::Error(const char* message)
+{
+    std::cout << "Command buffer error: " << message << std::endl;
+    m_errorCount++;
+}
+
+bool CommandBackend::BindMaterial(Material* material)
+{
+    m_commandCount++;
+    if (material == nullptr)
+    {
+        Error("bound a null material.");
+        return false;
+    }
+    if (material == m_material) return true;
+
+    // Anything waiting was recorded with the old material.
+    Flush();
+    m_material = material;
+    m_materialReady = OnBindMaterial(material);
+    m_materialChanges++;
+    return true;
+}
+
+bool CommandBackend::SetInstances(const glm::mat4* matrices, unsigned int count)
+{
+    m_commandCount++;
+    m_instances = matrices;
+    m_instanceCount = count;
+    m_instancesSet = true;
+    return true;
+}
+
+bool CommandBackend::DrawMesh(Mesh* mesh)
+{
+    m_commandCount++;
+    if (mesh == nullptr)
+    {
+        Error("drew a null mesh.");
+        return false;
+    }
+    if (m_material == nullptr)
+    {
+        Error("drew a mesh without binding a material first.");
+        return false;
+    }
+
+    // Keep things in the order they were recorded.
+    Flush();
+    if (m_materialReady)
+    {
+        OnDrawMesh(mesh);
+        m_drawCount++;
+    }
+    return true;
+}
+
+bool CommandBackend::DrawInstanced(Mesh* mesh)
+{
+    m_commandCount++;
+    if (mesh == nullptr)
+    {
+        Error("drew a null mesh.");
+        return false;
+    }
+    if (m_material == nullptr)
+    {
+        Error("drew instances without binding a material first.");
+        return false;
+    }
+    if (!m_instancesSet)
+    {
+        Error("drew instances without setting any.");
+        return false;
+    }
+    // Nothing to draw isn't an error, there just isn't anything to do.
+    if (m_instanceCount == 0) return true;
+
+    // Merge with the draw before, if it's the same mesh.
+    if (mesh != m_pendingMesh) Flush();
+    m_pendingMesh = mesh;
+    m_pendingInstances.insert(m_pendingInstances.end(), m_instances, m_instances + m_instanceCount);
+    return true;
+}
+
+bool CommandBackend::DrawInstanced(Mesh* mesh, InstanceBuffer* instances)
+{
+    m_commandCount++;
+    if (mesh == nullptr || instances == nullptr)
+    {
+        Error("drew a null mesh or instance buffer.");
+        return false;
+    }
+    if (m_material == nullptr)
+    {
+        Error("drew instances without binding a material first.");
+        return false;
+    }
+
+    Flush();
+    if (m_materialReady)
+    {
+        OnDrawInstanced(mesh, instances);
+        m_drawCount++;
+    }
+    return true;
+}
+
+void CommandBackend::BadCommand(unsigned int type)
+{
+    m_commandCount++;
+    Error("found a command of unknown type.");
+}
+
+void CommandBackend::Flush()
+{
+    if (m_pendingInstances.empty()) return;
+
+    if (m_materialReady)
+    {
+        OnDrawInstanced(m_pendingMesh, m_pendingInstances.data(), m_pendingInstances.size());
+        m_drawCount++;
+    }
+    m_pendingMesh = nullptr;
+    m_pendingInstances.clear();
+}
+
+Material* CommandBackend::GetMaterial()
+{
+    return m_material;
+}
+
+bool CommandBackend::IsMaterialReady()
+{
+    return m_materialReady;
+}
+
+unsigned int CommandBackend::GetCommandCount()
+{
+    return m_commandCount;
+}
+
+unsigned int CommandBackend::GetDrawCount()
+{
+    return m_drawCount;
+}
+
+unsigned int CommandBackend::GetMaterialChanges()
+{
+    return m_materialChanges;
+}
+
+unsigned int CommandBackend::GetErrorCount()
+{
+    return m_errorCount;
+}
+
+
+bool NullCommandBackend::OnBindMaterial(Material* material)
+{
+    return true;
+}
+
+void NullCommandBackend::OnDrawMesh(Mesh* mesh)
+{
+}
+
+void NullCommandBackend::OnDrawInstanced(Mesh* mesh, const glm::mat4* matrices, unsigned int count)
+{
+}
+
+void NullCommandBackend::OnDrawInstanced(Mesh* mesh, InstanceBuffer* instances)
+{
+}
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "../header/cubeMap.h"
+#include "../header/glState.h"
 
 
 //filePaths.push_back("../assets/skyboxLeft.png");
@@ -34,43 +35,53 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 CubeMap::CubeMap(std::vector<char*> filePaths)
 {
-    // Create an OpenGL texture.
-    glGenTextures(1, &m_cubeMap);
+    // Create an OpenGL texture, as a cube map. We set it up by name, so it never has to be bound here.
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_cubeMap);
 
-    // Bind our texture as a cube map.
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeMap);
-
-    // Fill our openGL side texture object.
-    for (GLuint i = 0; i < filePaths.size(); i++)
+    // Fill our openGL side texture object, from the texture cache if the faces were compressed before.
+    // Otherwise load all six faces (in the order of GL_TEXTURE_CUBE_MAP_POSITIVE_X onwards) into one block of storage.
+    std::string cachePath = TextureCache::GetPath(filePaths, TextureCache::COLOR);
+    if (!TextureCache::Load(cachePath, filePaths, m_cubeMap, GL_TEXTURE_CUBE_MAP))
     {
-        // Load the face and convet it to 32 bit.
-        FIBITMAP* bitmap = FreeImage_ConvertTo32Bits(FreeImage_Load(FreeImage_GetFileType(filePaths[i]), filePaths[i]));
-
-        // Load the image into OpenGL memory.
-        // GL_TEXTURE_CUBE_MAP_POSITIVE_X indicates the side of the skybox. Incrementing that value gives us the constant used by each side.
-        glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA8, FreeImage_GetWidth(bitmap), FreeImage_GetHeight(bitmap),
-            0, GL_BGRA, GL_UNSIGNED_BYTE, static_cast<void*>(FreeImage_GetBits(bitmap)));
-
-        // We can unload the image now.
-        FreeImage_Unload(bitmap);
+        GLenum format = TextureCache::GetFormat(TextureCache::COLOR);
+        if (TextureCache::UploadImages(m_cubeMap, GL_TEXTURE_CUBE_MAP, filePaths, format != 0 ? format : GL_RGBA8, false) && format != 0)
+        {
+            TextureCache::Save(cachePath, m_cubeMap, GL_TEXTURE_CUBE_MAP);
+        }
     }
 
     // Set sampler parameters on our cube map.
     // These make sure the texture doesn't look pixelated.
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     // These prevent artifacts from appearing near the edges.
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    
-    // Unbind
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+CubeMap::CubeMap(unsigned char red, unsigned char green, unsigned char blue)
+{
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_cubeMap);
+
+    // Each face is a layer of the cube map's storage.
+    GLubyte pixel[4] = { blue, green, red, 255 };
+    glTextureStorage2D(m_cubeMap, 1, GL_RGBA8, 1, 1);
+    for (GLint i = 0; i < 6; i++)
+    {
+        glTextureSubImage3D(m_cubeMap, 0, 0, 0, i, 1, 1, 1, GL_BGRA, GL_UNSIGNED_BYTE, pixel);
+    }
+
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_cubeMap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 }
 
 CubeMap::~CubeMap()
 {
-    glDeleteTextures(1, &m_cubeMap);
+    GLState::DeleteTextures(1, &m_cubeMap);
 }
 
 void CubeMap::IncRefCount()
@@ -91,3 +102,9 @@ GLuint CubeMap::GetGLCubeMap()
 {
     return m_cubeMap;
 }
+
+void CubeMap::SetGLCubeMap(GLuint cubeMap)
+{
+    GLState::DeleteTextures(1, &m_cubeMap);
+    m_cubeMap = cubeMap;
+}
@@ -0,0 +1,100 @@
+/*
+Title: Instanced Rendering
+File Name: frameUniforms.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/frameUniforms.h"
+#include "../header/glState.h"
+#include <cstring>
+
+// If this fails, the struct no longer matches the std140 block in the shaders.
+static_assert(sizeof(FrameUniformData) == 496, "FrameUniformData doesn't match the std140 layout");
+
+const GLuint FrameUniforms::BINDING;
+const char* FrameUniforms::BLOCK_NAME = "FrameUniforms";
+
+FrameUniforms::FrameUniforms()
+{
+    m_data = FrameUniformData();
+    m_frame = 0;
+    for (unsigned int i = 0; i < FRAMES; i++)
+    {
+        m_fences[i] = 0;
+    }
+
+    // Each frame's data has to start on a multiple of the uniform buffer offset alignment.
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_frameSize = (sizeof(FrameUniformData) + alignment - 1) / alignment * alignment;
+
+    // Immutable storage can stay mapped while the gpu reads from it.
+    // Coherent means our writes show up without having to flush them.
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &m_buffer);
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, m_frameSize * FRAMES, nullptr, flags);
+    m_mappedData = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, m_frameSize * FRAMES, flags);
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    for (unsigned int i = 0; i < FRAMES; i++)
+    {
+        if (m_fences[i] != 0)
+        {
+            glDeleteSync(m_fences[i]);
+        }
+    }
+
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+    GLState::DeleteBuffers(1, &m_buffer);
+}
+
+FrameUniformData& FrameUniforms::GetData()
+{
+    return m_data;
+}
+
+void FrameUniforms::Upload()
+{
+    // If the gpu might still be reading this part of the buffer from a few frames ago, wait for it.
+    if (m_fences[m_frame] != 0)
+    {
+        while (glClientWaitSync(m_fences[m_frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(m_fences[m_frame]);
+        m_fences[m_frame] = 0;
+    }
+
+    memcpy(m_mappedData + m_frame * m_frameSize, &m_data, sizeof(FrameUniformData));
+
+    // Every program reads its FrameUniforms block from this binding point.
+    GLState::BindBufferRange(GL_UNIFORM_BUFFER, BINDING, m_buffer, m_frame * m_frameSize, sizeof(FrameUniformData));
+}
+
+void FrameUniforms::EndFrame()
+{
+    m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_frame = (m_frame + 1) % FRAMES;
+}
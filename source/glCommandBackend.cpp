@@ -0,0 +1,48 @@
+/*
+Title: Instanced Rendering
+File Name: glCommandBackend.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../header/glCommandBackend.h"
+#include "../header/material.h"
+#include "../header/mesh.h"
+#include "../header/instanceBuffer.h"
+
+bool GLCommandBackend::OnBindMaterial(Material* material)
+{
+    // False while the material's program is still building, which has its draws skipped.
+    return material->Bind();
+}
+
+void GLCommandBackend::OnDrawMesh(Mesh* mesh)
+{
+    mesh->Draw();
+}
+
+void GLCommandBackend::OnDrawInstanced(Mesh* mesh, const glm::mat4* matrices, unsigned int count)
+{
+    mesh->DrawInstanced(matrices, count);
+}
+
+void GLCommandBackend::OnDrawInstanced(Mesh* mesh, InstanceBuffer* instances)
+{
+    mesh->DrawInstanced(instances);
+}
@@ -0,0 +1,348 @@
+/*
+Title: Instanced Rendering
+File Name: glState.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/glState.h"
+
+GLuint GLState::s_program = 0;
+GLuint GLState::s_vertexArray = 0;
+GLuint GLState::s_buffers[BUFFER_TARGETS] = {};
+unsigned int GLState::s_activeTexture = 0;
+GLuint GLState::s_textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS] = {};
+// Both start off in a new context, and the blend function starts as one, zero.
+GLuint GLState::s_capabilities[CAPABILITIES] = {};
+GLuint GLState::s_blendSource = GL_ONE;
+GLuint GLState::s_blendDestination = GL_ZERO;
+unsigned int GLState::s_callsMade = 0;
+unsigned int GLState::s_callsSkipped = 0;
+bool GLState::s_debugUnbind = false;
+
+int GLState::TextureTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D: return 0;
+    case GL_TEXTURE_CUBE_MAP: return 1;
+    case GL_TEXTURE_2D_ARRAY: return 2;
+    default: return -1;
+    }
+}
+
+int GLState::BufferTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_ELEMENT_ARRAY_BUFFER: return 1;
+    case GL_UNIFORM_BUFFER: return 2;
+    case GL_DRAW_INDIRECT_BUFFER: return 3;
+    case GL_PIXEL_UNPACK_BUFFER: return 4;
+    case GL_PIXEL_PACK_BUFFER: return 5;
+    case GL_COPY_READ_BUFFER: return 6;
+    case GL_COPY_WRITE_BUFFER: return 7;
+    default: return -1;
+    }
+}
+
+int GLState::CapabilityIndex(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_DEPTH_TEST: return 0;
+    case GL_BLEND: return 1;
+    default: return -1;
+    }
+}
+
+void GLState::UseProgram(GLuint program)
+{
+    if (s_program == program)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    glUseProgram(program);
+    s_program = program;
+    s_callsMade++;
+}
+
+void GLState::BindVertexArray(GLuint vertexArray)
+{
+    if (s_vertexArray == vertexArray)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    glBindVertexArray(vertexArray);
+    s_vertexArray = vertexArray;
+    s_callsMade++;
+
+    // The element array buffer is part of the vertex array, so it changed too.
+    s_buffers[BufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+    int index = BufferTargetIndex(target);
+    if (index != -1 && s_buffers[index] == buffer)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    glBindBuffer(target, buffer);
+    if (index != -1)
+    {
+        s_buffers[index] = buffer;
+    }
+    s_callsMade++;
+}
+
+void GLState::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    glBindBufferRange(target, index, buffer, offset, size);
+    s_callsMade++;
+
+    int targetIndex = BufferTargetIndex(target);
+    if (targetIndex != -1)
+    {
+        s_buffers[targetIndex] = buffer;
+    }
+}
+
+void GLState::BindVertexBuffer(GLuint bindingIndex, GLuint buffer, GLintptr offset, GLsizei stride)
+{
+    glBindVertexBuffer(bindingIndex, buffer, offset, stride);
+    s_callsMade++;
+}
+
+void GLState::ActiveTexture(unsigned int unit)
+{
+    if (s_activeTexture == unit)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    s_activeTexture = unit;
+    s_callsMade++;
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+    BindTexture(s_activeTexture, target, texture);
+}
+
+void GLState::BindTexture(unsigned int unit, GLenum target, GLuint texture)
+{
+    int index = TextureTargetIndex(target);
+    if (index != -1 && unit < MAX_TEXTURE_UNITS && s_textures[unit][index] == texture)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    ActiveTexture(unit);
+    glBindTexture(target, texture);
+    if (index != -1 && unit < MAX_TEXTURE_UNITS)
+    {
+        s_textures[unit][index] = texture;
+    }
+    s_callsMade++;
+}
+
+void GLState::SetEnabled(GLenum capability, bool enabled)
+{
+    int index = CapabilityIndex(capability);
+    GLuint value = enabled ? 1 : 0;
+    if (index != -1 && s_capabilities[index] == value)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+    if (index != -1)
+    {
+        s_capabilities[index] = value;
+    }
+    s_callsMade++;
+}
+
+bool GLState::IsEnabled(GLenum capability)
+{
+    int index = CapabilityIndex(capability);
+    if (index == -1)
+    {
+        return glIsEnabled(capability) == GL_TRUE;
+    }
+    if (s_capabilities[index] == UNKNOWN)
+    {
+        s_capabilities[index] = glIsEnabled(capability) == GL_TRUE ? 1 : 0;
+    }
+    return s_capabilities[index] == 1;
+}
+
+void GLState::BlendFunc(GLenum source, GLenum destination)
+{
+    if (s_blendSource == source && s_blendDestination == destination)
+    {
+        s_callsSkipped++;
+        return;
+    }
+
+    glBlendFunc(source, destination);
+    s_blendSource = source;
+    s_blendDestination = destination;
+    s_callsMade++;
+}
+
+void GLState::GetBlendFunc(GLenum& source, GLenum& destination)
+{
+    if (s_blendSource == UNKNOWN || s_blendDestination == UNKNOWN)
+    {
+        GLint value;
+        glGetIntegerv(GL_BLEND_SRC_RGB, &value);
+        s_blendSource = value;
+        glGetIntegerv(GL_BLEND_DST_RGB, &value);
+        s_blendDestination = value;
+    }
+    source = s_blendSource;
+    destination = s_blendDestination;
+}
+
+void GLState::DeleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+    if (s_program == program)
+    {
+        // A program in use is only really deleted once it stops being used, so keep it that way until then.
+        UseProgram(0);
+    }
+}
+
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+    glDeleteVertexArrays(count, vertexArrays);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (s_vertexArray == vertexArrays[i])
+        {
+            // Deleting the bound vertex array binds 0.
+            s_vertexArray = 0;
+            s_buffers[BufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        }
+    }
+}
+
+void GLState::DeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+    glDeleteBuffers(count, buffers);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (unsigned int target = 0; target < BUFFER_TARGETS; target++)
+        {
+            if (s_buffers[target] == buffers[i])
+            {
+                s_buffers[target] = 0;
+            }
+        }
+    }
+}
+
+void GLState::DeleteTextures(GLsizei count, const GLuint* textures)
+{
+    glDeleteTextures(count, textures);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+        {
+            for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+            {
+                if (s_textures[unit][target] == textures[i])
+                {
+                    s_textures[unit][target] = 0;
+                }
+            }
+        }
+    }
+}
+
+void GLState::Invalidate()
+{
+    s_program = UNKNOWN;
+    s_vertexArray = UNKNOWN;
+    s_activeTexture = UNKNOWN;
+    s_blendSource = UNKNOWN;
+    s_blendDestination = UNKNOWN;
+    for (unsigned int i = 0; i < CAPABILITIES; i++)
+    {
+        s_capabilities[i] = UNKNOWN;
+    }
+    for (unsigned int i = 0; i < BUFFER_TARGETS; i++)
+    {
+        s_buffers[i] = UNKNOWN;
+    }
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+        {
+            s_textures[unit][target] = UNKNOWN;
+        }
+    }
+}
+
+unsigned int GLState::GetCallsMade()
+{
+    return s_callsMade;
+}
+
+unsigned int GLState::GetCallsSkipped()
+{
+    return s_callsSkipped;
+}
+
+void GLState::ResetCounters()
+{
+    s_callsMade = s_callsSkipped = 0;
+}
+
+void GLState::SetDebugUnbind(bool debugUnbind)
+{
+    s_debugUnbind = debugUnbind;
+}
+
+bool GLState::GetDebugUnbind()
+{
+    return s_debugUnbind;
+}
@@ -0,0 +1,92 @@
+/*
+Title: Instanced Rendering
+File Name: gpuTimer.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/gpuTimer.h"
+
+GpuTimer::GpuTimer()
+{
+    glGenQueries(QUERY_COUNT, m_queries);
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+    {
+        m_pending[i] = false;
+    }
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(QUERY_COUNT, m_queries);
+}
+
+void GpuTimer::Collect()
+{
+    // Queries finish in the order they were issued, so start from the oldest and stop at the first one that isn't done.
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+    {
+        unsigned int query = (m_next + i) % QUERY_COUNT;
+        if (!m_pending[query]) continue;
+
+        GLint available;
+        glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 nanoseconds;
+        glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &nanoseconds);
+        m_totalMilliseconds += nanoseconds / 1000000.0;
+        m_sampleCount++;
+        m_pending[query] = false;
+    }
+}
+
+void GpuTimer::Begin()
+{
+    Collect();
+
+    // If the gpu is so far behind that this query is still in use, skip timing this time around.
+    if (m_pending[m_next]) return;
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+    m_running = true;
+}
+
+void GpuTimer::End()
+{
+    if (!m_running) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_running = false;
+    m_pending[m_next] = true;
+    m_next = (m_next + 1) % QUERY_COUNT;
+}
+
+double GpuTimer::GetAverageMilliseconds()
+{
+    Collect();
+    return m_sampleCount > 0 ? m_totalMilliseconds / m_sampleCount : 0;
+}
+
+void GpuTimer::ResetAverage()
+{
+    m_totalMilliseconds = 0;
+    m_sampleCount = 0;
+}
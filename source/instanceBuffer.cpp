@@ -0,0 +1,296 @@
+/*
+Title: Instanced Rendering
+File Name: instanceBuffer.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/instanceBuffer.h"
+#include "../header/glState.h"
+#include <algorithm>
+#include <iostream>
+
+// Dirty slots this close together are uploaded as one range.
+// Sending a few clean matrices along is cheaper than another call into the driver.
+static const unsigned int MERGE_GAP = 4;
+
+InstanceBuffer::InstanceBuffer()
+{
+    m_buffer = m_motionBuffer = 0;
+    m_capacity = 0;
+    m_bytesUploaded = 0;
+    m_rangesUploaded = 0;
+    m_center = glm::vec3();
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    // Detach any transforms still pointing at us.
+    for (unsigned int i = 0; i < m_transforms.size(); i++)
+    {
+        if (m_transforms[i] != nullptr)
+        {
+            m_transforms[i]->SetInstanceSlot(nullptr, 0);
+        }
+    }
+
+    if (m_buffer != 0)
+    {
+        GLState::DeleteBuffers(1, &m_buffer);
+        GLState::DeleteBuffers(1, &m_motionBuffer);
+    }
+}
+
+unsigned int InstanceBuffer::AddInstance(Transform3D* transform)
+{
+    unsigned int slot = AddInstance(transform->GetMatrix());
+    m_transforms[slot] = transform;
+    transform->SetInstanceSlot(this, slot);
+    return slot;
+}
+
+unsigned int InstanceBuffer::AddInstance(glm::mat4 matrix)
+{
+    unsigned int slot;
+
+    // Reuse a free slot if there is one, otherwise add one to the end.
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_slotFree[slot] = false;
+        m_matrices[slot] = matrix;
+        m_transforms[slot] = nullptr;
+    }
+    else
+    {
+        slot = m_matrices.size();
+        m_matrices.push_back(matrix);
+        m_motions.push_back(InstanceMotion());
+        m_transforms.push_back(nullptr);
+        m_slotDirty.push_back(false);
+        m_motionDirty.push_back(false);
+        m_slotFree.push_back(false);
+    }
+
+    MarkDirty(slot);
+    return slot;
+}
+
+void InstanceBuffer::RemoveInstance(unsigned int slot)
+{
+    // Listing a slot as free twice would hand it to two instances later.
+    if (slot >= m_slotFree.size() || m_slotFree[slot])
+    {
+        std::cout << "Error: Can't remove instance slot " << slot << ", it isn't in use!" << std::endl;
+        return;
+    }
+
+    if (m_transforms[slot] != nullptr)
+    {
+        m_transforms[slot]->SetInstanceSlot(nullptr, 0);
+        m_transforms[slot] = nullptr;
+    }
+
+    // A zero matrix collapses every vertex to the same point, so nothing gets rasterized.
+    m_matrices[slot] = glm::mat4(0);
+    MarkDirty(slot);
+    SetMotion(slot, InstanceMotion());
+    m_freeSlots.push_back(slot);
+    m_slotFree[slot] = true;
+}
+
+void InstanceBuffer::MoveInstance(unsigned int slot, Transform3D* transform)
+{
+    m_transforms[slot] = transform;
+}
+
+void InstanceBuffer::SetMatrix(unsigned int slot, glm::mat4 matrix)
+{
+    m_matrices[slot] = matrix;
+    MarkDirty(slot);
+}
+
+void InstanceBuffer::SetMotion(unsigned int slot, InstanceMotion motion)
+{
+    m_motions[slot] = motion;
+
+    if (!m_motionDirty[slot])
+    {
+        m_motionDirty[slot] = true;
+        m_dirtyMotionSlots.push_back(slot);
+    }
+}
+
+void InstanceBuffer::MarkDirty(unsigned int slot)
+{
+    if (!m_slotDirty[slot])
+    {
+        m_slotDirty[slot] = true;
+        m_dirtySlots.push_back(slot);
+    }
+}
+
+void InstanceBuffer::Update()
+{
+    m_bytesUploaded = 0;
+    m_rangesUploaded = 0;
+
+    if (m_buffer == 0)
+    {
+        glGenBuffers(1, &m_buffer);
+        glGenBuffers(1, &m_motionBuffer);
+    }
+
+    // Pull new matrices from any transforms that changed.
+    for (unsigned int i = 0; i < m_dirtySlots.size(); i++)
+    {
+        unsigned int slot = m_dirtySlots[i];
+        if (m_transforms[slot] != nullptr)
+        {
+            m_matrices[slot] = m_transforms[slot]->GetMatrix();
+        }
+    }
+    // Anything that moved, appeared or went away can move the middle.
+    if (!m_dirtySlots.empty())
+    {
+        UpdateCenter();
+    }
+
+    if (m_capacity < m_matrices.size())
+    {
+        // The gpu buffers are too small, so reallocate them with some room to grow, and upload everything.
+        m_capacity = m_matrices.size() + m_matrices.size() / 2;
+
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_matrices.size() * sizeof(glm::mat4), m_matrices.data());
+
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_motionBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(InstanceMotion), nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_motions.size() * sizeof(InstanceMotion), m_motions.data());
+
+        m_bytesUploaded = m_matrices.size() * (sizeof(glm::mat4) + sizeof(InstanceMotion));
+        m_rangesUploaded = 2;
+
+        // Everything is up to date now.
+        for (unsigned int i = 0; i < m_dirtySlots.size(); i++) m_slotDirty[m_dirtySlots[i]] = false;
+        for (unsigned int i = 0; i < m_dirtyMotionSlots.size(); i++) m_motionDirty[m_dirtyMotionSlots[i]] = false;
+        m_dirtySlots.clear();
+        m_dirtyMotionSlots.clear();
+    }
+    else
+    {
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        UploadRanges(m_dirtySlots, m_slotDirty, (const char*)m_matrices.data(), sizeof(glm::mat4));
+
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_motionBuffer);
+        UploadRanges(m_dirtyMotionSlots, m_motionDirty, (const char*)m_motions.data(), sizeof(InstanceMotion));
+    }
+
+    if (GLState::GetDebugUnbind()) GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::UpdateCenter()
+{
+    bool found = false;
+    glm::vec3 low;
+    glm::vec3 high;
+    for (unsigned int i = 0; i < m_matrices.size(); i++)
+    {
+        // Free slots hold a zero matrix, and aren't anywhere.
+        if (m_matrices[i][3][3] == 0) continue;
+
+        glm::vec3 position = glm::vec3(m_matrices[i][3]);
+        low = found ? glm::min(low, position) : position;
+        high = found ? glm::max(high, position) : position;
+        found = true;
+    }
+    m_center = (low + high) * .5f;
+}
+
+void InstanceBuffer::UploadRanges(std::vector<unsigned int>& dirtySlots, std::vector<bool>& slotDirty, const char* data, unsigned int stride)
+{
+    if (dirtySlots.empty()) return;
+
+    // Sort the dirty slots so neighbours can be merged into ranges.
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+
+    unsigned int rangeStart = dirtySlots[0];
+    unsigned int rangeEnd = rangeStart + 1;
+    for (unsigned int i = 1; i <= dirtySlots.size(); i++)
+    {
+        // Keep growing the range while the next dirty slot is close enough.
+        if (i < dirtySlots.size() && dirtySlots[i] <= rangeEnd + MERGE_GAP)
+        {
+            rangeEnd = dirtySlots[i] + 1;
+            continue;
+        }
+
+        // Otherwise upload the range, and start a new one.
+        unsigned int rangeSize = (rangeEnd - rangeStart) * stride;
+        glBufferSubData(GL_ARRAY_BUFFER, rangeStart * stride, rangeSize, data + rangeStart * stride);
+        m_bytesUploaded += rangeSize;
+        m_rangesUploaded++;
+
+        if (i < dirtySlots.size())
+        {
+            rangeStart = dirtySlots[i];
+            rangeEnd = rangeStart + 1;
+        }
+    }
+
+    // Those slots are up to date now.
+    for (unsigned int i = 0; i < dirtySlots.size(); i++)
+    {
+        slotDirty[dirtySlots[i]] = false;
+    }
+    dirtySlots.clear();
+}
+
+GLuint InstanceBuffer::GetGLBuffer()
+{
+    return m_buffer;
+}
+
+GLuint InstanceBuffer::GetGLMotionBuffer()
+{
+    return m_motionBuffer;
+}
+
+unsigned int InstanceBuffer::GetCount()
+{
+    return m_matrices.size();
+}
+
+unsigned int InstanceBuffer::GetBytesUploaded()
+{
+    return m_bytesUploaded;
+}
+
+unsigned int InstanceBuffer::GetRangesUploaded()
+{
+    return m_rangesUploaded;
+}
+
+glm::vec3 InstanceBuffer::GetCenter()
+{
+    return m_center;
+}
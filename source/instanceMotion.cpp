@@ -0,0 +1,66 @@
+/*
+Title: Instanced Rendering
+File Name: instanceMotion.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/instanceMotion.h"
+
+InstanceMotion::InstanceMotion()
+{
+    // A speed, frequency and amplitude of zero leave the matrix alone.
+    m_spin = glm::vec4(0, 1, 0, 0);
+    m_orbit = glm::vec4();
+    m_bob = glm::vec4();
+    m_phase = glm::vec4();
+}
+
+void InstanceMotion::SetSpin(glm::vec3 axis, float speed, float phase)
+{
+    // The shader expects a unit length axis. A zero axis has no direction to normalize, so it means no spin at all.
+    if (glm::dot(axis, axis) > 0)
+    {
+        m_spin = glm::vec4(glm::normalize(axis), speed);
+    }
+    else
+    {
+        m_spin = glm::vec4(0, 1, 0, 0);
+    }
+    m_phase.x = phase;
+}
+
+void InstanceMotion::SetOrbit(glm::vec3 center, float speed, float phase)
+{
+    m_orbit = glm::vec4(center, speed);
+    m_phase.y = phase;
+}
+
+void InstanceMotion::SetBob(glm::vec3 direction, float amplitude, float frequency, float phase)
+{
+    // A zero direction can't be normalized, and doesn't bob anywhere anyway.
+    glm::vec3 offset(0);
+    if (glm::dot(direction, direction) > 0)
+    {
+        offset = glm::normalize(direction) * amplitude;
+    }
+    m_bob = glm::vec4(offset, frequency);
+    m_phase.z = phase;
+}
@@ -0,0 +1,133 @@
+/*
+Title: Instanced Rendering
+File Name: instanceSorter.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/instanceSorter.h"
+#include "../header/radixSort.h"
+#include <cstring>
+
+// Turns a view space depth into a 16 bit key that sorts in the same order.
+static unsigned int DepthKey(float depth)
+{
+    // Positive floats already compare correctly when read as integers, negatives compare backwards.
+    // Flipping the bits of negatives (and setting the sign bit of positives) puts everything in one increasing order.
+    unsigned int bits;
+    memcpy(&bits, &depth, sizeof(float));
+    bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+
+    // Sign, exponent and 7 bits of mantissa are plenty to order draws, and halve the radix passes.
+    return bits >> 16;
+}
+
+InstanceSorter::InstanceSorter()
+{
+    m_enabled = true;
+    m_jobs = nullptr;
+}
+
+void InstanceSorter::SetEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+bool InstanceSorter::GetEnabled()
+{
+    return m_enabled;
+}
+
+void InstanceSorter::SetJobSystem(JobSystem* jobs)
+{
+    m_jobs = jobs;
+}
+
+const std::vector<glm::mat4>& InstanceSorter::Sort(const std::vector<glm::mat4>& matrices, glm::mat4 view)
+{
+    // Nothing to do. Forget the old order too, since it'll be out of date by the time sorting is turned back on.
+    if (!m_enabled)
+    {
+        m_order.clear();
+        return matrices;
+    }
+
+    unsigned int count = matrices.size();
+
+    // If the instance count changed, last frame's order is meaningless, so start over.
+    bool reset = m_order.size() != count;
+    if (reset)
+    {
+        m_order.resize(count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            m_order[i] = i;
+        }
+    }
+
+    // Calculate the depth of each instance in last frame's order.
+    // Only the z row of the view matrix matters, and we flip it so that depth increases away from the camera.
+    m_keys.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const glm::vec4& position = matrices[m_order[i]][3];
+        float depth = -(view[0][2] * position.x + view[1][2] * position.y + view[2][2] * position.z + view[3][2]);
+        m_keys[i] = DepthKey(depth);
+    }
+
+    // Things don't move much from one frame to the next, so last frame's order is usually almost right.
+    // An insertion sort fixes that up in close to linear time, but if it has to shuffle too much, we give up and radix sort.
+    bool sorted = !reset;
+    unsigned int movesLeft = count;
+    for (unsigned int i = 1; i < count && sorted; i++)
+    {
+        unsigned int key = m_keys[i];
+        unsigned int index = m_order[i];
+        unsigned int j = i;
+        while (j > 0 && m_keys[j - 1] > key)
+        {
+            if (movesLeft == 0)
+            {
+                sorted = false;
+                break;
+            }
+            movesLeft--;
+            m_keys[j] = m_keys[j - 1];
+            m_order[j] = m_order[j - 1];
+            j--;
+        }
+        m_keys[j] = key;
+        m_order[j] = index;
+    }
+
+    if (!sorted)
+    {
+        RadixSort(m_keys, m_order, 2, m_jobs);
+    }
+
+    // Copy the matrices out in their new order.
+    m_sorted.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        m_sorted[i] = matrices[m_order[i]];
+    }
+
+    return m_sorted;
+}
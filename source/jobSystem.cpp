@@ -0,0 +1,345 @@
+/*
+Title: Instanced Rendering
+File Name: jobSystem.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/jobSystem.h"
+
+// Which thread we are, so each thread can find its own queue. The thread that made the job system is 0.
+static thread_local unsigned int t_threadIndex = 0;
+
+// How many times an idle worker looks for jobs before going to sleep.
+static const int SPINS_BEFORE_SLEEP = 64;
+
+
+
+JobQueue::JobQueue()
+{
+    m_top = 0;
+    m_bottom = 0;
+    for (unsigned int i = 0; i < CAPACITY; i++)
+    {
+        m_jobs[i] = nullptr;
+    }
+}
+
+bool JobQueue::Push(Job* job)
+{
+    long long bottom = m_bottom.load(std::memory_order_relaxed);
+    long long top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY)
+    {
+        return false;
+    }
+
+    m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    // The job has to be visible before the new bottom is, or a thief could take a stale pointer.
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* JobQueue::Pop()
+{
+    long long bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    // Claim the bottom slot before looking at top, so we and a thief can't both think we got it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty, put bottom back.
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // This is the last job, so we race any thieves for it.
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobQueue::Steal()
+{
+    long long top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    // Someone else (the owner or another thief) might have taken it first.
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    if (workerCount == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    // One set of data for the calling thread, and one for each worker.
+    for (unsigned int i = 0; i < workerCount + 1; i++)
+    {
+        ThreadData* data = new ThreadData();
+        data->m_jobs = new Job[JOBS_PER_THREAD];
+        data->m_nextJob = 0;
+        m_threadData.push_back(data);
+    }
+
+    t_threadIndex = 0;
+    m_running = true;
+    m_sleepingWorkers = 0;
+    m_pushCount = 0;
+    for (unsigned int i = 1; i < workerCount + 1; i++)
+    {
+        m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    // Wake everyone up and let them see that we're done.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_running = false;
+    }
+    m_wakeUp.notify_all();
+
+    for (unsigned int i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+
+    for (unsigned int i = 0; i < m_threadData.size(); i++)
+    {
+        delete[] m_threadData[i]->m_jobs;
+        delete m_threadData[i];
+    }
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+    return (unsigned int)m_threadData.size();
+}
+
+
+
+void JobSystem::WorkerLoop(unsigned int threadIndex)
+{
+    t_threadIndex = threadIndex;
+
+    int spins = 0;
+    while (m_running)
+    {
+        // Read this before looking, so any push we might miss while looking is a push we'll notice before sleeping.
+        unsigned int pushCount = m_pushCount;
+        Job* job = GetJob();
+        if (job)
+        {
+            Execute(job);
+            spins = 0;
+            continue;
+        }
+
+        // Nothing to do. Give the core away for a bit, and eventually go to sleep until there's more work.
+        if (++spins < SPINS_BEFORE_SLEEP)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingWorkers++;
+        // Only sleep if nothing was pushed since we last looked. Either we see the push here, or the pusher sees us
+        // sleeping and wakes us up, since both sides count before they check the other's count.
+        m_wakeUp.wait(lock, [this, pushCount]() { return !m_running || m_pushCount != pushCount; });
+        m_sleepingWorkers--;
+        spins = 0;
+    }
+}
+
+JobSystem::ThreadData* JobSystem::GetThreadData()
+{
+    return m_threadData[t_threadIndex];
+}
+
+Job* JobSystem::AllocateJob()
+{
+    ThreadData* data = GetThreadData();
+    Job* job = &data->m_jobs[data->m_nextJob];
+    data->m_nextJob = (data->m_nextJob + 1) & (JOBS_PER_THREAD - 1);
+    return job;
+}
+
+Job* JobSystem::GetJob()
+{
+    Job* job = GetThreadData()->m_queue.Pop();
+    if (job)
+    {
+        return job;
+    }
+
+    // Our queue is empty, so try to take work from everyone else, starting with our neighbor.
+    unsigned int count = (unsigned int)m_threadData.size();
+    for (unsigned int i = 1; i < count; i++)
+    {
+        job = m_threadData[(t_threadIndex + i) % count]->m_queue.Steal();
+        if (job)
+        {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Push(Job* job)
+{
+    // If our queue is full, just do the job right now.
+    if (!GetThreadData()->m_queue.Push(job))
+    {
+        Execute(job);
+        return;
+    }
+
+    m_pushCount++;
+    if (m_sleepingWorkers > 0)
+    {
+        // Taking the lock means a worker is either asleep already, or will still see the new push count.
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeUp.notify_one();
+    }
+}
+
+void JobSystem::Execute(Job* job)
+{
+    if (job->m_call)
+    {
+        job->m_call(job);
+    }
+    Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+    if (--job->m_unfinished != 0)
+    {
+        // Still waiting on children.
+        return;
+    }
+
+    // Grab everything we need before telling anyone, since the job can be reused once it's finished.
+    Job* parent = job->m_parent;
+    int continuationCount = job->m_continuationCount;
+    Job* continuations[Job::MAX_CONTINUATIONS];
+    for (int i = 0; i < continuationCount; i++)
+    {
+        continuations[i] = job->m_continuations[i];
+    }
+
+    // Start anything that was only waiting on us.
+    for (int i = 0; i < continuationCount; i++)
+    {
+        if (--continuations[i]->m_waitingOn == 0)
+        {
+            Push(continuations[i]);
+        }
+    }
+
+    if (parent)
+    {
+        Finish(parent);
+    }
+}
+
+
+
+Job* JobSystem::CreateEmptyJob()
+{
+    Job* job = AllocateJob();
+    job->m_call = nullptr;
+    job->m_parent = nullptr;
+    job->m_unfinished = 1;
+    job->m_waitingOn = 1;
+    job->m_continuationCount = 0;
+    return job;
+}
+
+bool JobSystem::AddDependency(Job* job, Job* dependency)
+{
+    int index = dependency->m_continuationCount++;
+    if (index >= Job::MAX_CONTINUATIONS)
+    {
+        dependency->m_continuationCount--;
+        return false;
+    }
+
+    job->m_waitingOn++;
+    dependency->m_continuations[index] = job;
+    return true;
+}
+
+void JobSystem::Run(Job* job)
+{
+    // Running counts as one of the things the job waits on, so it won't start early if its dependencies finish first.
+    if (--job->m_waitingOn == 0)
+    {
+        Push(job);
+    }
+}
+
+void JobSystem::Wait(Job* job)
+{
+    // Help out instead of just sitting here.
+    while (job->m_unfinished > 0)
+    {
+        Job* other = GetJob();
+        if (other)
+        {
+            Execute(other);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
@@ -33,9 +33,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../header/fpsController.h"
 #include "../header/transform3d.h"
 #include "../header/material.h"
+#include "../header/shaderVariants.h"
 #include "../header/texture.h"
+#include "../header/textureArray.h"
 #include "../header/cubeMap.h"
+#include "../header/instanceBuffer.h"
+#include "../header/instanceSorter.h"
+#include "../header/meshBatch.h"
+#include "../header/transformSystem.h"
+#include "../header/jobSystem.h"
+#include "../header/sceneGraph.h"
+#include "../header/spriteBatch.h"
+#include "../header/frameUniforms.h"
+#include "../header/glState.h"
+#include "../header/renderQueue.h"
+#include "../header/commandBuffer.h"
+#include "../header/gpuTimer.h"
+#include "../header/textureStreamer.h"
 #include <iostream>
+#include <chrono>
 
 
 
@@ -94,34 +110,151 @@ int main(int argc, char **argv)
         transforms.push_back(transform);
     }
 
+    // Give every transform its own slot in an instance buffer.
+    // From here on, a transform flags its slot whenever it changes, and only changed slots get uploaded.
+    // (Slots follow their transforms if the vector moves them, and are freed when the transforms are destroyed.)
+    InstanceBuffer* instances = new InstanceBuffer();
+    for (int i = 0; i < transforms.size(); i++)
+    {
+        unsigned int slot = instances->AddInstance(&transforms[i]);
 
-    // Make a first person controller for the camera.
-    FPSController controller = FPSController();
+        // Instead of rotating every transform on the cpu each frame, we tell the vertex shader to spin them.
+        // (This matches what calling RotateY(dt) every frame used to do.)
+        InstanceMotion motion;
+        motion.SetSpin(glm::vec3(0, 1, 0), -1);
+        instances->SetMotion(slot, motion);
+    }
+
+
+    // A floor of cubes under the grid, with a buckler on display on every other tile.
+    // The bucklers are drawn from command buffers recorded on worker threads (see below), and the floor gets its own textured draw.
+    MeshBatch* batch = new MeshBatch();
+    std::vector<glm::mat4> floorTiles;
+    // The bucklers on display turn slowly on the cpu, so their transforms live in a transform system.
+    TransformSystem displaySystem;
+    // The floor never moves, so the middle of it (for sorting by depth) only has to be found once.
+    glm::vec3 floorLow = glm::vec3(0, -1.5f, 0);
+    glm::vec3 floorHigh = floorLow;
+    for (int i = 0; i < 100; i++)
+    {
+        Transform3D tile;
+        tile.SetPosition(glm::vec3(i % 10, -1.5f, i / 10));
+        floorTiles.push_back(tile.GetMatrix());
+        floorLow = glm::min(floorLow, tile.Position());
+        floorHigh = glm::max(floorHigh, tile.Position());
+
+        if (i % 2 == 0)
+        {
+            displaySystem.Add(glm::vec3(i % 10, -1, i / 10), glm::vec3(0, 0, 0), .8f);
+        }
+    }
+    glm::vec3 floorCenter = (floorLow + floorHigh) * .5f;
+
+
+    // Every frame the displayed bucklers are turned, culled against the camera, and the visible ones are drawn.
+    // That work gets split into small batches and spread over every core by a job system.
+    // Each batch records its draw into its own command buffer, which the main thread replays with opengl.
+    JobSystem* jobs = new JobSystem();
+    const unsigned int DISPLAY_BATCH = 16;
+    std::vector<glm::mat4> displayMatrices(displaySystem.GetCount());
+    std::vector<CommandBuffer*> displayCommands((displaySystem.GetCount() + DISPLAY_BATCH - 1) / DISPLAY_BATCH);
+    for (unsigned int i = 0; i < displayCommands.size(); i++)
+    {
+        displayCommands[i] = new CommandBuffer();
+    }
+
+
+    // A mobile hanging over the grid: a turning hub, with four cubes on it, each holding up a spinning buckler.
+    // Every piece is only placed relative to its parent, and the scene graph works out where they all end up.
+    SceneGraph* scene = new SceneGraph();
+    Transform3D hubTransform;
+    hubTransform.SetPosition(glm::vec3(4.5f, 12, 4.5f));
+    unsigned int hub = scene->AddNode(SceneGraph::NO_NODE, hubTransform.GetMatrix());
+    std::vector<unsigned int> mobileCubes;
+    std::vector<unsigned int> mobileBucklers;
+    std::vector<Transform3D> mobileBucklerTransforms(4);
+    for (int i = 0; i < 4; i++)
+    {
+        Transform3D cubeTransform;
+        cubeTransform.SetPosition(glm::vec3(cos(i * 1.5708f) * 3, 0, sin(i * 1.5708f) * 3));
+        cubeTransform.SetScale(.5f);
+        mobileCubes.push_back(scene->AddNode(hub, cubeTransform.GetMatrix()));
+
+        // The buckler is scaled and moved in the cube's space, so this ends up a full size buckler 1.5 units above it.
+        mobileBucklerTransforms[i].SetPosition(glm::vec3(0, 3, 0));
+        mobileBucklerTransforms[i].SetScale(2);
+        mobileBucklers.push_back(scene->AddNode(mobileCubes[i], mobileBucklerTransforms[i].GetMatrix()));
+    }
+    std::vector<glm::mat4> mobileCubeMatrices(mobileCubes.size());
+    std::vector<glm::mat4> mobileBucklerMatrices(mobileBucklers.size());
 
 
-	// Create Shaders
-    Shader* vertexShader = new Shader("../shaders/vertex.glsl", GL_VERTEX_SHADER);
-    Shader* fragmentShader = new Shader("../shaders/diffuseNormalFrag.glsl", GL_FRAGMENT_SHADER);
+    // Make a first person controller for the camera.
+    FPSController controller = FPSController();
 
-    // Create A Shader Program
-    ShaderProgram* shaderProgram = new ShaderProgram();
-    shaderProgram->AttachShader(vertexShader);
-    shaderProgram->AttachShader(fragmentShader);
+    // Sorts the floor tiles front to back every frame, so hidden fragments get rejected by the depth test early.
+    // (The instance buffer keeps its slots in a fixed order, so it can't be sorted like this.)
+    InstanceSorter floorSorter;
+    floorSorter.SetJobSystem(jobs);
+    bool sortKeyDown = false;
+    bool batchKeyDown = false;
+
+
+    // Programs are saved to the program cache the first time they're built, so later runs start faster.
+    // Each program starts building as soon as it has its shaders, and the driver works on them all at once
+    // (on its own threads, if it supports parallel compiling). Nothing waits for them: until a program is ready,
+    // draws with it are skipped, or use a fallback material.
+    std::chrono::steady_clock::time_point shaderStartTime = std::chrono::steady_clock::now();
+    bool shadersReady = false;
+
+    // Textures stream in the same way. They start as placeholders, and fill in over the first few frames,
+    // while loader threads decode them and the streamer sends them up a bit at a time.
+    TextureStreamer* textureStreamer = new TextureStreamer();
+    bool texturesReady = false;
+
+    // The lit shaders can be built with or without a normal map and a texture array.
+    // Each combination is its own program, built the first time something asks for it.
+    ShaderVariants* litShaders = new ShaderVariants("../shaders/vertex.glsl", "../shaders/diffuseNormalFrag.glsl");
+    uint32_t NORMAL_MAP = litShaders->GetKeyword("NORMAL_MAP");
+    uint32_t TEXTURE_ARRAY = litShaders->GetKeyword("TEXTURE_ARRAY");
+    ShaderProgram* shaderProgram = litShaders->GetProgram(NORMAL_MAP);
 
     // Create a material using a texture for our model
     Material* diffuseNormalMat = new Material(shaderProgram);
-    diffuseNormalMat->SetTexture("diffuseMap", new Texture("../assets/iron_buckler_diffuse.png"));
-    Texture* texNorm = new Texture("../assets/iron_buckler_normal.png");
+    Texture* texDiffuse = textureStreamer->LoadTexture("../assets/iron_buckler_diffuse.png");
+    diffuseNormalMat->SetTexture("diffuseMap", texDiffuse);
+    Texture* texNorm = textureStreamer->LoadTexture("../assets/iron_buckler_normal.png", TextureCache::NORMAL_MAP);
     diffuseNormalMat->SetTexture("normalMap", texNorm);
+    diffuseNormalMat->SetVec4("tint", glm::vec4(1, 1, 1, 1));
+
+    // The floor tiles each get a different look, but still share one material.
+    // Their diffuse textures are layers of a texture array, and each tile's matrix says which layer it uses,
+    // so the whole floor is still a single instanced draw.
+    Material* floorMat = new Material(litShaders->GetProgram(NORMAL_MAP | TEXTURE_ARRAY));
+    TextureArray* floorTextures = new TextureArray(512, 512, 4);
+    floorTextures->AddLayer("../assets/iron_buckler_diffuse.png");
+    floorTextures->AddLayer("../assets/skyboxBottom.png");
+    floorTextures->AddLayer("../assets/skyboxTop.png");
+    floorTextures->AddLayer("../assets/skyboxFront.png");
+    floorMat->SetTextureArray("diffuseMaps", floorTextures);
+    floorMat->SetTexture("normalMap", texNorm);
+    floorMat->SetVec4("tint", glm::vec4(.8f, .8f, .8f, 1));
+    // While its own program builds, draw the floor with the buckler material.
+    floorMat->SetFallback(diffuseNormalMat);
+    for (unsigned int i = 0; i < floorTiles.size() && floorTextures->GetLayerCount() > 0; i++)
+    {
+        TextureArray::SetLayer(floorTiles[i], (i + i / 10) % floorTextures->GetLayerCount());
+    }
 
 
-    Shader* skyboxVertexShader = new Shader("../shaders/skyboxvertex.glsl", GL_VERTEX_SHADER);
-    Shader* skyboxfragmentShader = new Shader("../shaders/skyboxfragment.glsl", GL_FRAGMENT_SHADER);
+    Shader* skyboxVertexShader = new Shader("../shaders/skyboxVertex.glsl", GL_VERTEX_SHADER);
+    Shader* skyboxfragmentShader = new Shader("../shaders/skyboxFragment.glsl", GL_FRAGMENT_SHADER);
 
     // Create A Shader Program for the skybox
     ShaderProgram* skyboxShaderProgram = new ShaderProgram();
     skyboxShaderProgram->AttachShader(skyboxVertexShader);
     skyboxShaderProgram->AttachShader(skyboxfragmentShader);
+    skyboxShaderProgram->StartBuild();
 
     // Create material for skybox
     Material* skyMat = new Material(skyboxShaderProgram);
@@ -134,16 +267,65 @@ int main(int argc, char **argv)
     faceFilePaths.push_back("../assets/skyboxFront.png");
 
     // The cube map class just saves time by holding all the previous cube map loading code
-    CubeMap* sky = new CubeMap(faceFilePaths);
+    CubeMap* sky = textureStreamer->LoadCubeMap(faceFilePaths);
     skyMat->SetCubeMap("cubeMap", sky);
 
+    // Shaders and material for 2d sprites drawn over the scene.
+    Shader* spriteVertexShader = new Shader("../shaders/spriteVertex.glsl", GL_VERTEX_SHADER);
+    Shader* spriteFragmentShader = new Shader("../shaders/spriteFragment.glsl", GL_FRAGMENT_SHADER);
+    ShaderProgram* spriteShaderProgram = new ShaderProgram();
+    spriteShaderProgram->AttachShader(spriteVertexShader);
+    spriteShaderProgram->AttachShader(spriteFragmentShader);
+    spriteShaderProgram->StartBuild();
+    Material* spriteMat = new Material(spriteShaderProgram);
+
+    // A strip of icons along the bottom of the screen, alternating between the two buckler textures.
+    // Each one is its own sprite, but the sprite batch only needs one draw call per texture.
+    SpriteBatch* sprites = new SpriteBatch();
+    sprites->SetJobSystem(jobs);
+    std::vector<Transform2D> icons(32);
+    for (unsigned int i = 0; i < icons.size(); i++)
+    {
+        icons[i].SetRotation(i * .4f);
+    }
+
+
+    // The camera, time and lights are shared by every shader, so they go in one uniform buffer that's written once a frame.
+    FrameUniforms* frameUniforms = new FrameUniforms();
+    FrameUniformData& frameData = frameUniforms->GetData();
+    frameData.m_ambientLight = glm::vec4(.1, .1, .2, 1);
+    frameData.m_lightCount = 1;
+    frameData.m_lights[0].m_position = glm::vec4(1000, 500, 100, 2000);
+    frameData.m_lights[0].m_color = glm::vec4(1, 1, 1, 1);
+    frameData.m_lights[0].m_attenuation = glm::vec4(1, 1, 0, 0);
+
+    // Sorts each frame's draws to keep state changes down.
+    RenderQueue* renderQueue = new RenderQueue();
+    renderQueue->SetJobSystem(jobs);
+
+    // Look up the uniforms that get set every frame once, instead of by name each time.
+    // (Locations are only known once the program is ready, so this one gets filled in then.)
+    GLint screenSizeUniform = -1;
+
+
     // Print instructions to the console.
     std::cout << "Use WASD to move, and the mouse to look around." << std::endl;
+    std::cout << "Press M to turn mipmapping on and off." << std::endl;
+    std::cout << "Press O to turn front to back sorting of the floor on and off." << std::endl;
+    std::cout << "Press B to turn batching of the mobile on and off, to measure draws and state changes both ways." << std::endl;
     std::cout << "Press escape or alt-f4 to exit." << std::endl;
 
 
     float frames = 0;
     float secCounter = 0;
+    // Total time passed, used by the shader to animate instances.
+    float time = 0;
+
+    // Times the scene on the gpu, so mipmapping can be compared on and off.
+    // Far away bucklers read far fewer texels from a small mip level, and that shows up here.
+    GpuTimer* sceneTimer = new GpuTimer();
+    bool mipmapping = true;
+    bool mipmapKeyDown = false;
 
 	// Main Loop
 	while (!glfwWindowShouldClose(window))
@@ -151,34 +333,106 @@ int main(int argc, char **argv)
         // Exit when escape is pressed.
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) break;
 
+        // Switch mipmapping when M is pressed (not every frame it's held).
+        bool mipmapKey = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+        if (mipmapKey && !mipmapKeyDown)
+        {
+            mipmapping = !mipmapping;
+            texDiffuse->SetMipmapping(mipmapping);
+            texNorm->SetMipmapping(mipmapping);
+            floorTextures->SetMipmapping(mipmapping);
+            sceneTimer->ResetAverage();
+            std::cout << "Mipmapping " << (mipmapping ? "on" : "off") << std::endl;
+        }
+        mipmapKeyDown = mipmapKey;
+
+        // The same for sorting.
+        bool sortKey = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+        if (sortKey && !sortKeyDown)
+        {
+            floorSorter.SetEnabled(!floorSorter.GetEnabled());
+            sceneTimer->ResetAverage();
+            std::cout << "Floor sorting " << (floorSorter.GetEnabled() ? "on" : "off") << std::endl;
+        }
+        sortKeyDown = sortKey;
+
+        bool batchKey = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+        if (batchKey && !batchKeyDown)
+        {
+            batch->SetBatching(!batch->GetBatching());
+            std::cout << "Mobile batching " << (batch->GetBatching() ? "on" : "off") << std::endl;
+        }
+        batchKeyDown = batchKey;
+
         // Calculate delta time and frame rate
         float dt = glfwGetTime();
         frames++;
         secCounter += dt;
         if (secCounter > 1.f)
         {
-            std::string title = "All the things! FPS: " + std::to_string(frames);
+            std::string title = "All the things! FPS: " + std::to_string(frames) +
+                " Instance upload: " + std::to_string(instances->GetBytesUploaded()) + " bytes/frame" +
+                " Batch: " + std::to_string(batch->GetDrawCalls()) + " draws, " + std::to_string(batch->GetStateChanges()) + " state changes" +
+                " (unbatched, measured with B: " + std::to_string(batch->GetUnbatchedDrawCalls()) + " draws, " + std::to_string(batch->GetUnbatchedStateChanges()) + " state changes)" +
+                " Sprites: " + std::to_string(sprites->GetSpriteCount()) + " in " + std::to_string(sprites->GetDrawCalls()) + " draws" +
+                " Commands: " + std::to_string(renderQueue->GetCommandBackend().GetCommandCount()) + " in " + std::to_string(renderQueue->GetCommandBackend().GetDrawCount()) + " draws" +
+                " Queue: " + std::to_string(renderQueue->GetDrawCount()) + " draws, " + std::to_string(renderQueue->GetProgramChanges()) + " programs, " +
+                std::to_string(renderQueue->GetMaterialChanges()) + " materials, " + std::to_string(renderQueue->GetMeshChanges()) + " meshes" +
+                " GL binds: " + std::to_string(GLState::GetCallsMade() / frames) + " made, " + std::to_string(GLState::GetCallsSkipped() / frames) + " skipped per frame" +
+                " Scene gpu time: " + std::to_string(sceneTimer->GetAverageMilliseconds()) + " ms (mipmapping " + (mipmapping ? "on" : "off") + ")";
+            GLState::ResetCounters();
+            sceneTimer->ResetAverage();
             glfwSetWindowTitle(window, title.c_str());
             secCounter = 0;
             frames = 0;
         }
         glfwSetTime(0);
+        time += dt;
+
+        // Report once every shader has finished building.
+        if (!shadersReady && diffuseNormalMat->IsReady() && floorMat->IsReady() && skyMat->IsReady() && spriteMat->IsReady())
+        {
+            shadersReady = true;
+            std::chrono::duration<double, std::milli> shaderTime = std::chrono::steady_clock::now() - shaderStartTime;
+            std::cout << "Shaders ready after " << shaderTime.count() << " ms." << std::endl;
+        }
+
+        // Send up whatever the loader threads have finished, and report once it's all there.
+        textureStreamer->Update();
+        if (!texturesReady && textureStreamer->GetPendingCount() == 0)
+        {
+            texturesReady = true;
+            std::chrono::duration<double, std::milli> textureTime = std::chrono::steady_clock::now() - shaderStartTime;
+            std::cout << "Textures streamed in after " << textureTime.count() << " ms (" << textureStreamer->GetBytesUploaded() << " bytes)." << std::endl;
+        }
         
 
         // Update the player controller
         controller.Update(window, viewportDimensions, mousePosition, dt);
         
 
-        std::vector<glm::mat4> matrices;
-
-        // rotate cube transform and get a matrix for it
-        for (int i = 0; i < transforms.size(); i++)
+        // Turn the mobile, and spin its bucklers. Only the local matrices change;
+        // the scene graph update carries the hub's turn down to everything hanging off of it.
+        hubTransform.RotateY(dt * .3f);
+        scene->SetLocalTransform(hub, hubTransform);
+        for (unsigned int i = 0; i < mobileBucklers.size(); i++)
+        {
+            mobileBucklerTransforms[i].RotateY(dt * 2);
+            scene->SetLocalTransform(mobileBucklers[i], mobileBucklerTransforms[i]);
+        }
+        scene->Update();
+        for (unsigned int i = 0; i < mobileCubes.size(); i++)
         {
-            transforms[i].RotateY(dt);
-            matrices.push_back(transforms[i].GetMatrix());
+            mobileCubeMatrices[i] = scene->GetWorldMatrix(mobileCubes[i]);
+            mobileBucklerMatrices[i] = scene->GetWorldMatrix(mobileBucklers[i]);
         }
 
 
+        // Upload the matrices of every transform that changed.
+        // The spinning happens on the gpu, so after the first frame there's nothing to send.
+        instances->Update();
+
+
         // View matrix.
         glm::mat4 view = controller.GetTransform().GetInverseMatrix();
         // Projection matrix.
@@ -187,38 +441,125 @@ int main(int argc, char **argv)
         glm::mat4 viewProjection = projection * view;
 
 
+        // Pull the six planes of the view frustum out of the view projection matrix, for culling.
+        glm::mat4 rows = glm::transpose(viewProjection);
+        glm::vec4 frustum[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+        for (int i = 0; i < 6; i++)
+        {
+            frustum[i] /= glm::length(glm::vec3(frustum[i]));
+        }
+
+        // First turn the displayed bucklers and rebuild their matrices.
+        Job* updateJob = jobs->CreateParallelFor(displaySystem.GetCount(), DISPLAY_BATCH, [&](unsigned int first, unsigned int count)
+        {
+            for (unsigned int i = first; i < first + count; i++)
+            {
+                displaySystem.GetHandle(i).RotateY(dt * .5f);
+            }
+            displaySystem.BuildMatrices(displayMatrices.data(), first, count);
+        });
+
+        // Then, once that's done, each batch records a draw of the bucklers that are inside the frustum.
+        Job* cullJob = jobs->CreateParallelFor(displaySystem.GetCount(), DISPLAY_BATCH, [&](unsigned int first, unsigned int count)
+        {
+            glm::mat4 visible[DISPLAY_BATCH];
+            unsigned int visibleCount = 0;
+            for (unsigned int i = first; i < first + count; i++)
+            {
+                // Test a sphere around the buckler against every plane.
+                glm::vec4 center = displayMatrices[i][3];
+                bool inside = true;
+                for (int p = 0; p < 6 && inside; p++)
+                {
+                    inside = glm::dot(frustum[p], center) > -1.f;
+                }
+                if (inside)
+                {
+                    visible[visibleCount++] = displayMatrices[i];
+                }
+            }
+
+            CommandBuffer* commands = displayCommands[first / DISPLAY_BATCH];
+            commands->Reset();
+            if (visibleCount > 0)
+            {
+                commands->BindMaterial(diffuseNormalMat);
+                commands->SetInstances(visible, visibleCount);
+                commands->DrawInstanced(model);
+            }
+        });
+        jobs->AddDependency(cullJob, updateJob);
+        jobs->Run(cullJob);
+        jobs->Run(updateJob);
+
+        // This thread helps out until it's all done. The recorded draws are replayed further down.
+        jobs->Wait(cullJob);
+
+
+        sceneTimer->Begin();
+
         // Clear the color and depth buffers
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
+        GLState::SetEnabled(GL_DEPTH_TEST, true);
         glClearColor(0.0, 0.0, 0.0, 0.0);
 
 
-        // Set the camera and world matrices to the shader
-        // The string names correspond directly to the uniform names within the shader.
-        diffuseNormalMat->SetMatrix("cameraView", viewProjection);
+        // Send this frame's camera and time to every shader at once.
+        frameData.m_view = view;
+        frameData.m_projection = projection;
+        frameData.m_viewProjection = viewProjection;
+        frameData.m_skyViewProjection = projection * glm::mat4(glm::mat3(view));
+        frameData.m_cameraPosition = controller.GetTransform().Position();
+        frameData.m_time = time;
+        frameUniforms->Upload();
 
 
-        // Bind the material and draw the model
-        diffuseNormalMat->Bind();
+        // Everything drawn this frame goes through the render queue. The order things are submitted in doesn't matter,
+        // the queue sorts them by pass, shader, material and mesh, and draws the nearest things first within those.
+        glm::vec3 cameraPosition = controller.GetTransform().Position();
 
-        // Instead of just drawing one, we pass in a vector of matrices (this function is where the instancing really happens)
-        model->DrawInstanced(matrices);
+        // Every instance in the buffer, in one draw (this function is where the instancing really happens)
+        renderQueue->SubmitInstanced(RenderQueue::OPAQUE_PASS, diffuseNormalMat, model, instances, glm::length(instances->GetCenter() - cameraPosition));
 
-        diffuseNormalMat->Unbind();
+        // The bucklers on display were recorded by the cull jobs. The queue plays them back when their turn comes,
+        // merging every batch's share into one draw. They stand on the floor, so they sort by its middle.
+        renderQueue->SubmitCommands(RenderQueue::OPAQUE_PASS, diffuseNormalMat, &displayCommands, glm::length(floorCenter - cameraPosition));
 
+        // The mobile, in one batch.
+        batch->Add(cube, mobileCubeMatrices);
+        batch->Add(model, mobileBucklerMatrices);
+        renderQueue->SubmitBatch(RenderQueue::OPAQUE_PASS, diffuseNormalMat, batch, glm::length(batch->GetCenter() - cameraPosition));
 
-        // Draw a skybox
-        glm::mat4 viewRotation = projection * glm::mat4(glm::mat3(view));
-        skyMat->SetMatrix("cameraView", viewRotation);
-        glDepthFunc(GL_LEQUAL);
-        skyMat->Bind();
-        cube->Draw();
-        skyMat->Unbind();
-        // Set the depth test back to the default setting.
-        glDepthFunc(GL_LESS);
+        // The floor, every tile with its own texture, in one call. Closest tiles first, if sorting is on.
+        const std::vector<glm::mat4>& sortedTiles = floorSorter.Sort(floorTiles, view);
+        renderQueue->SubmitInstanced(RenderQueue::OPAQUE_PASS, floorMat, cube, &sortedTiles, glm::length(floorCenter - cameraPosition));
+
+        // The skybox. It uses the view without the camera position, from the frame uniforms.
+        renderQueue->SubmitMesh(RenderQueue::SKY_PASS, skyMat, cube, 0);
+
+        // The icons over the top of everything.
+        float iconSize = viewportDimensions.x / (icons.size() + 1);
+        for (unsigned int i = 0; i < icons.size(); i++)
+        {
+            icons[i].SetPosition(glm::vec2((i + 1) * iconSize, viewportDimensions.y - iconSize));
+            icons[i].Rotate(dt);
+            sprites->Draw(i % 2 == 0 ? texDiffuse : texNorm, icons[i], glm::vec2(iconSize * .8f));
+        }
+        if (screenSizeUniform == -1 && spriteMat->IsReady())
+        {
+            screenSizeUniform = spriteShaderProgram->GetUniformLocation("screenSize");
+        }
+        spriteMat->SetVec2(screenSizeUniform, viewportDimensions);
+        renderQueue->SubmitSprites(RenderQueue::OVERLAY_PASS, spriteMat, sprites, 0);
+
+        renderQueue->Execute();
+        sceneTimer->End();
 
 		// Stop using the shader program.
 
+		// Let the frame uniforms know this frame's draws have been sent.
+		frameUniforms->EndFrame();
+
 		// Swap the backbuffer to the front.
 		glfwSwapBuffers(window);
 
@@ -229,10 +570,26 @@ int main(int argc, char **argv)
     // Delete mesh objects
     delete model;
     delete cube;
+    delete instances;
+    delete batch;
+    delete jobs;
+    for (unsigned int i = 0; i < displayCommands.size(); i++)
+    {
+        delete displayCommands[i];
+    }
+    delete scene;
 
     // Free memory used by materials and all sub objects
     delete diffuseNormalMat;
+    delete floorMat;
     delete skyMat;
+    delete sprites;
+    delete frameUniforms;
+    delete renderQueue;
+    delete spriteMat;
+    delete litShaders;
+    delete sceneTimer;
+    delete textureStreamer;
 
 	// Free GLFW memory.
 	glfwTerminate();
@@ -23,20 +23,47 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "../header/material.h"
+#include "../header/glState.h"
+#include <cstring>
+
+const char* Material::PARAMETER_BLOCK_NAME = "MaterialParameters";
+const GLuint Material::PARAMETER_BINDING = 1;
 
 Material::Material(ShaderProgram * shaderProgram)
 {
     // Increment the reference counter on the shader program.
     shaderProgram->IncRefCount();
     m_shaderProgram = shaderProgram;
+
+    // Lay out space for every value the program takes, as soon as the program is built.
+    // Until then, values set by name are kept to one side. (Attach the program's shaders before making materials with it.)
+    IsReady();
 }
 
 Material::~Material()
 {
+    // Don't leave anything remembering this material, in case another one ends up at the same address.
+    if (m_shaderProgram != nullptr && m_shaderProgram->GetLastMaterial() == this)
+        m_shaderProgram->SetLastMaterial(nullptr);
+
     // Free shader program
     if (m_shaderProgram != nullptr)
         m_shaderProgram->DecRefCount();
 
+    if (m_parameterBuffer != 0)
+        GLState::DeleteBuffers(1, &m_parameterBuffer);
+
+    // Let go of any textures that were waiting for the program.
+    for (unsigned int i = 0; i < m_pendingValues.size(); i++)
+    {
+        switch (m_pendingValues[i].m_type)
+        {
+        case GL_SAMPLER_2D: ((Texture*)m_pendingValues[i].m_object)->DecRefCount(); break;
+        case GL_SAMPLER_CUBE: ((CubeMap*)m_pendingValues[i].m_object)->DecRefCount(); break;
+        case GL_SAMPLER_2D_ARRAY: ((TextureArray*)m_pendingValues[i].m_object)->DecRefCount(); break;
+        }
+    }
+
     // Free textures
     for (int i = 0; i < m_textures.size(); i++)
     {
@@ -47,15 +74,25 @@ Material::~Material()
     {
         m_cubeMaps[i]->DecRefCount();
     }
+
+    for (int i = 0; i < m_textureArrays.size(); i++)
+    {
+        m_textureArrays[i]->DecRefCount();
+    }
 }
 
 void Material::SetTexture(char* name, Texture* texture)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    // Until the program is built, nobody knows where the uniform is, so hang on to the texture until then.
+    if (!IsReady())
+    {
+        texture->IncRefCount();
+        Defer(name, GL_SAMPLER_2D, texture, nullptr);
+        return;
+    }
 
-    // Request uniform from shader.
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+    // The program found all of its uniforms when it was linked, so this doesn't ask opengl.
+    GLint uniform = m_shaderProgram->GetUniformLocation(name);
 
     // If there was no uniform location, print an error and return from the function.
     if (uniform == -1)
@@ -64,6 +101,14 @@ void Material::SetTexture(char* name, Texture* texture)
         return;
     }
 
+    SetTexture(uniform, texture);
+}
+
+void Material::SetTexture(GLint uniform, Texture* texture)
+{
+    // Setting a missing uniform does nothing, just like in opengl.
+    if (uniform == -1) return;
+
     texture->IncRefCount();
 
     // Search through current texture uniforms to find a match.
@@ -81,15 +126,22 @@ void Material::SetTexture(char* name, Texture* texture)
     // There is no match, add the new texture.
     m_textureUniforms.push_back(uniform);
     m_textures.push_back(texture);
+    // Adding a texture moves the units of everything after it.
+    m_samplersDirty = true;
 }
 
-void Material::SetCubeMap(char * name, CubeMap* cubeMap)
+void Material::SetCubeMap(char* name, CubeMap* cubeMap)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    // Until the program is built, nobody knows where the uniform is, so hang on to the cubeMap until then.
+    if (!IsReady())
+    {
+        cubeMap->IncRefCount();
+        Defer(name, GL_SAMPLER_CUBE, cubeMap, nullptr);
+        return;
+    }
 
-    // Request uniform from shader.
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+    // The program found all of its uniforms when it was linked, so this doesn't ask opengl.
+    GLint uniform = m_shaderProgram->GetUniformLocation(name);
 
     // If there was no uniform location, print an error and return from the function.
     if (uniform == -1)
@@ -98,9 +150,17 @@ void Material::SetCubeMap(char * name, CubeMap* cubeMap)
         return;
     }
 
+    SetCubeMap(uniform, cubeMap);
+}
+
+void Material::SetCubeMap(GLint uniform, CubeMap* cubeMap)
+{
+    // Setting a missing uniform does nothing, just like in opengl.
+    if (uniform == -1) return;
+
     cubeMap->IncRefCount();
 
-    // Search through current uniforms to find a match.
+    // Search through current cubeMap uniforms to find a match.
     for (int i = 0; i < m_cubeMapUniforms.size(); i++)
     {
         // If there's a match replace the cubeMap.
@@ -115,15 +175,22 @@ void Material::SetCubeMap(char * name, CubeMap* cubeMap)
     // There is no match, add the new cubeMap.
     m_cubeMapUniforms.push_back(uniform);
     m_cubeMaps.push_back(cubeMap);
+    // The new sampler needs to be given its texture unit.
+    m_samplersDirty = true;
 }
 
-void Material::SetMatrix(char* name, glm::mat4 matrix)
+void Material::SetTextureArray(char* name, TextureArray* textureArray)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    // Until the program is built, nobody knows where the uniform is, so hang on to the textureArray until then.
+    if (!IsReady())
+    {
+        textureArray->IncRefCount();
+        Defer(name, GL_SAMPLER_2D_ARRAY, textureArray, nullptr);
+        return;
+    }
 
-    // Request uniform
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+    // The program found all of its uniforms when it was linked, so this doesn't ask opengl.
+    GLint uniform = m_shaderProgram->GetUniformLocation(name);
 
     // If there was no uniform location, print an error and return from the function.
     if (uniform == -1)
@@ -132,255 +199,443 @@ void Material::SetMatrix(char* name, glm::mat4 matrix)
         return;
     }
 
-    // Search through current matrix uniforms to find a match.
-    for (int i = 0; i < m_matrixUniforms.size(); i++)
+    SetTextureArray(uniform, textureArray);
+}
+
+void Material::SetTextureArray(GLint uniform, TextureArray* textureArray)
+{
+    // Setting a missing uniform does nothing, just like in opengl.
+    if (uniform == -1) return;
+
+    textureArray->IncRefCount();
+
+    // Search through current texture array uniforms to find a match.
+    for (int i = 0; i < m_textureArrayUniforms.size(); i++)
     {
-        // If there's a match replace the matrix.
-        if (m_matrixUniforms[i] == uniform)
+        // If there's a match replace the texture array.
+        if (m_textureArrayUniforms[i] == uniform)
         {
-            m_matrices[i] = matrix;
+            m_textureArrays[i]->DecRefCount();
+            m_textureArrays[i] = textureArray;
             return;
         }
     }
 
-    // There is no match, add the new matrix.
-    m_matrixUniforms.push_back(uniform);
-    m_matrices.push_back(matrix);
+    // There is no match, add the new texture array.
+    m_textureArrayUniforms.push_back(uniform);
+    m_textureArrays.push_back(textureArray);
+    // The new sampler needs to be given its texture unit.
+    m_samplersDirty = true;
 }
 
-void Material::SetVec4(char * name, glm::vec4 vector)
+unsigned int Material::TypeSize(GLenum type)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
-
-    // Request uniform
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
-
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
+    switch (type)
     {
-        std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
-        return;
+    case GL_FLOAT_MAT4: return sizeof(glm::mat4);
+    case GL_FLOAT_VEC4: return sizeof(glm::vec4);
+    case GL_FLOAT_VEC3: return sizeof(glm::vec3);
+    case GL_FLOAT_VEC2: return sizeof(glm::vec2);
+    case GL_FLOAT: return sizeof(float);
+    case GL_INT: return sizeof(int);
+    case GL_BOOL: return sizeof(int);
+    default: return 0;
     }
+}
+
+void Material::Defer(const char* name, GLenum type, void* object, const void* value)
+{
+    PendingValue pending;
+    pending.m_name = name;
+    pending.m_type = type;
+    pending.m_object = object;
+    if (value != nullptr) memcpy(pending.m_value, value, TypeSize(type));
+    m_pendingValues.push_back(pending);
+}
 
-    // Search through current vector uniforms to find a match.
-    for (int i = 0; i < m_vec4Uniforms.size(); i++)
+void Material::ApplyPendingValues()
+{
+    // Set everything in the order it was given, so later values still win.
+    for (unsigned int i = 0; i < m_pendingValues.size(); i++)
     {
-        // If there's a match replace the vector.
-        if (m_vec4Uniforms[i] == uniform)
+        PendingValue& pending = m_pendingValues[i];
+        switch (pending.m_type)
         {
-            m_vec4s[i] = vector;
-            return;
+        case GL_SAMPLER_2D:
+            SetTexture(&pending.m_name[0], (Texture*)pending.m_object);
+            ((Texture*)pending.m_object)->DecRefCount();
+            break;
+        case GL_SAMPLER_CUBE:
+            SetCubeMap(&pending.m_name[0], (CubeMap*)pending.m_object);
+            ((CubeMap*)pending.m_object)->DecRefCount();
+            break;
+        case GL_SAMPLER_2D_ARRAY:
+            SetTextureArray(&pending.m_name[0], (TextureArray*)pending.m_object);
+            ((TextureArray*)pending.m_object)->DecRefCount();
+            break;
+        default:
+            SetValue(FindParameter(pending.m_name.c_str()), pending.m_type, pending.m_value);
+            break;
         }
     }
+    m_pendingValues.clear();
+}
+
+bool Material::IsReady()
+{
+    if (m_parametersBuilt) return true;
+    if (!m_shaderProgram->IsReady()) return false;
 
-    // There is no match, add the new vector.
-    m_vec4Uniforms.push_back(uniform);
-    m_vec4s.push_back(vector);
+    // The program just finished, so now the values can go where they belong.
+    BuildParameters();
+    ApplyPendingValues();
+    return true;
 }
 
-void Material::SetVec3(char * name, glm::vec3 vector)
+void Material::SetFallback(Material* fallback)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    m_fallback = fallback;
+}
 
-    // Request uniform
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+void Material::BuildParameters()
+{
+    m_parametersBuilt = true;
 
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
-    {
-        std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
-        return;
-    }
+    // Values in the material parameter block go exactly where the program says they do.
+    m_parameterBlockSize = m_shaderProgram->GetParameterBlockSize();
+    unsigned int blockEnd = (m_parameterBlockSize + 15) & ~15;
+    unsigned int size = blockEnd;
 
-    // Search through current vector uniforms to find a match.
-    for (int i = 0; i < m_vec3Uniforms.size(); i++)
+    const std::unordered_multimap<unsigned int, UniformInfo>& uniforms = m_shaderProgram->GetUniforms();
+    for (std::unordered_multimap<unsigned int, UniformInfo>::const_iterator it = uniforms.begin(); it != uniforms.end(); it++)
     {
-        // If there's a match replace the vector.
-        if (m_vec3Uniforms[i] == uniform)
+        const UniformInfo& info = it->second;
+
+        Parameter parameter;
+        parameter.m_name = info.m_name;
+        parameter.m_location = info.m_location;
+        parameter.m_type = info.m_type;
+        parameter.m_set = false;
+        parameter.m_dirty = false;
+
+        // Samplers are set up from the textures, so only plain values get space here.
+        parameter.m_size = TypeSize(info.m_type);
+        if (parameter.m_size == 0) continue;
+
+        if (info.m_blockOffset >= 0)
         {
-            m_vec3s[i] = vector;
-            return;
+            parameter.m_offset = info.m_blockOffset;
+        }
+        else
+        {
+            // Everything else gets its own 16 byte aligned spot after the block.
+            parameter.m_offset = size;
+            size += (parameter.m_size + 15) & ~15;
+        }
+
+        int index = m_parameters.size();
+        m_parameters.push_back(parameter);
+        m_nameParameters.insert(std::make_pair(it->first, index));
+        if (info.m_location >= 0)
+        {
+            if (info.m_location >= (GLint)m_locationParameters.size()) m_locationParameters.resize(info.m_location + 1, -1);
+            m_locationParameters[info.m_location] = index;
         }
     }
 
-    // There is no match, add the new vector.
-    m_vec3Uniforms.push_back(uniform);
-    m_vec3s.push_back(vector);
+    // Everything starts out as zero, just like uniforms in a freshly linked program.
+    m_block.resize(size / 16);
+    if (size > 0) memset(m_block.data(), 0, size);
+
+    // Each material gets its own copy of the parameter block.
+    if (m_parameterBlockSize > 0)
+    {
+        glGenBuffers(1, &m_parameterBuffer);
+        GLState::BindBuffer(GL_UNIFORM_BUFFER, m_parameterBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, m_parameterBlockSize, m_block.data(), GL_DYNAMIC_DRAW);
+        GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
 }
 
-void Material::SetVec2(char * name, glm::vec2 vector)
+int Material::FindParameter(const char* name)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    // The hash only narrows it down, the name has to match too.
+    typedef std::unordered_multimap<unsigned int, int>::iterator Iterator;
+    std::pair<Iterator, Iterator> found = m_nameParameters.equal_range(ShaderProgram::HashName(name));
+    for (Iterator parameter = found.first; parameter != found.second; parameter++)
+    {
+        if (m_parameters[parameter->second].m_name == name)
+        {
+            return parameter->second;
+        }
+    }
 
-    // Request uniform
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+    // Otherwise ask the program, which knows names like "lights[2]" that the table doesn't.
+    int parameter = FindParameter(m_shaderProgram->GetUniformLocation(name));
 
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
+    // If there was no uniform, print an error.
+    if (parameter == -1)
     {
         std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
-        return;
     }
+    return parameter;
+}
 
-    // Search through current vector uniforms to find a match.
-    for (int i = 0; i < m_vec2Uniforms.size(); i++)
+int Material::FindParameter(GLint uniform)
+{
+    // Setting a missing uniform does nothing, just like in opengl.
+    if (uniform < 0 || uniform >= (GLint)m_locationParameters.size()) return -1;
+    return m_locationParameters[uniform];
+}
+
+void Material::SetValue(const char* name, GLenum type, const void* value)
+{
+    // Until the program is built, values are kept to one side.
+    if (!IsReady())
     {
-        // If there's a match replace the vector.
-        if (m_vec2Uniforms[i] == uniform)
-        {
-            m_vec2s[i] = vector;
-            return;
-        }
+        Defer(name, type, nullptr, value);
+        return;
     }
-
-    // There is no match, add the new vector.
-    m_vec2Uniforms.push_back(uniform);
-    m_vec2s.push_back(vector);
+    SetValue(FindParameter(name), type, value);
 }
 
-void Material::SetFloat(char * name, float f)
+void Material::SetValue(int parameter, GLenum type, const void* value)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
-
-    // Request uniform for matrix
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+    if (parameter == -1) return;
+    Parameter& info = m_parameters[parameter];
 
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
+    // Opengl would refuse to set a uniform with the wrong type, so don't store it either.
+    if (info.m_type != type && !(type == GL_INT && info.m_type == GL_BOOL))
     {
-        std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
+        std::cout << "Uniform: " << info.m_name << " is a different type than the value given for it." << std::endl;
         return;
     }
 
-    // Search through current vector uniforms to find a match.
-    for (int i = 0; i < m_floatUniforms.size(); i++)
+    // Only changed values need uploading.
+    unsigned char* destination = (unsigned char*)m_block.data() + info.m_offset;
+    if (info.m_set && memcmp(destination, value, info.m_size) == 0) return;
+    memcpy(destination, value, info.m_size);
+    info.m_set = true;
+
+    if (info.m_location == -1)
     {
-        // If there's a match replace the vector.
-        if (m_floatUniforms[i] == uniform)
-        {
-            m_floats[i] = f;
-            return;
-        }
+        m_parameterBlockDirty = true;
     }
+    else if (!info.m_dirty)
+    {
+        info.m_dirty = true;
+        m_dirtyParameters.push_back(parameter);
+    }
+}
 
-    // There is no match, add the new vector.
-    m_floatUniforms.push_back(uniform);
-    m_floats.push_back(f);
+void Material::SetMatrix(char* name, glm::mat4 matrix)
+{
+    SetValue(name, GL_FLOAT_MAT4, &matrix);
 }
 
-void Material::SetInt(char * name, int newint)
+void Material::SetMatrix(GLint uniform, glm::mat4 matrix)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    SetValue(FindParameter(uniform), GL_FLOAT_MAT4, &matrix);
+}
 
-    // Request uniform for matrix
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+void Material::SetVec4(char* name, glm::vec4 vector)
+{
+    SetValue(name, GL_FLOAT_VEC4, &vector);
+}
 
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
-    {
-        std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
-        return;
-    }
+void Material::SetVec4(GLint uniform, glm::vec4 vector)
+{
+    SetValue(FindParameter(uniform), GL_FLOAT_VEC4, &vector);
+}
 
-    // Search through current vector uniforms to find a match.
-    for (int i = 0; i < m_intUniforms.size(); i++)
-    {
-        // If there's a match replace the vector.
-        if (m_intUniforms[i] == uniform)
-        {
-            m_ints[i] = newint;
-            return;
-        }
-    }
+void Material::SetVec3(char* name, glm::vec3 vector)
+{
+    SetValue(name, GL_FLOAT_VEC3, &vector);
+}
 
-    // There is no match, add the new vector.
-    m_intUniforms.push_back(uniform);
-    m_ints.push_back(newint);
+void Material::SetVec3(GLint uniform, glm::vec3 vector)
+{
+    SetValue(FindParameter(uniform), GL_FLOAT_VEC3, &vector);
 }
 
+void Material::SetVec2(char* name, glm::vec2 vector)
+{
+    SetValue(name, GL_FLOAT_VEC2, &vector);
+}
 
-void Material::Bind()
+void Material::SetVec2(GLint uniform, glm::vec2 vector)
 {
-    m_shaderProgram->Bind();
+    SetValue(FindParameter(uniform), GL_FLOAT_VEC2, &vector);
+}
 
-    // Bind all textures
-    for (int i = 0; i < m_textureUniforms.size(); i++)
+void Material::SetFloat(char* name, float f)
+{
+    SetValue(name, GL_FLOAT, &f);
+}
+
+void Material::SetFloat(GLint uniform, float f)
+{
+    SetValue(FindParameter(uniform), GL_FLOAT, &f);
+}
+
+void Material::SetInt(char* name, int newint)
+{
+    SetValue(name, GL_INT, &newint);
+}
+
+void Material::SetInt(GLint uniform, int newint)
+{
+    SetValue(FindParameter(uniform), GL_INT, &newint);
+}
+
+void Material::UploadValue(int parameter)
+{
+    Parameter& info = m_parameters[parameter];
+    const unsigned char* value = (unsigned char*)m_block.data() + info.m_offset;
+    info.m_dirty = false;
+
+    switch (info.m_type)
     {
-        // This enum value can be incremented to bind to different texture locations
-        glActiveTexture(GL_TEXTURE0 + i);
+    case GL_FLOAT_MAT4:
+        glUniformMatrix4fv(info.m_location, 1, GL_FALSE, (const GLfloat*)value);
+        break;
+    case GL_FLOAT_VEC4:
+        glUniform4fv(info.m_location, 1, (const GLfloat*)value);
+        break;
+    case GL_FLOAT_VEC3:
+        glUniform3fv(info.m_location, 1, (const GLfloat*)value);
+        break;
+    case GL_FLOAT_VEC2:
+        glUniform2fv(info.m_location, 1, (const GLfloat*)value);
+        break;
+    case GL_FLOAT:
+        glUniform1fv(info.m_location, 1, (const GLfloat*)value);
+        break;
+    case GL_INT:
+    case GL_BOOL:
+        glUniform1iv(info.m_location, 1, (const GLint*)value);
+        break;
+    }
+}
 
-        // Bind the texture
-        glBindTexture(GL_TEXTURE_2D, m_textures[i]->GetGLTexture());
+ShaderProgram* Material::GetShaderProgram()
+{
+    return m_shaderProgram;
+}
 
-        // Use the the texture from GL_TEXTURE0 + i at the given texture uniform location.
-        glUniform1i(m_textureUniforms[i], i);
+bool Material::Bind()
+{
+    // A program that's still building can't draw anything yet. Use the fallback material instead, if there is one.
+    if (!IsReady())
+    {
+        if (m_fallback != nullptr) return m_fallback->Bind();
+        return false;
     }
+    m_shaderProgram->Bind();
 
-    // Bind all cubeMaps, continue from the previous location
-    for (int i = 0; i < m_cubeMaps.size(); i++)
+    // Uniform values belong to the program. If this material was the last one to use it, they're all still set,
+    // and only the ones that changed since then need sending. Otherwise, everything does.
+    bool programChanged = m_shaderProgram->GetLastMaterial() != this;
+    m_shaderProgram->SetLastMaterial(this);
+
+    // Tell each sampler which texture unit to read from.
+    // This only changes when textures are added (or another material had the program).
+    if (programChanged || m_samplersDirty)
     {
-        // This enum value can be incremented to bind to different texture locations
-        glActiveTexture(GL_TEXTURE0 + m_textureUniforms.size() + i);
+        for (int i = 0; i < m_textureUniforms.size(); i++)
+        {
+            // Use the the texture from GL_TEXTURE0 + i at the given texture uniform location.
+            glUniform1i(m_textureUniforms[i], i);
+        }
+
+        // cubeMaps continue from the previous location
+        for (int i = 0; i < m_cubeMapUniforms.size(); i++)
+        {
+            glUniform1i(m_cubeMapUniforms[i], m_textureUniforms.size() + i);
+        }
 
-        // Bind the texture
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeMaps[i]->GetGLCubeMap());
-        
-        // Use the the texture from GL_TEXTURE0 + i at the given texture uniform location.
-        glUniform1i(m_cubeMapUniforms[i], m_textureUniforms.size() + i);
+        // and texture arrays come after the cubeMaps
+        for (int i = 0; i < m_textureArrayUniforms.size(); i++)
+        {
+            glUniform1i(m_textureArrayUniforms[i], m_textureUniforms.size() + m_cubeMapUniforms.size() + i);
+        }
+
+        m_samplersDirty = false;
     }
 
-    // Set all matrix data
-    for (int i = 0; i < m_matrixUniforms.size(); i++)
+    // Bind all textures to their units. Texture units are shared by every program,
+    // so this always goes through GLState, which skips any that are still bound from before.
+    for (int i = 0; i < m_textureUniforms.size(); i++)
     {
-        glUniformMatrix4fv(m_matrixUniforms[i], 1, GL_FALSE, &(m_matrices[i][0][0]));
+        GLState::BindTexture(i, GL_TEXTURE_2D, m_textures[i]->GetGLTexture());
     }
 
-    // Set all vector data
-    for (int i = 0; i < m_vec4Uniforms.size(); i++)
+    // Bind all cubeMaps, continue from the previous location
+    for (int i = 0; i < m_cubeMaps.size(); i++)
     {
-        glUniform4fv(m_vec4Uniforms[i], 1, &(m_vec4s[i][0]));
+        GLState::BindTexture(m_textureUniforms.size() + i, GL_TEXTURE_CUBE_MAP, m_cubeMaps[i]->GetGLCubeMap());
     }
 
-    for (int i = 0; i < m_vec3Uniforms.size(); i++)
+    // Bind all texture arrays after the cubeMaps
+    for (int i = 0; i < m_textureArrays.size(); i++)
     {
-        glUniform3fv(m_vec3Uniforms[i], 1, &(m_vec3s[i][0]));
+        GLState::BindTexture(m_textureUniforms.size() + m_cubeMaps.size() + i, GL_TEXTURE_2D_ARRAY, m_textureArrays[i]->GetGLTexture());
     }
 
-    for (int i = 0; i < m_vec2Uniforms.size(); i++)
+    // The parameter block belongs to this material, so whatever the program did in between, it's still right.
+    // If anything in it changed, the whole block goes up in one call.
+    if (m_parameterBuffer != 0)
     {
-        glUniform2fv(m_vec2Uniforms[i], 1, &(m_vec2s[i][0]));
+        if (m_parameterBlockDirty)
+        {
+            GLState::BindBuffer(GL_UNIFORM_BUFFER, m_parameterBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, m_parameterBlockSize, m_block.data());
+            m_parameterBlockDirty = false;
+        }
+        GLState::BindBufferRange(GL_UNIFORM_BUFFER, PARAMETER_BINDING, m_parameterBuffer, 0, m_parameterBlockSize);
     }
 
-    for (int i = 0; i < m_floatUniforms.size(); i++)
+    if (programChanged)
     {
-        glUniform1fv(m_floatUniforms[i], 1, &(m_floats[i]));
+        // Set every ordinary uniform this material has a value for.
+        for (int i = 0; i < m_parameters.size(); i++)
+        {
+            if (m_parameters[i].m_location != -1 && m_parameters[i].m_set) UploadValue(i);
+        }
     }
-
-    for (int i = 0; i < m_intUniforms.size(); i++)
+    else
     {
-        glUniform1iv(m_intUniforms[i], 1, &(m_ints[i]));
+        // Only send what changed.
+        for (int i = 0; i < m_dirtyParameters.size(); i++)
+        {
+            UploadValue(m_dirtyParameters[i]);
+        }
     }
+    m_dirtyParameters.clear();
+    return true;
 }
 
 void Material::Unbind()
 {
+    // Leaving everything bound is fine, since the next bind skips whatever's already there.
+    // Unbinding is only done to help debugging.
+    if (!GLState::GetDebugUnbind()) return;
+
     // Unbind all owned objects.
     for (int i = 0; i < m_textureUniforms.size(); i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLState::BindTexture(i, GL_TEXTURE_2D, 0);
     }
 
     for (int i = 0; i < m_cubeMapUniforms.size(); i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        GLState::BindTexture(m_textureUniforms.size() + i, GL_TEXTURE_CUBE_MAP, 0);
+    }
+
+    for (int i = 0; i < m_textureArrayUniforms.size(); i++)
+    {
+        GLState::BindTexture(m_textureUniforms.size() + m_cubeMapUniforms.size() + i, GL_TEXTURE_2D_ARRAY, 0);
     }
 
     m_shaderProgram->Unbind();
-}
+}
\ No newline at end of file
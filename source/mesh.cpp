@@ -23,7 +23,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "../header/mesh.h"
+#include "../header/glState.h"
 
+// The vertex buffer binding indices each kind of data is read from.
+// Attributes 0-3 all come from the vertex binding, the instance matrices and motions each have their own.
+static const GLuint VERTEX_BINDING = 0;
+static const GLuint INSTANCE_BINDING = 4;
+static const GLuint MOTION_BINDING = 5;
 
 
 Mesh::Mesh(std::vector<Vertex3dUVNormal> vertices, std::vector<unsigned int> indices)
@@ -225,34 +231,65 @@ Mesh::Mesh(std::string filePath, bool calcTangents)
 Mesh::~Mesh()
 {
 	// Clear buffers for the shape object when done using them.
-	glDeleteBuffers(1, &m_vertexBuffer);
-	glDeleteBuffers(1, &m_indexBuffer);
-    glDeleteBuffers(1, &m_instanceBuffer);
-    glDeleteVertexArrays(1, &m_basicVAO);
-    glDeleteVertexArrays(1, &m_instanceVAO);
+	GLState::DeleteBuffers(1, &m_vertexBuffer);
+	GLState::DeleteBuffers(1, &m_indexBuffer);
+    GLState::DeleteBuffers(1, &m_instanceBuffer);
+    GLState::DeleteBuffers(1, &m_noMotionBuffer);
+    GLState::DeleteVertexArrays(1, &m_basicVAO);
+    GLState::DeleteVertexArrays(1, &m_instanceVAO);
 }
 
 
 
 void Mesh::Draw()
 {
-    glBindVertexArray(m_basicVAO);
+    GLState::BindVertexArray(m_basicVAO);
 	glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, (void*)0);
-    glBindVertexArray(0);
+    if (GLState::GetDebugUnbind()) GLState::BindVertexArray(0);
 }
 
-void Mesh::DrawInstanced(std::vector<glm::mat4> matrices)
+void Mesh::DrawInstanced(const std::vector<glm::mat4>& matrices)
+{
+    DrawInstanced(matrices.data(), matrices.size());
+}
+
+void Mesh::DrawInstanced(const glm::mat4* matrices, unsigned int count)
 {
     // Buffer our matrices:
-    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
-    glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), matrices.data(), GL_STATIC_DRAW);
+    // This buffer is given new storage every draw (so the driver can hand us fresh memory instead of waiting on the last draw),
+    // which immutable storage can't do. It's still filled directly, without binding it.
+    glNamedBufferData(m_instanceBuffer, count * sizeof(glm::mat4), matrices, GL_STREAM_DRAW);
 
 
-    glBindVertexArray(m_instanceVAO);
+    GLState::BindVertexArray(m_instanceVAO);
+    // Read instance data from our own buffer.
+    // These instances don't move on their own, so every one of them reads the same empty motion (a stride of 0).
+    GLState::BindVertexBuffer(INSTANCE_BINDING, m_instanceBuffer, 0, sizeof(glm::mat4));
+    GLState::BindVertexBuffer(MOTION_BINDING, m_noMotionBuffer, 0, 0);
     // This call is just like the glDrawElements in the non instanced draw function, but
     // we also pass in the number of instances we want to draw.
-    glDrawElementsInstanced(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, (void*)0, matrices.size());
-    glBindVertexArray(0);
+    glDrawElementsInstanced(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, (void*)0, count);
+    if (GLState::GetDebugUnbind()) GLState::BindVertexArray(0);
+}
+
+void Mesh::DrawInstanced(InstanceBuffer* instances)
+{
+    // The matrices are already on the gpu, so all we have to do is point the vao at them.
+    GLState::BindVertexArray(m_instanceVAO);
+    GLState::BindVertexBuffer(INSTANCE_BINDING, instances->GetGLBuffer(), 0, sizeof(glm::mat4));
+    GLState::BindVertexBuffer(MOTION_BINDING, instances->GetGLMotionBuffer(), 0, sizeof(InstanceMotion));
+    glDrawElementsInstanced(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, (void*)0, instances->GetCount());
+    if (GLState::GetDebugUnbind()) GLState::BindVertexArray(0);
+}
+
+const std::vector<Vertex3dUVNormal>& Mesh::GetVertices()
+{
+    return m_vertices;
+}
+
+const std::vector<unsigned int>& Mesh::GetIndices()
+{
+    return m_indices;
 }
 
 
@@ -296,20 +333,24 @@ void Mesh::CalculateTangents()
 
 void Mesh::SetupBuffers()
 {
-    // Set up vertex buffer
-    glGenBuffers(1, &m_instanceBuffer);
+    // glCreateBuffers makes the buffer objects right away, so they can be used without ever being bound.
+    // (glGenBuffers only reserves names, which don't become buffers until the first bind.)
+    glCreateBuffers(1, &m_instanceBuffer);
+
+    // Set up the buffer for instances that have no motion.
+    // The rest of these never change, so they get immutable storage: the size and contents are given once,
+    // and the driver knows it will never have to move or reallocate them. (0 means no flags: we never write or map them again.)
+    InstanceMotion noMotion;
+    glCreateBuffers(1, &m_noMotionBuffer);
+    glNamedBufferStorage(m_noMotionBuffer, sizeof(InstanceMotion), &noMotion, 0);
 
     // Set up vertex buffer
-    glGenBuffers(1, &m_vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex3dUVNormal), &m_vertices[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glCreateBuffers(1, &m_vertexBuffer);
+    glNamedBufferStorage(m_vertexBuffer, m_vertices.size() * sizeof(Vertex3dUVNormal), &m_vertices[0], 0);
 
     // Set up index buffer
-    glGenBuffers(1, &m_indexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glCreateBuffers(1, &m_indexBuffer);
+    glNamedBufferStorage(m_indexBuffer, m_indices.size() * sizeof(unsigned int), &m_indices[0], 0);
 
     /////////////////////
     // Basic vao setup /
@@ -321,33 +362,12 @@ void Mesh::SetupBuffers()
     // Instead, we'll create our own vao, and configure it for a specific purpose.
     // Then, when we need it, we can just bind it with a single function call and we're good to go.
 
+    // Create a vertex array object. Like the buffers, it exists as soon as it's created.
+    glCreateVertexArrays(1, &m_basicVAO);
 
-    // Create a vertex array object another glGen___ function
-    glGenVertexArrays(1, &m_basicVAO);
-    // Once we bind the vao, we are using it for any calls that would have used the default vao.
-    glBindVertexArray(m_basicVAO);
-
-    // Here we bind a buffer, and set up our vertex attribute pointers.
-    // Important: the vertex buffer object isn't directly bound to the vao with glBindBuffer.
-    // Instead, when glVertexAttribPointer is called, it uses whatever vertex buffer happens to be bound to GL_ARRAY_BUFFER.
-    // That buffer and vertex attribute pointer are paired together within the vao.
-    // tldr: GL_ARRAY_BUFFER is only used to set up the vao. After that, we don't care what's in it.
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)sizeof(glm::vec3));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex3dUVNormal), (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex3dUVNormal), (void*)(2 * sizeof(glm::vec3) + sizeof(glm::vec2)));
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // By default, all vertex attributes are disabled on a vao.
-    // Here we enable the 4 that we are using for our vertex data.
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-
-    // The element array aka index buffer is also part of the vao state.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    // The glVertexArray___ functions edit the vao we pass in, instead of whatever happens to be bound.
+    // Nothing gets bound, so there's no bind state to save and restore, and nothing else can be changed by accident.
+    SetupVertexFormat(m_basicVAO, m_vertexBuffer, m_indexBuffer);
 
 
     //////////////////////////
@@ -355,48 +375,72 @@ void Mesh::SetupBuffers()
     ////////////////////////
 
     // Now we set up the vao for our instanced rendering setup.
+    // This lives in its own function, so that other classes drawing our vertex format can build the same vao.
+    m_instanceVAO = CreateInstancedVAO(m_vertexBuffer, m_indexBuffer, m_instanceBuffer, m_noMotionBuffer);
+}
+
+void Mesh::SetupVertexFormat(GLuint vao, GLuint vertexBuffer, GLuint indexBuffer)
+{
+    // Attach the vertex buffer to a binding, and describe each attribute's place within one vertex.
+    // The format and the buffer are set separately, so swapping the buffer later wouldn't mean redoing the format.
+    glVertexArrayVertexBuffer(vao, VERTEX_BINDING, vertexBuffer, 0, sizeof(Vertex3dUVNormal));
+    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribFormat(vao, 1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+    glVertexArrayAttribFormat(vao, 2, 3, GL_FLOAT, GL_TRUE, sizeof(glm::vec3) + sizeof(glm::vec2));
+    glVertexArrayAttribFormat(vao, 3, 3, GL_FLOAT, GL_TRUE, 2 * sizeof(glm::vec3) + sizeof(glm::vec2));
 
-    // Create and bind the vao.
-    glGenVertexArrays(1, &m_instanceVAO);
-    glBindVertexArray(m_instanceVAO);
+    // By default, all vertex attributes are disabled on a vao.
+    // Here we enable the 4 that we are using for our vertex data, and have them all read from the vertex binding.
+    for (int i = 0; i < 4; i++)
+    {
+        glVertexArrayAttribBinding(vao, i, VERTEX_BINDING);
+        glEnableVertexArrayAttrib(vao, i);
+    }
 
-    // Bind the vertex buffer, and set up attribute pointers. (same as non instanced part)
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)sizeof(glm::vec3));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex3dUVNormal), (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex3dUVNormal), (void*)(2 * sizeof(glm::vec3) + sizeof(glm::vec2)));
+    // The element array aka index buffer is also part of the vao state.
+    glVertexArrayElementBuffer(vao, indexBuffer);
+}
 
+GLuint Mesh::CreateInstancedVAO(GLuint vertexBuffer, GLuint indexBuffer, GLuint instanceBuffer, GLuint noMotionBuffer)
+{
+    // Create the vao, and set up the vertex data the same as the non instanced one.
+    GLuint vao;
+    glCreateVertexArrays(1, &vao);
+    SetupVertexFormat(vao, vertexBuffer, indexBuffer);
 
 
-    // Next, to set up our instance buffer, we bind it to GL_ARRAY_BUFFER.
-    // This is why the vao only stores buffers with vertex attributes.
-    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    // The instance matrices are read from a separate buffer binding. That way the buffer they come from can be swapped
+    // with a single glBindVertexBuffer call at draw time, without redoing any of this.
 
-    // Since the next 4 attributes are all part of the same matrix, we just loop and set up the attributes and divisors.
+    // Since the next 4 attributes are all part of the same matrix, we just loop and set up the attributes.
     for (int i = 0; i < 4; i++)
     {
-        // Set the attribute pointer (We start indexing at 4. 0-3 are used above for vertices.)
-        glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 16, (void*)(sizeof(float) * 4 * i));
-        // Set the divisors for the instance buffer attributes.
-        // Divisors are also part of the vao state.
-        glVertexAttribDivisor(4 + i, 1);
+        // Set the attribute format (We start indexing at 4. 0-3 are used above for vertices.)
+        // The last parameter is the offset of this column within one matrix.
+        glVertexArrayAttribFormat(vao, 4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 4 * i);
+        glVertexArrayAttribBinding(vao, 4 + i, INSTANCE_BINDING);
     }
 
-    // Unbind the instance buffer immediately after use.
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // Set the divisor for the instance binding, so it advances once per instance.
+    // Divisors are also part of the vao state.
+    glVertexArrayBindingDivisor(vao, INSTANCE_BINDING, 1);
+    glVertexArrayVertexBuffer(vao, INSTANCE_BINDING, instanceBuffer, 0, sizeof(glm::mat4));
 
-    // Finally, we must enable all 8 vertex attributes set up on the vao.
-    for (int i = 0; i < 8; i++)
+    // The instance motion is 4 more vec4s at locations 8-11, read from its own binding the same way.
+    for (int i = 0; i < 4; i++)
     {
-        glEnableVertexAttribArray(i);
+        glVertexArrayAttribFormat(vao, 8 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i);
+        glVertexArrayAttribBinding(vao, 8 + i, MOTION_BINDING);
     }
+    glVertexArrayBindingDivisor(vao, MOTION_BINDING, 1);
+    glVertexArrayVertexBuffer(vao, MOTION_BINDING, noMotionBuffer, 0, 0);
 
-    // Bind index buffer to the vao.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-
+    // Finally, we must enable the 8 instance attributes too.
+    for (int i = 4; i < 12; i++)
+    {
+        glEnableVertexArrayAttrib(vao, i);
+    }
 
-    // After all of this, we're done setting up the vao.
-    // It's best to unbind it so that we don't accidentally make changes to it elsewhere it code.
-    glBindVertexArray(0);
+    // The vao was never bound, so there's nothing to unbind.
+    return vao;
 }
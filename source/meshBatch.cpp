@@ -0,0 +1,248 @@
+/*
+Title: Instanced Rendering
+File Name: meshBatch.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/meshBatch.h"
+#include "../header/glState.h"
+#include <algorithm>
+
+MeshBatch::MeshBatch()
+{
+    m_geometryDirty = false;
+    m_batching = true;
+    m_drawCalls = m_stateChanges = 0;
+    m_unbatchedDrawCalls = m_unbatchedStateChanges = 0;
+
+    // The vao below is set up without binding anything, which needs the buffers to exist already,
+    // not just have names reserved, so they're made with glCreateBuffers.
+    glCreateBuffers(1, &m_vertexBuffer);
+    glCreateBuffers(1, &m_indexBuffer);
+    glCreateBuffers(1, &m_instanceBuffer);
+    glCreateBuffers(1, &m_commandBuffer);
+
+    // Batched instances don't move on their own, so they all share one empty motion.
+    InstanceMotion noMotion;
+    glCreateBuffers(1, &m_noMotionBuffer);
+    glNamedBufferStorage(m_noMotionBuffer, sizeof(InstanceMotion), &noMotion, 0);
+
+    // The buffer names never change, only their contents, so the vao can be set up once.
+    m_vao = Mesh::CreateInstancedVAO(m_vertexBuffer, m_indexBuffer, m_instanceBuffer, m_noMotionBuffer);
+}
+
+MeshBatch::~MeshBatch()
+{
+    GLState::DeleteVertexArrays(1, &m_vao);
+    GLState::DeleteBuffers(1, &m_vertexBuffer);
+    GLState::DeleteBuffers(1, &m_indexBuffer);
+    GLState::DeleteBuffers(1, &m_instanceBuffer);
+    GLState::DeleteBuffers(1, &m_noMotionBuffer);
+    GLState::DeleteBuffers(1, &m_commandBuffer);
+}
+
+unsigned int MeshBatch::FindMesh(Mesh* mesh)
+{
+    // Search through the meshes we already have.
+    for (unsigned int i = 0; i < m_meshes.size(); i++)
+    {
+        if (m_meshes[i].m_mesh == mesh)
+        {
+            return i;
+        }
+    }
+
+    // There is no match, so copy the geometry onto the end of our shared buffers.
+    // The indices stay relative to the mesh, and the base vertex offsets them when drawing.
+    const std::vector<Vertex3dUVNormal>& vertices = mesh->GetVertices();
+    const std::vector<unsigned int>& indices = mesh->GetIndices();
+
+    MeshRange range;
+    range.m_mesh = mesh;
+    range.m_firstIndex = m_indices.size();
+    range.m_indexCount = indices.size();
+    range.m_baseVertex = m_vertices.size();
+    m_meshes.push_back(range);
+
+    m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+    m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+    m_geometryDirty = true;
+
+    return m_meshes.size() - 1;
+}
+
+void MeshBatch::Add(Mesh* mesh, const std::vector<glm::mat4>& matrices, unsigned int first, unsigned int count)
+{
+    if (count == 0) return;
+
+    DrawRange draw;
+    draw.m_mesh = FindMesh(mesh);
+    draw.m_firstInstance = m_instances.size();
+    draw.m_instanceCount = count;
+    m_draws.push_back(draw);
+
+    m_instances.insert(m_instances.end(), matrices.begin() + first, matrices.begin() + first + count);
+}
+
+void MeshBatch::Add(Mesh* mesh, const std::vector<glm::mat4>& matrices)
+{
+    Add(mesh, matrices, 0, matrices.size());
+}
+
+glm::vec3 MeshBatch::GetCenter()
+{
+    if (m_instances.empty()) return glm::vec3();
+
+    glm::vec3 low = glm::vec3(m_instances[0][3]);
+    glm::vec3 high = low;
+    for (unsigned int i = 1; i < m_instances.size(); i++)
+    {
+        glm::vec3 position = glm::vec3(m_instances[i][3]);
+        low = glm::min(low, position);
+        high = glm::max(high, position);
+    }
+    return (low + high) * .5f;
+}
+
+void MeshBatch::Submit()
+{
+    // Count the binds that really happen while submitting.
+    unsigned int callsBefore = GLState::GetCallsMade();
+
+    if (!m_batching)
+    {
+        // One draw for every range, each uploading its own matrices.
+        for (unsigned int i = 0; i < m_draws.size(); i++)
+        {
+            const DrawRange& draw = m_draws[i];
+            m_rangeInstances.assign(m_instances.begin() + draw.m_firstInstance,
+                m_instances.begin() + draw.m_firstInstance + draw.m_instanceCount);
+            m_meshes[draw.m_mesh].m_mesh->DrawInstanced(m_rangeInstances);
+        }
+
+        m_unbatchedDrawCalls = m_draws.size();
+        m_unbatchedStateChanges = GLState::GetCallsMade() - callsBefore;
+        m_draws.clear();
+        m_instances.clear();
+        return;
+    }
+
+    m_drawCalls = m_stateChanges = 0;
+    if (m_draws.empty()) return;
+
+    // If new meshes showed up, upload the shared geometry again.
+    if (m_geometryDirty)
+    {
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex3dUVNormal), m_vertices.data(), GL_STATIC_DRAW);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW);
+        m_geometryDirty = false;
+    }
+
+    // Group the ranges by mesh, keeping the order they were added in otherwise.
+    std::stable_sort(m_draws.begin(), m_draws.end(), [](const DrawRange& a, const DrawRange& b)
+    {
+        return a.m_mesh < b.m_mesh;
+    });
+
+    // Copy the instances out in grouped order, and write one command for each mesh.
+    // Because a mesh's instances are contiguous now, a single command covers all of them,
+    // and its base instance tells the vao where in the instance buffer they start.
+    m_sortedInstances.clear();
+    m_commands.clear();
+    for (unsigned int i = 0; i < m_draws.size(); i++)
+    {
+        const DrawRange& draw = m_draws[i];
+
+        if (i == 0 || draw.m_mesh != m_draws[i - 1].m_mesh)
+        {
+            const MeshRange& mesh = m_meshes[draw.m_mesh];
+            DrawElementsIndirectCommand command;
+            command.m_count = mesh.m_indexCount;
+            command.m_instanceCount = 0;
+            command.m_firstIndex = mesh.m_firstIndex;
+            command.m_baseVertex = mesh.m_baseVertex;
+            command.m_baseInstance = m_sortedInstances.size();
+            m_commands.push_back(command);
+        }
+
+        m_commands.back().m_instanceCount += draw.m_instanceCount;
+        m_sortedInstances.insert(m_sortedInstances.end(),
+            m_instances.begin() + draw.m_firstInstance,
+            m_instances.begin() + draw.m_firstInstance + draw.m_instanceCount);
+    }
+
+    // One upload for every instance in the frame...
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_sortedInstances.size() * sizeof(glm::mat4), m_sortedInstances.data(), GL_STREAM_DRAW);
+
+    // ...one for the commands...
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+
+    // ...and one draw call for every mesh.
+    GLState::BindVertexArray(m_vao);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, m_commands.size(), 0);
+    if (GLState::GetDebugUnbind())
+    {
+        GLState::BindVertexArray(0);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    m_stateChanges = GLState::GetCallsMade() - callsBefore;
+    m_drawCalls = 1;
+
+    // Start fresh next frame.
+    m_draws.clear();
+    m_instances.clear();
+}
+
+void MeshBatch::SetBatching(bool batching)
+{
+    m_batching = batching;
+}
+
+bool MeshBatch::GetBatching()
+{
+    return m_batching;
+}
+
+unsigned int MeshBatch::GetDrawCalls()
+{
+    return m_drawCalls;
+}
+
+unsigned int MeshBatch::GetStateChanges()
+{
+    return m_stateChanges;
+}
+
+unsigned int MeshBatch::GetUnbatchedDrawCalls()
+{
+    return m_unbatchedDrawCalls;
+}
+
+unsigned int MeshBatch::GetUnbatchedStateChanges()
+{
+    return m_unbatchedStateChanges;
+}
@@ -0,0 +1,134 @@
+/*
+Title: Instanced Rendering
+File Name: programCache.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../header/programCache.h"
+#include "../header/cacheFile.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Start of every cache file, so that anything else that ends up in the directory gets ignored.
+struct ProgramCacheHeader
+{
+    char m_magic[4];
+    unsigned int m_version;
+    uint64_t m_key;
+    GLenum m_format;
+    GLint m_length;
+};
+static const char CACHE_MAGIC[4] = { 'P', 'B', 'I', 'N' };
+static const unsigned int CACHE_VERSION = 1;
+
+std::string ProgramCache::s_directory = "shaderCache";
+bool ProgramCache::s_enabled = true;
+
+void ProgramCache::SetDirectory(const std::string& directory)
+{
+    s_directory = directory;
+}
+
+void ProgramCache::SetEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool ProgramCache::GetEnabled()
+{
+    return s_enabled;
+}
+
+std::string ProgramCache::GetPath(uint64_t key)
+{
+    return GetCacheFilePath(s_directory, key, ".bin");
+}
+
+uint64_t ProgramCache::MakeKey(const uint64_t* sourceHashes, unsigned int count)
+{
+    // The source hashes, then the driver strings.
+    uint64_t key = HashBytes(sourceHashes, count * sizeof(uint64_t));
+    GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int s = 0; s < 3; s++)
+    {
+        key = HashString((const char*)glGetString(strings[s]), key);
+    }
+    return key;
+}
+
+bool ProgramCache::Load(GLuint program, uint64_t key)
+{
+    if (!s_enabled) return false;
+
+    // Some drivers can't load binaries at all.
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0) return false;
+
+    std::ifstream file(GetPath(key), std::ios::binary);
+    if (!file.good()) return false;
+
+    ProgramCacheHeader header;
+    file.read((char*)&header, sizeof(header));
+    if (!file.good() || memcmp(header.m_magic, CACHE_MAGIC, 4) != 0 || header.m_version != CACHE_VERSION || header.m_key != key || header.m_length <= 0)
+    {
+        return false;
+    }
+
+    std::vector<char> binary(header.m_length);
+    file.read(binary.data(), binary.size());
+    if (!file.good()) return false;
+
+    // The driver checks the binary itself, and fails the link if it doesn't like it (after a driver update, say).
+    glProgramBinary(program, header.m_format, binary.data(), binary.size());
+    GLint isLinked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    return isLinked != 0;
+}
+
+void ProgramCache::Save(GLuint program, uint64_t key)
+{
+    if (!s_enabled) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    ProgramCacheHeader header;
+    memcpy(header.m_magic, CACHE_MAGIC, 4);
+    header.m_version = CACHE_VERSION;
+    header.m_key = key;
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, &header.m_length, &header.m_format, binary.data());
+    if (header.m_length <= 0) return;
+
+    MakeCacheDirectory(s_directory);
+
+    std::ofstream file(GetPath(key), std::ios::binary);
+    if (!file.good())
+    {
+        std::cout << "Can't write program cache file: " << GetPath(key) << std::endl;
+        return;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write(binary.data(), header.m_length);
+}
@@ -0,0 +1,148 @@
+/*
+Title: Instanced Rendering
+File Name: radixSort.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/radixSort.h"
+#include "../header/jobSystem.h"
+#include <utility>
+
+// Below this many elements, handing out jobs costs more than it saves.
+static const unsigned int PARALLEL_THRESHOLD = 16384;
+static const unsigned int MAX_THREADS = 8;
+
+// Runs work(chunk) for every chunk, spread over the job system's threads if there's more than one chunk.
+template <typename Work>
+static void RunChunks(JobSystem* jobs, unsigned int chunkCount, const Work& work)
+{
+    if (chunkCount == 1)
+    {
+        work(0);
+        return;
+    }
+    jobs->ParallelFor(chunkCount, 1, [&work](unsigned int first, unsigned int count)
+    {
+        for (unsigned int chunk = first; chunk < first + count; chunk++) work(chunk);
+    });
+}
+
+template <typename Key>
+static void RadixSortImpl(std::vector<Key>& keys, std::vector<unsigned int>& values, unsigned int keyBytes, JobSystem* jobs)
+{
+    unsigned int count = keys.size();
+    if (count < 2) return;
+
+    // Small inputs are sorted on this thread, big ones are split into one chunk per job system thread.
+    unsigned int threadCount = 1;
+    if (count >= PARALLEL_THRESHOLD && jobs != nullptr)
+    {
+        threadCount = jobs->GetThreadCount();
+        if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+    }
+    unsigned int chunkSize = (count + threadCount - 1) / threadCount;
+
+    // Each pass reads from one pair of arrays and writes into the other.
+    std::vector<Key> tempKeys(count);
+    std::vector<unsigned int> tempValues(count);
+    Key* srcKeys = keys.data();
+    Key* dstKeys = tempKeys.data();
+    unsigned int* srcValues = values.data();
+    unsigned int* dstValues = tempValues.data();
+
+    // Every thread gets its own 256 bucket histogram.
+    std::vector<unsigned int> histograms(threadCount * 256);
+
+    for (unsigned int pass = 0; pass < keyBytes; pass++)
+    {
+        unsigned int shift = pass * 8;
+
+        // Count how many keys in each chunk land in each bucket.
+        RunChunks(jobs, threadCount, [&](unsigned int t)
+        {
+            unsigned int* histogram = &histograms[t * 256];
+            for (unsigned int d = 0; d < 256; d++) histogram[d] = 0;
+
+            unsigned int end = (t + 1) * chunkSize < count ? (t + 1) * chunkSize : count;
+            for (unsigned int i = t * chunkSize; i < end; i++)
+            {
+                histogram[(srcKeys[i] >> shift) & 0xFF]++;
+            }
+        });
+
+        // If every key has the same digit here, this pass wouldn't move anything.
+        bool skipPass = false;
+        for (unsigned int d = 0; d < 256 && !skipPass; d++)
+        {
+            unsigned int total = 0;
+            for (unsigned int t = 0; t < threadCount; t++) total += histograms[t * 256 + d];
+            skipPass = (total == count);
+        }
+        if (skipPass) continue;
+
+        // Turn the counts into starting offsets.
+        // Buckets go in digit order, and within a bucket, lower threads go first.
+        // Since lower threads own earlier elements, this keeps the sort stable.
+        unsigned int offset = 0;
+        for (unsigned int d = 0; d < 256; d++)
+        {
+            for (unsigned int t = 0; t < threadCount; t++)
+            {
+                unsigned int bucketCount = histograms[t * 256 + d];
+                histograms[t * 256 + d] = offset;
+                offset += bucketCount;
+            }
+        }
+
+        // Move every element into its bucket.
+        RunChunks(jobs, threadCount, [&](unsigned int t)
+        {
+            unsigned int* histogram = &histograms[t * 256];
+            unsigned int end = (t + 1) * chunkSize < count ? (t + 1) * chunkSize : count;
+            for (unsigned int i = t * chunkSize; i < end; i++)
+            {
+                unsigned int destination = histogram[(srcKeys[i] >> shift) & 0xFF]++;
+                dstKeys[destination] = srcKeys[i];
+                dstValues[destination] = srcValues[i];
+            }
+        });
+
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcValues, dstValues);
+    }
+
+    // If the result ended up in the temporary arrays, copy it back.
+    if (srcKeys != keys.data())
+    {
+        keys.swap(tempKeys);
+        values.swap(tempValues);
+    }
+}
+
+void RadixSort(std::vector<unsigned int>& keys, std::vector<unsigned int>& values, unsigned int keyBytes, JobSystem* jobs)
+{
+    RadixSortImpl(keys, values, keyBytes, jobs);
+}
+
+void RadixSort(std::vector<uint64_t>& keys, std::vector<unsigned int>& values, unsigned int keyBytes, JobSystem* jobs)
+{
+    RadixSortImpl(keys, values, keyBytes, jobs);
+}
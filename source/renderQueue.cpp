@@ -0,0 +1,286 @@
+/*
+Title: Instanced Rendering
+File Name: renderQueue.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../header/renderQueue.h"
+#include "../header/radixSort.h"
+#include "../header/glState.h"
+
+RenderQueue::RenderQueue()
+{
+    m_maxDepth = 1000;
+    m_jobs = nullptr;
+    m_drawCount = m_programChanges = m_materialChanges = m_meshChanges = 0;
+}
+
+void RenderQueue::SetMaxDepth(float maxDepth)
+{
+    m_maxDepth = maxDepth;
+}
+
+void RenderQueue::SetJobSystem(JobSystem* jobs)
+{
+    m_jobs = jobs;
+}
+
+template <typename T>
+unsigned int RenderQueue::FindId(std::unordered_map<T*, unsigned int>& ids, T* object, unsigned int bits)
+{
+    if (object == nullptr) return 0;
+
+    typename std::unordered_map<T*, unsigned int>::iterator found = ids.find(object);
+    if (found != ids.end()) return found->second;
+
+    // Once the ids run out, everything else shares the last one.
+    // Those draws still come out right, they just aren't grouped as well.
+    unsigned int maxId = (1u << bits) - 1;
+    unsigned int id = ids.size() + 1;
+    if (id >= maxId)
+    {
+        if (id == maxId) std::cout << "Render queue ran out of sort key ids, sorting will be less effective." << std::endl;
+        id = maxId;
+    }
+    ids[object] = id;
+    return id;
+}
+
+uint64_t RenderQueue::MakeKey(Pass pass, Material* material, Mesh* mesh, float depth)
+{
+    unsigned int program = FindId(m_programIds, material->GetShaderProgram(), SortKey::PROGRAM_BITS);
+    unsigned int materialId = FindId(m_materialIds, material, SortKey::MATERIAL_BITS);
+    unsigned int meshId = FindId(m_meshIds, mesh, SortKey::MESH_BITS);
+
+    // Depth goes in as a fraction of the max depth. Transparent things have to be drawn back to front instead.
+    return SortKey::Make(pass, program, materialId, meshId, depth / m_maxDepth, pass == TRANSPARENT_PASS);
+}
+
+void RenderQueue::Add(Pass pass, Material* material, Mesh* mesh, float depth, CommandType type, const void* data)
+{
+    RenderCommand command;
+    command.m_type = type;
+    command.m_material = material;
+    command.m_mesh = mesh;
+    command.m_data = data;
+
+    m_keys.push_back(MakeKey(pass, material, mesh, depth));
+    m_commands.push_back(command);
+}
+
+void RenderQueue::SubmitMesh(Pass pass, Material* material, Mesh* mesh, float depth)
+{
+    Add(pass, material, mesh, depth, DRAW_MESH, nullptr);
+}
+
+void RenderQueue::SubmitInstanced(Pass pass, Material* material, Mesh* mesh, InstanceBuffer* instances, float depth)
+{
+    Add(pass, material, mesh, depth, DRAW_INSTANCE_BUFFER, instances);
+}
+
+void RenderQueue::SubmitInstanced(Pass pass, Material* material, Mesh* mesh, const std::vector<glm::mat4>* matrices, float depth)
+{
+    Add(pass, material, mesh, depth, DRAW_MATRICES, matrices);
+}
+
+void RenderQueue::SubmitBatch(Pass pass, Material* material, MeshBatch* batch, float depth)
+{
+    // A batch draws many meshes through its own vao, so it doesn't have a mesh id.
+    Add(pass, material, nullptr, depth, DRAW_MESH_BATCH, batch);
+}
+
+void RenderQueue::SubmitSprites(Pass pass, Material* material, SpriteBatch* sprites, float depth)
+{
+    Add(pass, material, nullptr, depth, DRAW_SPRITE_BATCH, sprites);
+}
+
+void RenderQueue::SubmitCommands(Pass pass, Material* material, const std::vector<CommandBuffer*>* commands, float depth)
+{
+    Add(pass, material, nullptr, depth, DRAW_COMMANDS, commands);
+}
+
+void RenderQueue::BeginPass(Pass pass)
+{
+    switch (pass)
+    {
+    case OPAQUE_PASS:
+        GLState::SetEnabled(GL_DEPTH_TEST, true);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        GLState::SetEnabled(GL_BLEND, false);
+        break;
+    case SKY_PASS:
+        // The sky is drawn at the far plane, so it has to pass the depth test when it's equal.
+        GLState::SetEnabled(GL_DEPTH_TEST, true);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_TRUE);
+        GLState::SetEnabled(GL_BLEND, false);
+        break;
+    case TRANSPARENT_PASS:
+        // Test against what's already there, but don't hide things behind from each other.
+        GLState::SetEnabled(GL_DEPTH_TEST, true);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_FALSE);
+        GLState::SetEnabled(GL_BLEND, true);
+        GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    case OVERLAY_PASS:
+        // Drawn over everything.
+        GLState::SetEnabled(GL_DEPTH_TEST, false);
+        glDepthMask(GL_FALSE);
+        GLState::SetEnabled(GL_BLEND, true);
+        GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+    }
+}
+
+void RenderQueue::Execute()
+{
+    m_drawCount = m_programChanges = m_materialChanges = m_meshChanges = 0;
+    m_commandBackend.Reset();
+
+    unsigned int count = m_keys.size();
+    if (count == 0) return;
+
+    // Sort the keys, carrying along where each one's command is.
+    m_order.resize(count);
+    for (unsigned int i = 0; i < count; i++) m_order[i] = i;
+    RadixSort(m_keys, m_order, 8, m_jobs);
+
+    // Walk the draws in key order, only changing what differs from the draw before.
+    unsigned int pass = 0xffffffff;
+    Material* material = nullptr;
+    ShaderProgram* program = nullptr;
+    Mesh* mesh = nullptr;
+    // False while the current material's program is still building (and it has no fallback).
+    bool materialBound = false;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const RenderCommand& command = m_commands[m_order[i]];
+
+        unsigned int commandPass = SortKey::GetPass(m_keys[i]);
+        if (commandPass != pass)
+        {
+            pass = commandPass;
+            BeginPass((Pass)pass);
+        }
+
+        if (command.m_material != material)
+        {
+            if (material != nullptr) material->Unbind();
+            if (command.m_material->GetShaderProgram() != program)
+            {
+                program = command.m_material->GetShaderProgram();
+                m_programChanges++;
+            }
+            material = command.m_material;
+            materialBound = material->Bind();
+            m_materialChanges++;
+        }
+
+        // Nothing to draw with yet, so skip it. It'll show up once the program is ready.
+        if (!materialBound) continue;
+
+        if (command.m_mesh != mesh)
+        {
+            mesh = command.m_mesh;
+            if (mesh != nullptr) m_meshChanges++;
+        }
+
+        switch (command.m_type)
+        {
+        case DRAW_MESH:
+            command.m_mesh->Draw();
+            break;
+        case DRAW_INSTANCE_BUFFER:
+            command.m_mesh->DrawInstanced((InstanceBuffer*)command.m_data);
+            break;
+        case DRAW_MATRICES:
+            command.m_mesh->DrawInstanced(*(const std::vector<glm::mat4>*)command.m_data);
+            break;
+        case DRAW_MESH_BATCH:
+            ((MeshBatch*)command.m_data)->Submit();
+            break;
+        case DRAW_SPRITE_BATCH:
+            ((SpriteBatch*)command.m_data)->Flush();
+            break;
+        case DRAW_COMMANDS:
+        {
+            // The material is already bound, so the backend starts from there instead of binding it again.
+            const std::vector<CommandBuffer*>& buffers = *(const std::vector<CommandBuffer*>*)command.m_data;
+            m_commandBackend.SetBoundMaterial(material, materialBound);
+            for (unsigned int b = 0; b < buffers.size(); b++)
+            {
+                buffers[b]->Replay(m_commandBackend);
+            }
+            m_commandBackend.Flush();
+
+            // The buffers may have bound other materials along the way, so catch up with whatever they left bound.
+            if (m_commandBackend.GetMaterial() != material)
+            {
+                material = m_commandBackend.GetMaterial();
+                materialBound = m_commandBackend.IsMaterialReady();
+                if (material->GetShaderProgram() != program)
+                {
+                    program = material->GetShaderProgram();
+                    m_programChanges++;
+                }
+                m_materialChanges++;
+            }
+            break;
+        }
+        }
+        m_drawCount++;
+    }
+
+    if (material != nullptr) material->Unbind();
+
+    // Leave things the way the rest of the program expects them.
+    BeginPass(OPAQUE_PASS);
+
+    // Start fresh next frame.
+    m_keys.clear();
+    m_commands.clear();
+}
+
+CommandBackend& RenderQueue::GetCommandBackend()
+{
+    return m_commandBackend;
+}
+
+unsigned int RenderQueue::GetDrawCount()
+{
+    return m_drawCount;
+}
+
+unsigned int RenderQueue::GetProgramChanges()
+{
+    return m_programChanges;
+}
+
+unsigned int RenderQueue::GetMaterialChanges()
+{
+    return m_materialChanges;
+}
+
+unsigned int RenderQueue::GetMeshChanges()
+{
+    return m_meshChanges;
+}
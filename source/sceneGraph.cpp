@@ -0,0 +1,290 @@
+/*
+Title: Instanced Rendering
+File Name: sceneGraph.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/sceneGraph.h"
+#include "../header/transform3d.h"
+#include <algorithm>
+#include <iostream>
+
+const unsigned int SceneGraph::NO_NODE;
+
+SceneGraph::SceneGraph()
+{
+    m_nodesUpdated = 0;
+}
+
+void SceneGraph::MarkDirty(unsigned int slot)
+{
+    if (!m_dirty[slot])
+    {
+        m_dirty[slot] = 1;
+        m_dirtySlots.push_back(slot);
+    }
+}
+
+void SceneGraph::Reorder(const std::vector<unsigned int>& order)
+{
+    // Where every old slot ends up. Slots that aren't in the new order are gone.
+    std::vector<unsigned int> newSlots(m_slotIds.size(), NO_NODE);
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        newSlots[order[i]] = i;
+    }
+
+    std::vector<glm::mat4> localMatrices(order.size());
+    std::vector<glm::mat4> worldMatrices(order.size());
+    std::vector<unsigned int> parents(order.size());
+    std::vector<unsigned int> slotIds(order.size());
+    std::vector<unsigned char> dirty(order.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        unsigned int old = order[i];
+        localMatrices[i] = m_localMatrices[old];
+        worldMatrices[i] = m_worldMatrices[old];
+        parents[i] = m_parents[old] == NO_NODE ? NO_NODE : newSlots[m_parents[old]];
+        slotIds[i] = m_slotIds[old];
+        dirty[i] = m_dirty[old];
+        m_idSlots[slotIds[i]] = i;
+    }
+    m_localMatrices.swap(localMatrices);
+    m_worldMatrices.swap(worldMatrices);
+    m_parents.swap(parents);
+    m_slotIds.swap(slotIds);
+    m_dirty.swap(dirty);
+
+    // Children always come after their parents, so walking backwards, every subtree is finished before its parent sees it.
+    m_subtreeEnds.resize(order.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        m_subtreeEnds[i] = i + 1;
+    }
+    for (unsigned int i = order.size(); i-- > 0;)
+    {
+        if (m_parents[i] != NO_NODE)
+        {
+            m_subtreeEnds[m_parents[i]] = std::max(m_subtreeEnds[m_parents[i]], m_subtreeEnds[i]);
+        }
+    }
+
+    // Dirty slots have moved too.
+    m_dirtySlots.clear();
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        if (m_dirty[i])
+        {
+            m_dirtySlots.push_back(i);
+        }
+    }
+}
+
+unsigned int SceneGraph::AddNode(unsigned int parent, glm::mat4 local)
+{
+    // Reuse an old id if there is one.
+    unsigned int id;
+    if (!m_freeIds.empty())
+    {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else
+    {
+        id = m_idSlots.size();
+        m_idSlots.push_back(NO_NODE);
+    }
+
+    // Start out as a root at the very end.
+    unsigned int slot = m_slotIds.size();
+    m_idSlots[id] = slot;
+    m_slotIds.push_back(id);
+    m_localMatrices.push_back(local);
+    m_worldMatrices.push_back(local);
+    m_parents.push_back(NO_NODE);
+    m_subtreeEnds.push_back(slot + 1);
+    m_dirty.push_back(0);
+    MarkDirty(slot);
+
+    // If the parent's subtree is also at the end, this doesn't move anything.
+    if (parent != NO_NODE)
+    {
+        SetParent(id, parent);
+    }
+    return id;
+}
+
+void SceneGraph::RemoveNode(unsigned int node)
+{
+    unsigned int first = m_idSlots[node];
+    unsigned int end = m_subtreeEnds[first];
+
+    // Keep everything outside of the subtree, in the same order.
+    std::vector<unsigned int> order;
+    order.reserve(m_slotIds.size() - (end - first));
+    for (unsigned int i = 0; i < m_slotIds.size(); i++)
+    {
+        if (i < first || i >= end)
+        {
+            order.push_back(i);
+        }
+    }
+
+    // The removed ids can be handed out again.
+    for (unsigned int i = first; i < end; i++)
+    {
+        m_idSlots[m_slotIds[i]] = NO_NODE;
+        m_freeIds.push_back(m_slotIds[i]);
+    }
+
+    Reorder(order);
+}
+
+void SceneGraph::SetParent(unsigned int node, unsigned int parent)
+{
+    unsigned int first = m_idSlots[node];
+    unsigned int end = m_subtreeEnds[first];
+    unsigned int count = m_slotIds.size();
+
+    // The subtree goes right after the end of the new parent's subtree (or at the very end, for roots).
+    unsigned int parentSlot = parent == NO_NODE ? NO_NODE : m_idSlots[parent];
+    unsigned int insertAt = parent == NO_NODE ? count : m_subtreeEnds[parentSlot];
+
+    if (parentSlot != NO_NODE && parentSlot >= first && parentSlot < end)
+    {
+        std::cout << "Error: Can't make a scene node the child of its own descendant!" << std::endl;
+        return;
+    }
+
+    // If the subtree is already a root sitting right where it needs to go, only the parent's ranges grow.
+    // This is always the case when building a tree one node at a time, in depth first order.
+    if (m_parents[first] == NO_NODE && insertAt == first)
+    {
+        m_parents[first] = parentSlot;
+        for (unsigned int ancestor = parentSlot; ancestor != NO_NODE; ancestor = m_parents[ancestor])
+        {
+            m_subtreeEnds[ancestor] += end - first;
+        }
+        MarkDirty(first);
+        return;
+    }
+
+    // Otherwise, cut the subtree out and put it back in at its new place.
+    std::vector<unsigned int> order;
+    order.reserve(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (i == insertAt)
+        {
+            for (unsigned int j = first; j < end; j++) order.push_back(j);
+        }
+        if (i < first || i >= end)
+        {
+            order.push_back(i);
+        }
+    }
+    if (insertAt == count)
+    {
+        for (unsigned int j = first; j < end; j++) order.push_back(j);
+    }
+
+    m_parents[first] = parentSlot;
+    Reorder(order);
+    MarkDirty(m_idSlots[node]);
+}
+
+unsigned int SceneGraph::GetParent(unsigned int node)
+{
+    unsigned int parentSlot = m_parents[m_idSlots[node]];
+    return parentSlot == NO_NODE ? NO_NODE : m_slotIds[parentSlot];
+}
+
+unsigned int SceneGraph::GetCount()
+{
+    return m_slotIds.size();
+}
+
+void SceneGraph::SetLocalMatrix(unsigned int node, glm::mat4 local)
+{
+    unsigned int slot = m_idSlots[node];
+    m_localMatrices[slot] = local;
+    MarkDirty(slot);
+}
+
+void SceneGraph::SetLocalTransform(unsigned int node, Transform3D& transform)
+{
+    SetLocalMatrix(node, transform.GetMatrix());
+}
+
+glm::mat4 SceneGraph::GetLocalMatrix(unsigned int node)
+{
+    return m_localMatrices[m_idSlots[node]];
+}
+
+void SceneGraph::Update()
+{
+    m_nodesUpdated = 0;
+
+    // Going through the changed nodes in slot order keeps the whole update moving forward through memory.
+    std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+
+    // Everything before this slot is already up to date.
+    unsigned int updatedUntil = 0;
+    for (unsigned int i = 0; i < m_dirtySlots.size(); i++)
+    {
+        unsigned int first = m_dirtySlots[i];
+        // This node was under one we already did.
+        if (first < updatedUntil)
+        {
+            continue;
+        }
+
+        // Every parent comes before its children, so their world matrices are always ready in time.
+        unsigned int end = m_subtreeEnds[first];
+        for (unsigned int slot = first; slot < end; slot++)
+        {
+            unsigned int parent = m_parents[slot];
+            if (parent == NO_NODE)
+            {
+                m_worldMatrices[slot] = m_localMatrices[slot];
+            }
+            else
+            {
+                m_worldMatrices[slot] = m_worldMatrices[parent] * m_localMatrices[slot];
+            }
+            m_dirty[slot] = 0;
+        }
+
+        m_nodesUpdated += end - first;
+        updatedUntil = end;
+    }
+    m_dirtySlots.clear();
+}
+
+glm::mat4 SceneGraph::GetWorldMatrix(unsigned int node)
+{
+    return m_worldMatrices[m_idSlots[node]];
+}
+
+unsigned int SceneGraph::GetNodesUpdated()
+{
+    return m_nodesUpdated;
+}
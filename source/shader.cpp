@@ -23,12 +23,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "..\header\shader.h"
+#include "../header/cacheFile.h"
+#include <sys/stat.h>
 
 Shader::Shader(std::string filePath, GLenum shaderType)
 {
+    m_type = shaderType;
     InitFromFile(filePath, shaderType);
 }
 
+Shader::Shader(GLenum shaderType)
+{
+    m_type = shaderType;
+}
+
 Shader::~Shader()
 {
 	// Only delete the shader index if it was initialized successfully.
@@ -40,6 +48,7 @@ Shader::~Shader()
 
 GLuint Shader::GetGLShader()
 {
+    Compile();
     return m_shader;
 }
 
@@ -48,8 +57,37 @@ GLenum Shader::GetGLShaderType()
     return m_type;
 }
 
-bool Shader::InitFromFile(std::string filePath, GLenum shaderType)
+bool Shader::HasSource()
 {
+    return !m_source.empty();
+}
+
+uint64_t Shader::GetSourceHash()
+{
+    return m_sourceHash;
+}
+
+std::string Shader::s_precompiledDirectory = "shaders/";
+
+void Shader::SetPrecompiledDirectory(std::string directory)
+{
+	s_precompiledDirectory = directory;
+}
+
+bool Shader::ReadSource(std::string filePath, std::string& fileContents)
+{
+	// Look for a copy of the file made by the shaders build target.
+	// It's already been checked and has no comments, so it's quicker for the driver to get through.
+	// If the original has been edited since, it wins, so changes show up without rebuilding.
+	size_t nameStart = filePath.find_last_of("/\\");
+	std::string precompiledPath = s_precompiledDirectory + filePath.substr(nameStart == std::string::npos ? 0 : nameStart + 1);
+	struct stat sourceInfo;
+	struct stat precompiledInfo;
+	if (stat(precompiledPath.c_str(), &precompiledInfo) == 0 &&
+		(stat(filePath.c_str(), &sourceInfo) != 0 || precompiledInfo.st_mtime >= sourceInfo.st_mtime))
+	{
+		filePath = precompiledPath;
+	}
 
 	std::ifstream file(filePath);
 
@@ -66,18 +104,27 @@ bool Shader::InitFromFile(std::string filePath, GLenum shaderType)
 	// Here we find the end of the file.
 	file.seekg(0, std::ios::end);
 
-	// Make a string and set its size equal to the length of the file.
-	std::string shaderCode;
-	shaderCode.resize((size_t)file.tellg());
+	// Make the string's size equal to the length of the file.
+	fileContents.resize((size_t)file.tellg());
 
 	// Go back to the beginning of the file.
 	file.seekg(0, std::ios::beg);
 
 	// Read the file into the string until we reach the end of the string.
-	file.read(&shaderCode[0], shaderCode.size());
+	file.read(&fileContents[0], fileContents.size());
 
 	// Close the file.
 	file.close();
+	return true;
+}
+
+bool Shader::InitFromFile(std::string filePath, GLenum shaderType)
+{
+	std::string shaderCode;
+	if (!ReadSource(filePath, shaderCode))
+	{
+		return false;
+	}
 
 	// Init using the string.
 	return InitFromString(shaderCode, shaderType);
@@ -86,15 +133,79 @@ bool Shader::InitFromFile(std::string filePath, GLenum shaderType)
 bool Shader::InitFromString(std::string shaderCode, GLenum shaderType)
 {
 	m_type = shaderType;
-	m_shader = glCreateShader(shaderType);
+	m_source = shaderCode;
+	m_compileFailed = false;
+
+	// Throw away anything compiled from older source.
+	if (m_shader != 0)
+	{
+		glDeleteShader(m_shader);
+		m_shader = 0;
+	}
+
+	// The stage and the source, so the same text compiled as another stage gets a different key.
+	m_sourceHash = HashBytes(&m_type, sizeof(m_type));
+	m_sourceHash = HashBytes(m_source.data(), m_source.size(), m_sourceHash);
+
+	return true;
+}
+
+int Shader::s_parallelCompile = -1;
+
+bool Shader::HasParallelCompile()
+{
+	if (s_parallelCompile == -1)
+	{
+		s_parallelCompile = 0;
+		typedef void (GLAPIENTRY *MaxShaderCompilerThreadsProc)(GLuint count);
+		MaxShaderCompilerThreadsProc maxShaderCompilerThreads = nullptr;
+		if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+			maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+		else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+			maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+
+		if (maxShaderCompilerThreads != nullptr)
+		{
+			// Let the driver use as many threads as it likes.
+			maxShaderCompilerThreads(0xFFFFFFFF);
+			s_parallelCompile = 1;
+		}
+	}
+	return s_parallelCompile == 1;
+}
+
+void Shader::StartCompile()
+{
+	if (m_shader != 0 || m_compileFailed || m_source.empty()) return;
+
+	m_shader = glCreateShader(m_type);
 
 	// Get the char* and length
-	const char* shaderCodePointer = shaderCode.data();
-	int shaderCodeLength = shaderCode.size();
+	const char* shaderCodePointer = m_source.data();
+	int shaderCodeLength = m_source.size();
 
 	// Set the source code and compile.
+	// Asking for the result right away would wait for the compile, so that's left for later.
 	glShaderSource(m_shader, 1, &shaderCodePointer, &shaderCodeLength);
 	glCompileShader(m_shader);
+	m_compileChecked = false;
+}
+
+bool Shader::IsCompileComplete()
+{
+	if (m_shader == 0 || m_compileChecked || !HasParallelCompile()) return true;
+
+	GLint isComplete;
+	glGetShaderiv(m_shader, GL_COMPLETION_STATUS_KHR, &isComplete);
+	return isComplete != 0;
+}
+
+bool Shader::Compile()
+{
+	StartCompile();
+	if (m_shader == 0) return false;
+	if (m_compileChecked) return true;
+	m_compileChecked = true;
 
 	GLint isCompiled;
 
@@ -111,6 +222,7 @@ bool Shader::InitFromString(std::string shaderCode, GLenum shaderType)
 		// Delete the shader, and set the index to zero so that this object knows it doesn't have a shader.
 		glDeleteShader(m_shader);
 		m_shader = 0;
+		m_compileFailed = true;
 		return false;
 	}
 	else
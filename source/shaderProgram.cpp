@@ -22,6 +22,10 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "..\header\shaderProgram.h"
+#include "../header/glState.h"
+#include "../header/frameUniforms.h"
+#include "../header/material.h"
+#include "../header/programCache.h"
 
 ShaderProgram::ShaderProgram()
 {
@@ -30,7 +34,7 @@ ShaderProgram::ShaderProgram()
 
 ShaderProgram::~ShaderProgram()
 {
-    glDeleteProgram(m_shaderProgram);
+    GLState::DeleteProgram(m_shaderProgram);
 
     // Decrement ref counts on shaders if this object is deleted.
     if (m_vertexShader != nullptr)
@@ -70,12 +74,12 @@ void ShaderProgram::AttachShader(Shader* shader)
     // Replace it with the new shader
     *currentShader = shader;
 
-    // Attach the gl shader to the shader program.
-    if (shader->GetGLShader() != 0)
+    // Nothing is compiled or attached on the gl side until the program links,
+    // since it might come out of the program cache instead.
+    if (shader->HasSource())
     {
-        glAttachShader(m_shaderProgram, shader->GetGLShader());
         // ShaderProgram must be rebuilt
-        m_programBuilt = false;
+        m_buildState = NOT_BUILT;
     }
     else
     {
@@ -84,21 +88,267 @@ void ShaderProgram::AttachShader(Shader* shader)
     }
 }
 
-void ShaderProgram::Bind()
+void ShaderProgram::StartBuild()
+{
+    if (m_buildState != NOT_BUILT)
+    {
+        return;
+    }
+
+    // Linking resets every uniform, so no material's values are set anymore.
+    m_lastMaterial = nullptr;
+
+    // If an earlier run saved this exact program, load that instead of compiling anything.
+    uint64_t sourceHashes[2] = {
+        m_vertexShader != nullptr ? m_vertexShader->GetSourceHash() : 0,
+        m_fragmentShader != nullptr ? m_fragmentShader->GetSourceHash() : 0 };
+    m_cacheKey = ProgramCache::MakeKey(sourceHashes, 2);
+    if (ProgramCache::Load(m_shaderProgram, m_cacheKey))
+    {
+        FinishBuild(true);
+        return;
+    }
+
+    // Otherwise start compiling both shaders, and come back for them later.
+    if (m_vertexShader != nullptr) m_vertexShader->StartCompile();
+    if (m_fragmentShader != nullptr) m_fragmentShader->StartCompile();
+    m_buildState = COMPILING;
+}
+
+bool ShaderProgram::AdvanceBuild(bool wait)
 {
-    if (!m_programBuilt)
+    StartBuild();
+
+    if (m_buildState == COMPILING)
     {
-        // if the program hasn't been built, build it and get uniform data
+        if (!wait)
+        {
+            if (m_vertexShader != nullptr && !m_vertexShader->IsCompileComplete()) return false;
+            if (m_fragmentShader != nullptr && !m_fragmentShader->IsCompileComplete()) return false;
+        }
+
+        // Swap out whatever shaders were attached for the current ones.
+        GLuint attached[2];
+        GLsizei attachedCount = 0;
+        glGetAttachedShaders(m_shaderProgram, 2, &attachedCount, attached);
+        for (GLsizei i = 0; i < attachedCount; i++)
+        {
+            glDetachShader(m_shaderProgram, attached[i]);
+        }
+        if (m_vertexShader != nullptr && m_vertexShader->GetGLShader() != 0)
+            glAttachShader(m_shaderProgram, m_vertexShader->GetGLShader());
+        if (m_fragmentShader != nullptr && m_fragmentShader->GetGLShader() != 0)
+            glAttachShader(m_shaderProgram, m_fragmentShader->GetGLShader());
+
+        // Ask to be able to read the binary back, so it can go in the cache.
+        glProgramParameteri(m_shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(m_shaderProgram);
-        m_programBuilt = true;
+        m_buildState = LINKING;
+
+        // Without a way to ask if the link is done, give it until the next call before waiting on it.
+        if (!wait && !Shader::HasParallelCompile()) return false;
     }
 
-    glUseProgram(m_shaderProgram);
+    if (m_buildState == LINKING)
+    {
+        if (!wait && Shader::HasParallelCompile())
+        {
+            GLint isComplete;
+            glGetProgramiv(m_shaderProgram, GL_COMPLETION_STATUS_KHR, &isComplete);
+            if (!isComplete) return false;
+        }
+
+        GLint isLinked;
+        glGetProgramiv(m_shaderProgram, GL_LINK_STATUS, &isLinked);
+        if (isLinked)
+        {
+            ProgramCache::Save(m_shaderProgram, m_cacheKey);
+        }
+        FinishBuild(isLinked != 0);
+    }
+
+    return true;
+}
+
+void ShaderProgram::FinishBuild(bool linked)
+{
+    if (!linked)
+    {
+        char infolog[1024];
+        glGetProgramInfoLog(m_shaderProgram, 1024, NULL, infolog);
+        std::cout << "Shader program link failed with error: " << std::endl << infolog << std::endl;
+        m_uniforms.clear();
+        m_parameterBlockSize = 0;
+        m_buildState = BUILD_FAILED;
+        return;
+    }
+
+    // Hook the per frame uniform block up to its binding point, if this program uses it.
+    GLuint frameBlock = glGetUniformBlockIndex(m_shaderProgram, FrameUniforms::BLOCK_NAME);
+    if (frameBlock != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_shaderProgram, frameBlock, FrameUniforms::BINDING);
+    }
+
+    // Same for the material parameter block, which each material fills with its own values.
+    m_parameterBlockSize = 0;
+    GLuint parameterBlock = glGetUniformBlockIndex(m_shaderProgram, Material::PARAMETER_BLOCK_NAME);
+    if (parameterBlock != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(m_shaderProgram, parameterBlock, Material::PARAMETER_BINDING);
+        glGetActiveUniformBlockiv(m_shaderProgram, parameterBlock, GL_UNIFORM_BLOCK_DATA_SIZE, &m_parameterBlockSize);
+    }
+
+    ReflectUniforms();
+    m_buildState = BUILT;
+}
+
+bool ShaderProgram::Link()
+{
+    // Finish building, however long that takes.
+    AdvanceBuild(true);
+    return m_buildState == BUILT;
+}
+
+bool ShaderProgram::IsReady()
+{
+    // Move the build along as far as it can go without waiting.
+    AdvanceBuild(false);
+    return m_buildState == BUILT;
+}
+
+bool ShaderProgram::HasFailed()
+{
+    return m_buildState == BUILD_FAILED;
+}
+
+void ShaderProgram::ReflectUniforms()
+{
+    m_uniforms.clear();
+
+    GLint count;
+    GLint maxLength;
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    GLuint parameterBlock = glGetUniformBlockIndex(m_shaderProgram, Material::PARAMETER_BLOCK_NAME);
+
+    std::string name;
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++)
+    {
+        UniformInfo info;
+        GLsizei length;
+        glGetActiveUniform(m_shaderProgram, i, maxLength, &length, &info.m_size, &info.m_type, &name[0]);
+        info.m_name = name.substr(0, length);
+
+        // Arrays are reported as "name[0]". Store them as just "name", which gives the same location.
+        if (info.m_name.size() > 3 && info.m_name.compare(info.m_name.size() - 3, 3, "[0]") == 0)
+        {
+            info.m_name.resize(info.m_name.size() - 3);
+        }
+
+        // Uniforms inside uniform blocks don't have locations, so they aren't set this way.
+        // The exception is the material parameter block, where materials write values straight into the block's memory.
+        info.m_location = glGetUniformLocation(m_shaderProgram, info.m_name.c_str());
+        info.m_blockOffset = -1;
+        if (info.m_location == -1)
+        {
+            GLuint index = i;
+            GLint blockIndex;
+            glGetActiveUniformsiv(m_shaderProgram, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+            if (parameterBlock == GL_INVALID_INDEX || blockIndex != (GLint)parameterBlock)
+            {
+                continue;
+            }
+            glGetActiveUniformsiv(m_shaderProgram, 1, &index, GL_UNIFORM_OFFSET, &info.m_blockOffset);
+        }
+
+        m_uniforms.insert(std::make_pair(HashName(info.m_name.c_str()), info));
+    }
+}
+
+unsigned int ShaderProgram::HashName(const char* name)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (const char* c = name; *c != 0; c++)
+    {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+GLint ShaderProgram::GetUniformLocation(const char* name)
+{
+    if (!Link())
+    {
+        return -1;
+    }
+
+    // The hash only narrows it down, the name has to match too.
+    typedef std::unordered_multimap<unsigned int, UniformInfo>::iterator Iterator;
+    std::pair<Iterator, Iterator> found = m_uniforms.equal_range(HashName(name));
+    for (Iterator uniform = found.first; uniform != found.second; uniform++)
+    {
+        if (uniform->second.m_name == name)
+        {
+            return uniform->second.m_location;
+        }
+    }
+
+    // Not a name reflection knows about, but opengl might still (like "lights[2]").
+    return glGetUniformLocation(m_shaderProgram, name);
+}
+
+GLint ShaderProgram::GetUniformLocation(unsigned int nameHash)
+{
+    Link();
+
+    std::unordered_multimap<unsigned int, UniformInfo>::iterator uniform = m_uniforms.find(nameHash);
+    if (uniform == m_uniforms.end())
+    {
+        return -1;
+    }
+    return uniform->second.m_location;
+}
+
+const std::unordered_multimap<unsigned int, UniformInfo>& ShaderProgram::GetUniforms()
+{
+    Link();
+    return m_uniforms;
+}
+
+GLint ShaderProgram::GetParameterBlockSize()
+{
+    Link();
+    return m_parameterBlockSize;
+}
+
+Material* ShaderProgram::GetLastMaterial()
+{
+    return m_lastMaterial;
+}
+
+void ShaderProgram::SetLastMaterial(Material* material)
+{
+    m_lastMaterial = material;
+}
+
+void ShaderProgram::Bind()
+{
+    Link();
+    GLState::UseProgram(m_shaderProgram);
 }
 
 void ShaderProgram::Unbind()
 {
-    glUseProgram(0);
+    // The next Bind skips this if it's the same program, so only unbind when debugging.
+    if (GLState::GetDebugUnbind())
+    {
+        GLState::UseProgram(0);
+    }
 }
 
 void ShaderProgram::IncRefCount()
@@ -0,0 +1,162 @@
+/*
+Title: Instanced Rendering
+File Name: shaderVariants.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/shaderVariants.h"
+#include <sstream>
+
+ShaderVariants::ShaderVariants(std::string vertexFilePath, std::string fragmentFilePath)
+{
+    Shader::ReadSource(vertexFilePath, m_vertexSource);
+    Shader::ReadSource(fragmentFilePath, m_fragmentSource);
+    m_vertexKeywords = ParseKeywords(m_vertexSource);
+    m_fragmentKeywords = ParseKeywords(m_fragmentSource);
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    // Let go of everything that was built. Anything a material still uses stays alive until the material lets go too.
+    for (auto it = m_programs.begin(); it != m_programs.end(); it++)
+    {
+        it->second->DecRefCount();
+    }
+    for (auto it = m_vertexShaders.begin(); it != m_vertexShaders.end(); it++)
+    {
+        it->second->DecRefCount();
+    }
+    for (auto it = m_fragmentShaders.begin(); it != m_fragmentShaders.end(); it++)
+    {
+        it->second->DecRefCount();
+    }
+}
+
+uint32_t ShaderVariants::ParseKeywords(const std::string& source)
+{
+    uint32_t stageKeywords = 0;
+    std::istringstream lines(source);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word) || word != "#pragma") continue;
+        if (!(words >> word) || word != "keywords") continue;
+
+        while (words >> word)
+        {
+            uint32_t bit = GetKeyword(word.c_str());
+            if (bit == 0)
+            {
+                // The key is 32 bits, so that's as many keywords as there can be.
+                if (m_keywords.size() == 32)
+                {
+                    std::cout << "Too many shader keywords, ignoring: " << word << std::endl;
+                    continue;
+                }
+                m_keywords.push_back(word);
+                bit = 1u << (m_keywords.size() - 1);
+            }
+            stageKeywords |= bit;
+        }
+    }
+    return stageKeywords;
+}
+
+std::string ShaderVariants::MakeSource(const std::string& source, uint32_t keywords)
+{
+    std::string defines;
+    for (unsigned int i = 0; i < m_keywords.size(); i++)
+    {
+        if (keywords & (1u << i))
+        {
+            defines += "#define " + m_keywords[i] + "\n";
+        }
+    }
+
+    // #version has to come first, so the defines go on the line after it.
+    // (Without one, they can just go at the start.)
+    size_t insertAt = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos)
+    {
+        size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+
+    std::string variantSource = source;
+    variantSource.insert(insertAt, defines);
+    return variantSource;
+}
+
+Shader* ShaderVariants::GetShader(std::unordered_map<uint32_t, Shader*>& shaders, const std::string& source, GLenum shaderType, uint32_t keywords)
+{
+    auto found = shaders.find(keywords);
+    if (found != shaders.end())
+    {
+        return found->second;
+    }
+
+    Shader* shader = new Shader(shaderType);
+    shader->InitFromString(MakeSource(source, keywords), shaderType);
+    shader->IncRefCount();
+    shaders[keywords] = shader;
+    return shader;
+}
+
+uint32_t ShaderVariants::GetKeyword(const char* keyword)
+{
+    for (unsigned int i = 0; i < m_keywords.size(); i++)
+    {
+        if (m_keywords[i] == keyword)
+        {
+            return 1u << i;
+        }
+    }
+    return 0;
+}
+
+ShaderProgram* ShaderVariants::GetProgram(uint32_t keywords)
+{
+    // Bits that nothing declared can't change the program, so they're dropped from the key.
+    keywords &= m_vertexKeywords | m_fragmentKeywords;
+
+    auto found = m_programs.find(keywords);
+    if (found != m_programs.end())
+    {
+        return found->second;
+    }
+
+    // First time this combination is needed, so build it now.
+    ShaderProgram* program = new ShaderProgram();
+    program->AttachShader(GetShader(m_vertexShaders, m_vertexSource, GL_VERTEX_SHADER, keywords & m_vertexKeywords));
+    program->AttachShader(GetShader(m_fragmentShaders, m_fragmentSource, GL_FRAGMENT_SHADER, keywords & m_fragmentKeywords));
+    program->StartBuild();
+    program->IncRefCount();
+    m_programs[keywords] = program;
+    return program;
+}
+
+unsigned int ShaderVariants::GetProgramCount()
+{
+    return m_programs.size();
+}
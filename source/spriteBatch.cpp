@@ -0,0 +1,213 @@
+/*
+Title: Instanced Rendering
+File Name: spriteBatch.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/spriteBatch.h"
+#include "../header/glState.h"
+#include "../header/radixSort.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+SpriteBatch::SpriteBatch()
+{
+    m_writeOffset = 0;
+    m_drawCalls = m_spriteCount = 0;
+    m_jobs = nullptr;
+
+    // Every sprite is two triangles, so the index pattern is always the same. Build it once.
+    std::vector<unsigned int> indices;
+    indices.reserve(MAX_SPRITES * 6);
+    for (unsigned int i = 0; i < MAX_SPRITES; i++)
+    {
+        unsigned int v = i * 4;
+        indices.push_back(v);
+        indices.push_back(v + 1);
+        indices.push_back(v + 2);
+        indices.push_back(v);
+        indices.push_back(v + 2);
+        indices.push_back(v + 3);
+    }
+
+    glGenVertexArrays(1, &m_vao);
+    GLState::BindVertexArray(m_vao);
+
+    // The vertex buffer starts out empty. It gets filled in a little more each flush.
+    glGenBuffers(1, &m_vertexBuffer);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, MAX_SPRITES * BUFFER_FLUSHES * 4 * sizeof(SpriteVertex), nullptr, GL_STREAM_DRAW);
+
+    glGenBuffers(1, &m_indexBuffer);
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, m_position));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, m_uv));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, m_color));
+
+    GLState::BindVertexArray(0);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    GLState::DeleteVertexArrays(1, &m_vao);
+    GLState::DeleteBuffers(1, &m_vertexBuffer);
+    GLState::DeleteBuffers(1, &m_indexBuffer);
+}
+
+void SpriteBatch::Draw(Texture* texture, glm::mat3 matrix, glm::vec2 size, glm::vec4 color, glm::vec4 uvRect, unsigned char layer)
+{
+    glm::vec2 half = size * .5f;
+
+    // Corners in the sprite's own space, and where they sample the texture.
+    // Images are stored bottom row first, so v is flipped.
+    glm::vec2 corners[4] = { glm::vec2(-half.x, -half.y), glm::vec2(half.x, -half.y), glm::vec2(half.x, half.y), glm::vec2(-half.x, half.y) };
+    glm::vec2 uvs[4] = { glm::vec2(uvRect.x, 1 - uvRect.y), glm::vec2(uvRect.z, 1 - uvRect.y), glm::vec2(uvRect.z, 1 - uvRect.w), glm::vec2(uvRect.x, 1 - uvRect.w) };
+
+    // Move the corners to the screen now, so all sprites can share one buffer no matter how they're placed.
+    for (int i = 0; i < 4; i++)
+    {
+        SpriteVertex vertex;
+        vertex.m_position = glm::vec2(matrix * glm::vec3(corners[i], 1));
+        vertex.m_uv = uvs[i];
+        vertex.m_color = color;
+        m_vertices.push_back(vertex);
+    }
+
+    m_textures.push_back(texture);
+    m_layers.push_back(layer);
+}
+
+void SpriteBatch::Draw(Texture* texture, Transform2D& transform, glm::vec2 size, glm::vec4 color, glm::vec4 uvRect, unsigned char layer)
+{
+    Draw(texture, transform.GetMatrix(), size, color, uvRect, layer);
+}
+
+void SpriteBatch::Flush()
+{
+    m_drawCalls = 0;
+    m_spriteCount = m_textures.size();
+    if (m_spriteCount == 0) return;
+
+    // Sort by layer, then by texture. The sort is stable, so sprites that match keep the order they were drawn in.
+    m_keys.resize(m_spriteCount);
+    m_order.resize(m_spriteCount);
+    for (unsigned int i = 0; i < m_spriteCount; i++)
+    {
+        m_keys[i] = ((uint32_t)m_layers[i] << 24) | (m_textures[i]->GetGLTexture() & 0xffffff);
+        m_order[i] = i;
+    }
+    RadixSort(m_keys, m_order, 4, m_jobs);
+
+    // Sprites draw over everything, and blend with whatever is under them.
+    // Whatever was set before gets put back afterwards, so nothing drawn after the sprites is affected.
+    bool depthTest = GLState::IsEnabled(GL_DEPTH_TEST);
+    bool blend = GLState::IsEnabled(GL_BLEND);
+    GLenum blendSource;
+    GLenum blendDestination;
+    GLState::GetBlendFunc(blendSource, blendDestination);
+    GLState::SetEnabled(GL_DEPTH_TEST, false);
+    GLState::SetEnabled(GL_BLEND, true);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLState::BindVertexArray(m_vao);
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+    for (unsigned int first = 0; first < m_spriteCount; first += MAX_SPRITES)
+    {
+        FlushRange(first, m_spriteCount - first < MAX_SPRITES ? m_spriteCount - first : MAX_SPRITES);
+    }
+
+    if (GLState::GetDebugUnbind())
+    {
+        GLState::BindVertexArray(0);
+        GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+        GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+    }
+    GLState::SetEnabled(GL_DEPTH_TEST, depthTest);
+    GLState::SetEnabled(GL_BLEND, blend);
+    GLState::BlendFunc(blendSource, blendDestination);
+
+    m_vertices.clear();
+    m_textures.clear();
+    m_layers.clear();
+}
+
+void SpriteBatch::FlushRange(unsigned int first, unsigned int count)
+{
+    // When the buffer is full, orphan it. The driver hands us fresh memory, and the old buffer lives on until the gpu is done with it.
+    if (m_writeOffset + count > MAX_SPRITES * BUFFER_FLUSHES)
+    {
+        glBufferData(GL_ARRAY_BUFFER, MAX_SPRITES * BUFFER_FLUSHES * 4 * sizeof(SpriteVertex), nullptr, GL_STREAM_DRAW);
+        m_writeOffset = 0;
+    }
+
+    // Write the sorted sprites into a part of the buffer nothing has used since it was orphaned,
+    // so there's no need to wait for the gpu.
+    SpriteVertex* vertices = (SpriteVertex*)glMapBufferRange(GL_ARRAY_BUFFER, m_writeOffset * 4 * sizeof(SpriteVertex), count * 4 * sizeof(SpriteVertex),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        memcpy(&vertices[i * 4], &m_vertices[m_order[first + i] * 4], 4 * sizeof(SpriteVertex));
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    // One draw call for each run of sprites with the same texture.
+    unsigned int runStart = 0;
+    for (unsigned int i = 1; i <= count; i++)
+    {
+        GLuint texture = m_textures[m_order[first + runStart]]->GetGLTexture();
+        if (i < count && m_textures[m_order[first + i]]->GetGLTexture() == texture)
+        {
+            continue;
+        }
+
+        // The index buffer always starts at vertex 0, so base vertex points it at this run.
+        GLState::BindTexture(0, GL_TEXTURE_2D, texture);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (i - runStart) * 6, GL_UNSIGNED_INT, (void*)0, (m_writeOffset + runStart) * 4);
+        m_drawCalls++;
+        runStart = i;
+    }
+
+    m_writeOffset += count;
+}
+
+void SpriteBatch::SetJobSystem(JobSystem* jobs)
+{
+    m_jobs = jobs;
+}
+
+unsigned int SpriteBatch::GetDrawCalls()
+{
+    return m_drawCalls;
+}
+
+unsigned int SpriteBatch::GetSpriteCount()
+{
+    return m_spriteCount;
+}
@@ -22,44 +22,51 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "../header/texture.h"
+#include "../header/glState.h"
 
 
-Texture::Texture(char* filePath)
+Texture::Texture(char* filePath, TextureCache::Usage usage)
 {
-    // Load the file.
-    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(filePath), filePath);
-    // Convert the file to 32 bits so we can use it.
-    FIBITMAP* bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
-
-
-    // Create an OpenGL texture.
-    glGenTextures(1, &m_texture);
-
-    // Bind our texture.
-    glBindTexture(GL_TEXTURE_2D, m_texture);
-
-    // Fill our openGL side texture object.
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, FreeImage_GetWidth(bitmap32), FreeImage_GetHeight(bitmap32),
-        0, GL_BGRA, GL_UNSIGNED_BYTE, static_cast<void*>(FreeImage_GetBits(bitmap32)));
-
+    // Create an OpenGL texture. glCreateTextures makes the texture object right away, so we can set it up
+    // by name (direct state access) without ever binding it.
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
+
+    // Fill our openGL side texture object, from the compressed copy in the texture cache if there is one.
+    // Otherwise, load the image with every mip level (compressing it if we can), and save that for next time.
+    // Far away, a pixel covers lots of texels, so reading a smaller level is both faster and less noisy.
+    std::vector<char*> sourcePaths(1, filePath);
+    std::string cachePath = TextureCache::GetPath(sourcePaths, usage);
+    if (!TextureCache::Load(cachePath, sourcePaths, m_texture, GL_TEXTURE_2D))
+    {
+        GLenum format = TextureCache::GetFormat(usage);
+        if (TextureCache::UploadImages(m_texture, GL_TEXTURE_2D, sourcePaths, format != 0 ? format : GL_RGBA8, true) && format != 0)
+        {
+            TextureCache::Save(cachePath, m_texture, GL_TEXTURE_2D);
+        }
+    }
 
     // Set texture sampling parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    ApplyFiltering(m_texture, true);
+}
+
+Texture::Texture(unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
+{
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_texture);
 
-    // Unbind the texture.
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLubyte pixel[4] = { blue, green, red, alpha };
+    glTextureStorage2D(m_texture, 1, GL_RGBA8, 1, 1);
+    glTextureSubImage2D(m_texture, 0, 0, 0, 1, 1, GL_BGRA, GL_UNSIGNED_BYTE, pixel);
 
-    // We can unload the images now that the texture data has been buffered with opengl
-    FreeImage_Unload(bitmap);
-    FreeImage_Unload(bitmap32);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    ApplyFiltering(m_texture, true);
 }
 
 Texture::~Texture()
 {
-    glDeleteTextures(1, &m_texture);
+    GLState::DeleteTextures(1, &m_texture);
 }
 
 void Texture::IncRefCount()
@@ -80,3 +87,37 @@ GLuint Texture::GetGLTexture()
 {
     return m_texture;
 }
+
+void Texture::SetGLTexture(GLuint texture)
+{
+    GLState::DeleteTextures(1, &m_texture);
+    m_texture = texture;
+}
+
+void Texture::SetMipmapping(bool mipmapped)
+{
+    ApplyFiltering(m_texture, mipmapped);
+}
+
+void Texture::ApplyFiltering(GLuint texture, bool mipmapped)
+{
+    // The most anisotropy the driver allows, found the first time. 1 means none.
+    static GLfloat maxAnisotropy = 0;
+    if (maxAnisotropy == 0)
+    {
+        maxAnisotropy = 1;
+        if (GLEW_EXT_texture_filter_anisotropic)
+        {
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+        }
+    }
+
+    // Trilinear blends between the two closest mip levels. Anisotropic takes extra samples along the direction
+    // the texture is squashed in, so surfaces seen at an angle (like the floor) stay sharp.
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (GLEW_EXT_texture_filter_anisotropic)
+    {
+        glTextureParameterf(texture, GL_TEXTURE_MAX_ANISOTROPY_EXT, mipmapped ? maxAnisotropy : 1.f);
+    }
+}
@@ -0,0 +1,134 @@
+/*
+Title: Instanced Rendering
+File Name: textureArray.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "../header/textureArray.h"
+#include "../header/texture.h"
+#include "../header/glState.h"
+
+
+TextureArray::TextureArray(unsigned int width, unsigned int height, unsigned int maxLayers)
+{
+    m_width = width;
+    m_height = height;
+    m_maxLayers = maxLayers;
+    m_layerCount = 0;
+
+    // Create an OpenGL texture, as an array.
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_texture);
+
+    // Make immutable space for every layer, and every mip level of it, up front. The layers get filled in as images are added.
+    // Each level halves the size, down to 1x1.
+    unsigned int levelCount = 1;
+    for (unsigned int size = m_width > m_height ? m_width : m_height; size > 1; size /= 2)
+    {
+        levelCount++;
+    }
+    glTextureStorage3D(m_texture, levelCount, GL_RGBA8, m_width, m_height, m_maxLayers);
+
+    // Set texture sampling parameters. These apply to every layer.
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    Texture::ApplyFiltering(m_texture, true);
+}
+
+TextureArray::~TextureArray()
+{
+    GLState::DeleteTextures(1, &m_texture);
+}
+
+void TextureArray::IncRefCount()
+{
+    m_refCount++;
+}
+
+void TextureArray::DecRefCount()
+{
+    m_refCount--;
+    if (m_refCount == 0)
+    {
+        delete this;
+    }
+}
+
+GLuint TextureArray::GetGLTexture()
+{
+    return m_texture;
+}
+
+int TextureArray::AddLayer(char* filePath)
+{
+    if (m_layerCount == m_maxLayers)
+    {
+        std::cout << "Texture array is full, can't add: " << filePath << std::endl;
+        return -1;
+    }
+
+    // Load the file, the same way Texture does.
+    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(filePath), filePath);
+    if (bitmap == nullptr)
+    {
+        std::cout << "Failed to load texture: " << filePath << std::endl;
+        return -1;
+    }
+    FIBITMAP* bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
+    FreeImage_Unload(bitmap);
+
+    // Every layer has to be the same size, so stretch the image to fit if it isn't.
+    if (FreeImage_GetWidth(bitmap32) != m_width || FreeImage_GetHeight(bitmap32) != m_height)
+    {
+        FIBITMAP* scaled = FreeImage_Rescale(bitmap32, m_width, m_height, FILTER_BILINEAR);
+        FreeImage_Unload(bitmap32);
+        bitmap32 = scaled;
+    }
+
+    // Copy the image into its layer. This is a 1 pixel deep box at a depth of the layer index.
+    glTextureSubImage3D(m_texture, 0, 0, 0, m_layerCount, m_width, m_height, 1,
+        GL_BGRA, GL_UNSIGNED_BYTE, static_cast<void*>(FreeImage_GetBits(bitmap32)));
+    // Rebuild the smaller levels. This goes over every layer, but it only happens while loading.
+    glGenerateTextureMipmap(m_texture);
+
+    FreeImage_Unload(bitmap32);
+
+    return m_layerCount++;
+}
+
+unsigned int TextureArray::GetLayerCount()
+{
+    return m_layerCount;
+}
+
+void TextureArray::SetMipmapping(bool mipmapped)
+{
+    Texture::ApplyFiltering(m_texture, mipmapped);
+}
+
+void TextureArray::SetLayer(glm::mat4& matrix, unsigned int layer)
+{
+    // glm indexes by column, so this is row 3 of column 0.
+    matrix[0][3] = (float)layer;
+}
+
+unsigned int TextureArray::GetLayer(const glm::mat4& matrix)
+{
+    return (unsigned int)matrix[0][3];
+}
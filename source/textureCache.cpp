@@ -0,0 +1,368 @@
+/*
+Title: Instanced Rendering
+File Name: textureCache.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/textureCache.h"
+#include "../header/cacheFile.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+// A .dds file is "DDS ", a fixed size header, and (since we always use the DX10 extension) a second header with the format.
+// After that comes the data: each face, and within a face each mip level, from largest to smallest.
+struct DDSHeader
+{
+    uint32_t m_magic;
+    uint32_t m_size;
+    uint32_t m_flags;
+    uint32_t m_height;
+    uint32_t m_width;
+    uint32_t m_pitchOrLinearSize;
+    uint32_t m_depth;
+    uint32_t m_mipMapCount;
+    uint32_t m_reserved1[11];
+    // Pixel format. For DX10 files only the four cc matters.
+    uint32_t m_formatSize;
+    uint32_t m_formatFlags;
+    uint32_t m_fourCC;
+    uint32_t m_formatUnused[5];
+    uint32_t m_caps;
+    uint32_t m_caps2;
+    uint32_t m_caps3;
+    uint32_t m_caps4;
+    uint32_t m_reserved2;
+    // DX10 extension.
+    uint32_t m_dxgiFormat;
+    uint32_t m_resourceDimension;
+    uint32_t m_miscFlag;
+    uint32_t m_arraySize;
+    uint32_t m_miscFlags2;
+};
+
+static const uint32_t DDS_MAGIC = 0x20534444;        // "DDS "
+static const uint32_t DDS_FOURCC_DX10 = 0x30315844;  // "DX10"
+static const uint32_t DDS_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+static const uint32_t DDS_PIXEL_FORMAT_FOURCC = 0x4;
+static const uint32_t DDS_CAPS_TEXTURE = 0x1000;
+static const uint32_t DDS_CAPS_COMPLEX = 0x8;
+static const uint32_t DDS_CAPS_MIPMAP = 0x400000;
+static const uint32_t DDS_CAPS2_CUBEMAP_ALL_FACES = 0x200 | 0xFC00;
+static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+static const uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+// The formats we write, with their DXGI numbers and how many bytes each 4x4 block takes.
+struct CompressedFormat
+{
+    GLenum m_glFormat;
+    uint32_t m_dxgiFormat;
+    unsigned int m_blockSize;
+};
+static const CompressedFormat COMPRESSED_FORMATS[] = {
+    { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 71, 8 },   // BC1
+    { GL_COMPRESSED_RG_RGTC2, 83, 16 },            // BC5
+    { GL_COMPRESSED_RGBA_BPTC_UNORM, 98, 16 },     // BC7
+};
+static const unsigned int COMPRESSED_FORMAT_COUNT = sizeof(COMPRESSED_FORMATS) / sizeof(COMPRESSED_FORMATS[0]);
+
+std::string TextureCache::s_directory = "textureCache";
+bool TextureCache::s_enabled = true;
+
+void TextureCache::SetDirectory(const std::string& directory)
+{
+    s_directory = directory;
+}
+
+void TextureCache::SetEnabled(bool enabled)
+{
+    s_enabled = enabled;
+}
+
+bool TextureCache::GetEnabled()
+{
+    return s_enabled;
+}
+
+GLenum TextureCache::GetFormat(Usage usage)
+{
+    if (!s_enabled) return 0;
+
+    if (usage == NORMAL_MAP)
+    {
+        // RGTC is part of opengl 3, so this one is always there.
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+    if (GLEW_ARB_texture_compression_bptc) return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    if (GLEW_EXT_texture_compression_s3tc) return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    return 0;
+}
+
+std::string TextureCache::GetPath(const std::vector<char*>& sourcePaths, Usage usage)
+{
+    // The key covers the source paths and the format they'd be stored in, so a different driver that picks a different
+    // format gets its own file.
+    uint64_t key = FNV_OFFSET;
+    for (unsigned int i = 0; i < sourcePaths.size(); i++)
+    {
+        key = HashString(sourcePaths[i], key);
+    }
+    GLenum format = GetFormat(usage);
+    key = HashBytes(&format, sizeof(format), key);
+    return GetCacheFilePath(s_directory, key, ".dds");
+}
+
+bool TextureCache::ReadCompressed(const std::string& path, const std::vector<char*>& sourcePaths, unsigned int faceCount,
+    GLenum& format, std::vector<ImageLevel>& levels)
+{
+    if (!s_enabled) return false;
+
+    // If any source has changed since the file was made, it's out of date.
+    // (Sources that aren't there at all are fine. Then the cache file is all there is.)
+    struct stat cacheInfo;
+    if (stat(path.c_str(), &cacheInfo) != 0) return false;
+    for (unsigned int i = 0; i < sourcePaths.size(); i++)
+    {
+        struct stat sourceInfo;
+        if (stat(sourcePaths[i], &sourceInfo) == 0 && sourceInfo.st_mtime > cacheInfo.st_mtime) return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    DDSHeader header;
+    file.read((char*)&header, sizeof(header));
+    if (!file.good() || header.m_magic != DDS_MAGIC || header.m_fourCC != DDS_FOURCC_DX10 ||
+        header.m_mipMapCount == 0 || header.m_mipMapCount > 16 ||
+        ((header.m_miscFlag & DDS_MISC_TEXTURECUBE) != 0) != (faceCount == 6))
+    {
+        return false;
+    }
+
+    const CompressedFormat* compressedFormat = nullptr;
+    for (unsigned int i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+    {
+        if (COMPRESSED_FORMATS[i].m_dxgiFormat == header.m_dxgiFormat) compressedFormat = &COMPRESSED_FORMATS[i];
+    }
+    if (compressedFormat == nullptr) return false;
+
+    levels.resize(faceCount * header.m_mipMapCount);
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        for (unsigned int level = 0; level < header.m_mipMapCount; level++)
+        {
+            ImageLevel& image = levels[face * header.m_mipMapCount + level];
+            image.m_width = header.m_width >> level > 0 ? header.m_width >> level : 1;
+            image.m_height = header.m_height >> level > 0 ? header.m_height >> level : 1;
+            image.m_data.resize(((image.m_width + 3) / 4) * ((image.m_height + 3) / 4) * compressedFormat->m_blockSize);
+            file.read(image.m_data.data(), image.m_data.size());
+        }
+    }
+    if (!file.good()) return false;
+
+    format = compressedFormat->m_glFormat;
+    return true;
+}
+
+void TextureCache::CreateStorage(GLuint texture, GLenum internalFormat, GLenum dataFormat, const std::vector<ImageLevel>& levels, unsigned int faceCount)
+{
+    // Immutable storage: every level of every face is made at once, and its size and format can never change.
+    // That saves the driver from checking the texture is complete each time it's used, or reallocating it.
+    // (Cube maps get their storage like a 2d texture, the six faces come along with it.)
+    unsigned int levelCount = levels.size() / faceCount;
+    glTextureStorage2D(texture, levelCount, internalFormat, levels[0].m_width, levels[0].m_height);
+
+    // Fill it in without binding anything. Cube map faces are layers 0-5, written like slices of a 3d texture.
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        for (unsigned int level = 0; level < levelCount; level++)
+        {
+            const ImageLevel& image = levels[face * levelCount + level];
+            if (dataFormat != 0)
+            {
+                if (faceCount == 6)
+                    glCompressedTextureSubImage3D(texture, level, 0, 0, face, image.m_width, image.m_height, 1, dataFormat, image.m_data.size(), image.m_data.data());
+                else
+                    glCompressedTextureSubImage2D(texture, level, 0, 0, image.m_width, image.m_height, dataFormat, image.m_data.size(), image.m_data.data());
+            }
+            else
+            {
+                // If internalFormat is compressed, the driver compresses the image on its way in.
+                if (faceCount == 6)
+                    glTextureSubImage3D(texture, level, 0, 0, face, image.m_width, image.m_height, 1, GL_BGRA, GL_UNSIGNED_BYTE, image.m_data.data());
+                else
+                    glTextureSubImage2D(texture, level, 0, 0, image.m_width, image.m_height, GL_BGRA, GL_UNSIGNED_BYTE, image.m_data.data());
+            }
+        }
+    }
+}
+
+bool TextureCache::Load(const std::string& path, const std::vector<char*>& sourcePaths, GLuint texture, GLenum target)
+{
+    // Read everything before uploading anything, so a cut off file doesn't leave the texture half filled.
+    unsigned int faceCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    GLenum format;
+    std::vector<ImageLevel> levels;
+    if (!ReadCompressed(path, sourcePaths, faceCount, format, levels)) return false;
+
+    CreateStorage(texture, format, format, levels, faceCount);
+    return true;
+}
+
+void TextureCache::Save(const std::string& path, GLuint texture, GLenum target)
+{
+    if (!s_enabled) return;
+
+    unsigned int faceCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+
+    // Make sure the driver really did compress it, and find out what to.
+    GLint compressed = 0;
+    GLint internalFormat = 0;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_COMPRESSED, &compressed);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    const CompressedFormat* format = nullptr;
+    for (unsigned int i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+    {
+        if (COMPRESSED_FORMATS[i].m_glFormat == (GLenum)internalFormat) format = &COMPRESSED_FORMATS[i];
+    }
+    if (!compressed || format == nullptr) return;
+
+    // Immutable textures know how many levels they have.
+    GLint width = 0;
+    GLint height = 0;
+    GLint levelCount = 0;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levelCount);
+    if (levelCount <= 0 || levelCount > 16) return;
+
+    // Read every level back. For a cube map, that's all six faces of the level together, one after another.
+    // The file wants them face by face, so they're split up as they're copied out.
+    std::vector<ImageLevel> levels(faceCount * levelCount);
+    std::vector<char> levelData;
+    for (int level = 0; level < levelCount; level++)
+    {
+        unsigned int levelWidth = width >> level > 0 ? width >> level : 1;
+        unsigned int levelHeight = height >> level > 0 ? height >> level : 1;
+        unsigned int faceSize = ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * format->m_blockSize;
+        levelData.resize(faceSize * faceCount);
+        glGetCompressedTextureImage(texture, level, levelData.size(), levelData.data());
+
+        for (unsigned int face = 0; face < faceCount; face++)
+        {
+            ImageLevel& image = levels[face * levelCount + level];
+            image.m_width = levelWidth;
+            image.m_height = levelHeight;
+            image.m_data.assign(levelData.begin() + face * faceSize, levelData.begin() + (face + 1) * faceSize);
+        }
+    }
+
+    DDSHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_magic = DDS_MAGIC;
+    header.m_size = 124;
+    header.m_flags = DDS_FLAGS;
+    header.m_width = width;
+    header.m_height = height;
+    header.m_pitchOrLinearSize = levels[0].m_data.size();
+    header.m_depth = 1;
+    header.m_mipMapCount = levelCount;
+    header.m_formatSize = 32;
+    header.m_formatFlags = DDS_PIXEL_FORMAT_FOURCC;
+    header.m_fourCC = DDS_FOURCC_DX10;
+    header.m_caps = DDS_CAPS_TEXTURE | (levelCount > 1 ? DDS_CAPS_MIPMAP | DDS_CAPS_COMPLEX : 0) | (faceCount == 6 ? DDS_CAPS_COMPLEX : 0);
+    header.m_caps2 = faceCount == 6 ? DDS_CAPS2_CUBEMAP_ALL_FACES : 0;
+    header.m_dxgiFormat = format->m_dxgiFormat;
+    header.m_resourceDimension = DDS_DIMENSION_TEXTURE2D;
+    header.m_miscFlag = faceCount == 6 ? DDS_MISC_TEXTURECUBE : 0;
+    header.m_arraySize = 1;
+
+    MakeCacheDirectory(s_directory);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.good())
+    {
+        std::cout << "Can't write texture cache file: " << path << std::endl;
+        return;
+    }
+    file.write((const char*)&header, sizeof(header));
+    for (unsigned int i = 0; i < levels.size(); i++)
+    {
+        file.write(levels[i].m_data.data(), levels[i].m_data.size());
+    }
+}
+
+bool TextureCache::DecodeImage(char* filePath, bool mipmapped, std::vector<ImageLevel>& levels)
+{
+    // Load the file, and convert it to 32 bits so we can use it.
+    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(filePath), filePath);
+    if (bitmap == nullptr)
+    {
+        std::cout << "Failed to load texture: " << filePath << std::endl;
+        return false;
+    }
+    FIBITMAP* level = FreeImage_ConvertTo32Bits(bitmap);
+    FreeImage_Unload(bitmap);
+
+    // Copy each level out, then shrink it by half for the next one, down to 1x1.
+    // (glGenerateMipmap can't be counted on for compressed formats, so the levels are made here instead)
+    levels.clear();
+    while (true)
+    {
+        ImageLevel image;
+        image.m_width = FreeImage_GetWidth(level);
+        image.m_height = FreeImage_GetHeight(level);
+        // 32 bit rows never need padding, so the pixels are one solid block.
+        const char* bits = (const char*)FreeImage_GetBits(level);
+        image.m_data.assign(bits, bits + image.m_width * image.m_height * 4);
+        levels.push_back(image);
+
+        if (!mipmapped || (image.m_width == 1 && image.m_height == 1)) break;
+        FIBITMAP* smaller = FreeImage_Rescale(level, image.m_width > 1 ? image.m_width / 2 : 1, image.m_height > 1 ? image.m_height / 2 : 1, FILTER_BOX);
+        FreeImage_Unload(level);
+        level = smaller;
+    }
+    FreeImage_Unload(level);
+    return true;
+}
+
+bool TextureCache::UploadImages(GLuint texture, GLenum target, const std::vector<char*>& filePaths, GLenum internalFormat, bool mipmapped)
+{
+    // Decode every face first, since the storage for all of them is made together.
+    unsigned int faceCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    if (filePaths.size() != faceCount) return false;
+
+    std::vector<ImageLevel> levels;
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        std::vector<ImageLevel> faceLevels;
+        if (!DecodeImage(filePaths[face], mipmapped, faceLevels)) return false;
+        if (face > 0 && (faceLevels[0].m_width != levels[0].m_width || faceLevels[0].m_height != levels[0].m_height))
+        {
+            std::cout << "Cube map faces have to be the same size: " << filePaths[face] << std::endl;
+            return false;
+        }
+        levels.insert(levels.end(), faceLevels.begin(), faceLevels.end());
+    }
+
+    CreateStorage(texture, internalFormat, 0, levels, faceCount);
+    return true;
+}
@@ -0,0 +1,384 @@
+/*
+Title: Instanced Rendering
+File Name: textureStreamer.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/textureStreamer.h"
+#include "../header/glState.h"
+#include <cstring>
+
+TextureStreamer::TextureStreamer(GLsizeiptr ringSize, GLsizeiptr bytesPerUpdate, unsigned int loaderCount)
+{
+    m_stopping = false;
+    m_size = ringSize;
+    m_head = 0;
+    m_used = 0;
+    m_frameBytes = 0;
+    m_bytesPerUpdate = bytesPerUpdate;
+    m_bytesUploaded = 0;
+
+    // Same as the frame uniforms: immutable storage, mapped once, and coherent so writes don't need flushing.
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    // It's only bound while uploading from it, since leaving it bound would make every other texture upload read from it.
+    glCreateBuffers(1, &m_buffer);
+    glNamedBufferStorage(m_buffer, m_size, nullptr, flags);
+    m_mappedData = (char*)glMapNamedBufferRange(m_buffer, 0, m_size, flags);
+
+    for (unsigned int i = 0; i < loaderCount; i++)
+    {
+        m_loaders.push_back(std::thread(&TextureStreamer::LoaderLoop, this));
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_stopping = true;
+    }
+    m_loadReady.notify_all();
+    for (unsigned int i = 0; i < m_loaders.size(); i++)
+    {
+        m_loaders[i].join();
+    }
+
+    // Anything unfinished stays as far along as it got.
+    for (unsigned int i = 0; i < m_requests.size(); i++)
+    {
+        if (m_requests[i]->m_ownerTexture != nullptr) m_requests[i]->m_ownerTexture->DecRefCount();
+        if (m_requests[i]->m_ownerCubeMap != nullptr) m_requests[i]->m_ownerCubeMap->DecRefCount();
+        delete m_requests[i];
+    }
+
+    for (unsigned int i = 0; i < m_fences.size(); i++)
+    {
+        glDeleteSync(m_fences[i].m_sync);
+    }
+
+    glUnmapNamedBuffer(m_buffer);
+    GLState::DeleteBuffers(1, &m_buffer);
+}
+
+TextureStreamer::Request* TextureStreamer::CreateRequest(GLenum target, GLuint texture, const std::vector<char*>& sourcePaths, TextureCache::Usage usage, unsigned int faceCount)
+{
+    Request* request = new Request();
+    request->m_target = target;
+    request->m_texture = texture;
+    request->m_ownerTexture = nullptr;
+    request->m_ownerCubeMap = nullptr;
+    request->m_sourcePaths = sourcePaths;
+    request->m_usage = usage;
+    // Work out the cache file here, since it asks opengl which formats there are.
+    request->m_cachePath = TextureCache::GetPath(sourcePaths, usage);
+    request->m_faceCount = faceCount;
+    request->m_levelCount = 0;
+    request->m_format = 0;
+    request->m_internalFormat = GL_RGBA8;
+    request->m_failed = false;
+    request->m_loaded = false;
+    request->m_nextLevel = -1;
+    request->m_allocated = false;
+    m_requests.push_back(request);
+
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_loadQueue.push_back(request);
+    }
+    m_loadReady.notify_one();
+    return request;
+}
+
+Texture* TextureStreamer::LoadTexture(char* filePath, TextureCache::Usage usage)
+{
+    // Flat normals, or plain grey, until the real thing shows up.
+    Texture* texture = usage == TextureCache::NORMAL_MAP ? new Texture(128, 128, 255, 255) : new Texture(128, 128, 128, 255);
+    texture->IncRefCount();
+
+    std::vector<char*> sourcePaths(1, filePath);
+    Request* request = CreateRequest(GL_TEXTURE_2D, texture->GetGLTexture(), sourcePaths, usage, 1);
+    request->m_ownerTexture = texture;
+    return texture;
+}
+
+CubeMap* TextureStreamer::LoadCubeMap(std::vector<char*> filePaths)
+{
+    CubeMap* cubeMap = new CubeMap(128, 128, 128);
+    cubeMap->IncRefCount();
+
+    if (filePaths.size() != 6)
+    {
+        std::cout << "A cube map needs 6 faces, not " << filePaths.size() << std::endl;
+        return cubeMap;
+    }
+
+    Request* request = CreateRequest(GL_TEXTURE_CUBE_MAP, cubeMap->GetGLCubeMap(), filePaths, TextureCache::COLOR, 6);
+    request->m_ownerCubeMap = cubeMap;
+    return cubeMap;
+}
+
+void TextureStreamer::LoaderLoop()
+{
+    while (true)
+    {
+        Request* request;
+        {
+            std::unique_lock<std::mutex> lock(m_loadMutex);
+            m_loadReady.wait(lock, [this]() { return m_stopping || !m_loadQueue.empty(); });
+            if (m_stopping) return;
+            request = m_loadQueue.front();
+            m_loadQueue.pop_front();
+        }
+
+        Load(request);
+        // Everything written above has to be visible before the opengl thread sees this.
+        request->m_loaded.store(true, std::memory_order_release);
+    }
+}
+
+void TextureStreamer::Load(Request* request)
+{
+    // The compressed copy is ready to go as it is.
+    if (TextureCache::ReadCompressed(request->m_cachePath, request->m_sourcePaths, request->m_faceCount, request->m_format, request->m_levels))
+    {
+        request->m_internalFormat = request->m_format;
+        request->m_levelCount = request->m_levels.size() / request->m_faceCount;
+        return;
+    }
+
+    // Otherwise decode every face. Plain textures get a mip chain, cube maps only need the one level.
+    request->m_format = 0;
+    request->m_levels.clear();
+    for (unsigned int face = 0; face < request->m_faceCount; face++)
+    {
+        std::vector<ImageLevel> faceLevels;
+        if (!TextureCache::DecodeImage(request->m_sourcePaths[face], request->m_faceCount == 1, faceLevels) ||
+            (face > 0 && (faceLevels.size() != request->m_levelCount || faceLevels[0].m_width != request->m_levels[0].m_width || faceLevels[0].m_height != request->m_levels[0].m_height)))
+        {
+            request->m_failed = true;
+            return;
+        }
+        request->m_levelCount = faceLevels.size();
+        request->m_levels.insert(request->m_levels.end(), faceLevels.begin(), faceLevels.end());
+    }
+
+    // If there's a compressed format to store it in, the driver compresses it as it's uploaded,
+    // and it gets saved to the cache once it's all there.
+    GLenum format = TextureCache::GetFormat(request->m_usage);
+    request->m_internalFormat = format != 0 ? format : GL_RGBA8;
+}
+
+void TextureStreamer::Reclaim()
+{
+    // Fences finish in order, so stop at the first one that hasn't.
+    while (!m_fences.empty())
+    {
+        GLenum result = glClientWaitSync(m_fences.front().m_sync, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) break;
+
+        glDeleteSync(m_fences.front().m_sync);
+        m_used -= m_fences.front().m_bytes;
+        m_fences.pop_front();
+    }
+}
+
+GLsizeiptr TextureStreamer::Allocate(GLsizeiptr bytes)
+{
+    // Keep every upload 16 byte aligned, which is plenty for any pixel format.
+    bytes = (bytes + 15) & ~(GLsizeiptr)15;
+
+    // With nothing in flight, start again from the front.
+    if (m_used == 0) m_head = 0;
+
+    // Uploads can't wrap around the end of the ring, so if it doesn't fit before the end, skip to the start.
+    // The skipped bit counts as used until this frame's fence passes.
+    GLsizeiptr skipped = m_head + bytes > m_size ? m_size - m_head : 0;
+    if (m_used + skipped + bytes > m_size) return -1;
+    if (skipped > 0) m_head = 0;
+
+    GLsizeiptr offset = m_head;
+    m_head = (m_head + bytes) % m_size;
+    m_used += skipped + bytes;
+    m_frameBytes += skipped + bytes;
+    return offset;
+}
+
+bool TextureStreamer::UploadLevel(Request* request)
+{
+    unsigned int level = request->m_nextLevel;
+    GLsizeiptr levelBytes = 0;
+    for (unsigned int face = 0; face < request->m_faceCount; face++)
+    {
+        levelBytes += request->m_levels[face * request->m_levelCount + level].m_data.size();
+    }
+
+    // Every face of a level goes up together, so a cube map never shows a mix of old and new faces.
+    // A level too big for the ring is sent straight from memory, which opengl has to copy before the call returns.
+    GLsizeiptr offset = -1;
+    if (levelBytes <= m_size)
+    {
+        offset = Allocate(levelBytes);
+        if (offset == -1) return false;
+
+        GLsizeiptr faceOffset = offset;
+        for (unsigned int face = 0; face < request->m_faceCount; face++)
+        {
+            ImageLevel& image = request->m_levels[face * request->m_levelCount + level];
+            memcpy(m_mappedData + faceOffset, image.m_data.data(), image.m_data.size());
+            faceOffset += image.m_data.size();
+        }
+    }
+
+    // The first time, the size is known at last. Immutable storage can't be resized, so make a new texture with storage
+    // for every level, and swap it in for the placeholder. Until the first level lands it samples nothing,
+    // but that's in the same update, before anything draws with it.
+    if (!request->m_allocated)
+    {
+        GLuint texture;
+        glCreateTextures(request->m_target, 1, &texture);
+        glTextureStorage2D(texture, request->m_levelCount, request->m_internalFormat, request->m_levels[0].m_width, request->m_levels[0].m_height);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (request->m_ownerCubeMap != nullptr)
+        {
+            // Same sampling as a cube map loaded the usual way.
+            glTextureParameteri(texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            request->m_ownerCubeMap->SetGLCubeMap(texture);
+        }
+        else
+        {
+            Texture::ApplyFiltering(texture, true);
+            request->m_ownerTexture->SetGLTexture(texture);
+        }
+        request->m_texture = texture;
+        request->m_allocated = true;
+    }
+
+    // With a pixel buffer bound, the data pointer is an offset into it. Cube map faces are layers of the texture.
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, offset != -1 ? m_buffer : 0);
+    GLsizeiptr faceOffset = offset;
+    for (unsigned int face = 0; face < request->m_faceCount; face++)
+    {
+        ImageLevel& image = request->m_levels[face * request->m_levelCount + level];
+        const void* data = offset != -1 ? (const void*)faceOffset : image.m_data.data();
+        if (request->m_format != 0)
+        {
+            if (request->m_faceCount == 6)
+                glCompressedTextureSubImage3D(request->m_texture, level, 0, 0, face, image.m_width, image.m_height, 1, request->m_format, image.m_data.size(), data);
+            else
+                glCompressedTextureSubImage2D(request->m_texture, level, 0, 0, image.m_width, image.m_height, request->m_format, image.m_data.size(), data);
+        }
+        else
+        {
+            if (request->m_faceCount == 6)
+                glTextureSubImage3D(request->m_texture, level, 0, 0, face, image.m_width, image.m_height, 1, GL_BGRA, GL_UNSIGNED_BYTE, data);
+            else
+                glTextureSubImage2D(request->m_texture, level, 0, 0, image.m_width, image.m_height, GL_BGRA, GL_UNSIGNED_BYTE, data);
+        }
+        faceOffset += image.m_data.size();
+    }
+
+    // Sample from this level down. Commands run in order, so nothing draws with it before it's filled.
+    glTextureParameteri(request->m_texture, GL_TEXTURE_BASE_LEVEL, level);
+
+    m_bytesUploaded += levelBytes;
+    request->m_nextLevel--;
+    return true;
+}
+
+void TextureStreamer::Finish(Request* request)
+{
+    // Decoded images were compressed by the driver on the way up, so keep that for next time.
+    if (!request->m_failed && request->m_format == 0 && request->m_internalFormat != GL_RGBA8)
+    {
+        TextureCache::Save(request->m_cachePath, request->m_texture, request->m_target);
+    }
+
+    if (request->m_ownerTexture != nullptr) request->m_ownerTexture->DecRefCount();
+    if (request->m_ownerCubeMap != nullptr) request->m_ownerCubeMap->DecRefCount();
+    delete request;
+}
+
+void TextureStreamer::Update()
+{
+    Reclaim();
+
+    GLsizeiptr budget = m_bytesPerUpdate;
+    GLsizeiptr uploadedBefore = m_bytesUploaded;
+    bool ringFull = false;
+    for (unsigned int i = 0; i < m_requests.size() && !ringFull && m_bytesUploaded - uploadedBefore < budget; )
+    {
+        Request* request = m_requests[i];
+        if (!request->m_loaded.load(std::memory_order_acquire))
+        {
+            i++;
+            continue;
+        }
+
+        if (!request->m_failed && !request->m_allocated && request->m_nextLevel == -1)
+        {
+            request->m_nextLevel = request->m_levelCount - 1;
+        }
+
+        // Smallest level first, as many as fit in this frame.
+        while (!request->m_failed && request->m_nextLevel >= 0 && m_bytesUploaded - uploadedBefore < budget)
+        {
+            if (!UploadLevel(request))
+            {
+                ringFull = true;
+                break;
+            }
+        }
+
+        if (request->m_failed || request->m_nextLevel < 0)
+        {
+            Finish(request);
+            m_requests.erase(m_requests.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // Unbind, so other uploads read from their pointers again, and fence this frame's part of the ring.
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (m_frameBytes > 0)
+    {
+        Fence fence;
+        fence.m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fence.m_bytes = m_frameBytes;
+        m_fences.push_back(fence);
+        m_frameBytes = 0;
+    }
+}
+
+unsigned int TextureStreamer::GetPendingCount()
+{
+    return m_requests.size();
+}
+
+GLsizeiptr TextureStreamer::GetBytesUploaded()
+{
+    return m_bytesUploaded;
+}
@@ -30,6 +30,7 @@ Transform2D::Transform2D()
 	m_rotation = 0;
 	m_position = glm::vec2();
 	m_matrix = glm::mat3();
+	m_matrixDirty = true;
 }
 
 float Transform2D::Scale()
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "../header/transform3d.h"
+#include "../header/instanceBuffer.h"
 
 Transform3D::Transform3D()
 {
@@ -30,6 +31,162 @@ Transform3D::Transform3D()
     m_rotation = glm::vec3();
     m_position = glm::vec3();
     m_matrix = m_inverseMatrix = glm::mat4();
+    m_matrixDirty = m_inverseDirty = true;
+    m_halfSin = glm::vec3(0, 0, 0);
+    m_halfCos = glm::vec3(1, 1, 1);
+    m_axisDirty = 0;
+    m_rotationDirty = true;
+    m_instanceBuffer = nullptr;
+    m_instanceSlot = 0;
+}
+
+Transform3D::Transform3D(const Transform3D& other)
+{
+    CopyValues(other);
+    m_instanceBuffer = nullptr;
+    m_instanceSlot = 0;
+}
+
+Transform3D& Transform3D::operator=(const Transform3D& other)
+{
+    if (this != &other)
+    {
+        CopyValues(other);
+        SetDirty();
+    }
+    return *this;
+}
+
+Transform3D::Transform3D(Transform3D&& other) noexcept
+{
+    CopyValues(other);
+    m_instanceBuffer = other.m_instanceBuffer;
+    m_instanceSlot = other.m_instanceSlot;
+
+    // Point the slot at its new owner.
+    if (m_instanceBuffer != nullptr)
+    {
+        m_instanceBuffer->MoveInstance(m_instanceSlot, this);
+        other.m_instanceBuffer = nullptr;
+    }
+}
+
+Transform3D& Transform3D::operator=(Transform3D&& other) noexcept
+{
+    if (this != &other)
+    {
+        // Our own slot isn't needed any more, since we're taking over the other one.
+        if (m_instanceBuffer != nullptr)
+        {
+            m_instanceBuffer->RemoveInstance(m_instanceSlot);
+        }
+
+        CopyValues(other);
+        m_instanceBuffer = other.m_instanceBuffer;
+        m_instanceSlot = other.m_instanceSlot;
+        if (m_instanceBuffer != nullptr)
+        {
+            m_instanceBuffer->MoveInstance(m_instanceSlot, this);
+            other.m_instanceBuffer = nullptr;
+        }
+    }
+    return *this;
+}
+
+Transform3D::~Transform3D()
+{
+    // Give the slot back, so the buffer doesn't keep pointing at us.
+    if (m_instanceBuffer != nullptr)
+    {
+        m_instanceBuffer->RemoveInstance(m_instanceSlot);
+    }
+}
+
+void Transform3D::CopyValues(const Transform3D& other)
+{
+    m_scale = other.m_scale;
+    m_rotation = other.m_rotation;
+    m_position = other.m_position;
+    m_matrixDirty = other.m_matrixDirty;
+    m_inverseDirty = other.m_inverseDirty;
+    m_halfSin = other.m_halfSin;
+    m_halfCos = other.m_halfCos;
+    m_axisDirty = other.m_axisDirty;
+    m_rotationDirty = other.m_rotationDirty;
+    m_orientation = other.m_orientation;
+    m_rotationMatrix = other.m_rotationMatrix;
+    m_matrix = other.m_matrix;
+    m_inverseMatrix = other.m_inverseMatrix;
+}
+
+void Transform3D::SetDirty()
+{
+    m_matrixDirty = m_inverseDirty = true;
+
+    if (m_instanceBuffer != nullptr)
+    {
+        m_instanceBuffer->MarkDirty(m_instanceSlot);
+    }
+}
+
+void Transform3D::SetRotationDirty(unsigned char axes)
+{
+    m_axisDirty |= axes;
+    m_rotationDirty = true;
+    SetDirty();
+}
+
+void Transform3D::UpdateRotation()
+{
+    if (!m_rotationDirty)
+    {
+        return;
+    }
+
+    // One sine and cosine for each axis that changed.
+    for (int i = 0; i < 3; i++)
+    {
+        if (m_axisDirty & (1 << i))
+        {
+            m_halfSin[i] = sin(m_rotation[i] * .5f);
+            m_halfCos[i] = cos(m_rotation[i] * .5f);
+        }
+    }
+    m_axisDirty = 0;
+
+    // Compose the quaternion for roll, then pitch, then yaw: qy * qx * qz.
+    // Yaw turns the opposite way to a standard y rotation, so its sine is negated.
+    // qy * qx, multiplied out with the zeros left out:
+    float w = m_halfCos.y * m_halfCos.x;
+    float x = m_halfCos.y * m_halfSin.x;
+    float y = -m_halfSin.y * m_halfCos.x;
+    float z = m_halfSin.y * m_halfSin.x;
+    // and then * qz:
+    m_orientation = glm::quat(
+        w * m_halfCos.z - z * m_halfSin.z,
+        x * m_halfCos.z + y * m_halfSin.z,
+        y * m_halfCos.z - x * m_halfSin.z,
+        z * m_halfCos.z + w * m_halfSin.z
+        );
+
+    // Turn the quaternion into a rotation matrix.
+    w = m_orientation.w;
+    x = m_orientation.x;
+    y = m_orientation.y;
+    z = m_orientation.z;
+    m_rotationMatrix = glm::mat3(
+        1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y),
+        2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x),
+        2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y)
+        );
+
+    m_rotationDirty = false;
+}
+
+void Transform3D::SetInstanceSlot(InstanceBuffer* instanceBuffer, unsigned int slot)
+{
+    m_instanceBuffer = instanceBuffer;
+    m_instanceSlot = slot;
 }
 
 float Transform3D::Scale()
@@ -50,98 +207,69 @@ glm::vec3 Transform3D::Position()
 void Transform3D::SetScale(float s)
 {
     m_scale = s;
-    m_matrixDirty = m_inverseDirty = true;
+    SetDirty();
 }
 
 void Transform3D::SetRotation(glm::vec3 r)
 {
+    // Only flag the axes that actually changed.
+    unsigned char axes = (r.x != m_rotation.x ? 1 : 0) | (r.y != m_rotation.y ? 2 : 0) | (r.z != m_rotation.z ? 4 : 0);
     m_rotation = r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotationDirty(axes);
 }
 
 void Transform3D::SetPosition(glm::vec3 v)
 {
     m_position = v;
-    m_matrixDirty = m_inverseDirty = true;
+    SetDirty();
 }
 
 void Transform3D::RotateX(float r)
 {
     m_rotation.x += r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotationDirty(1);
 }
 
 void Transform3D::RotateY(float r)
 {
     m_rotation.y += r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotationDirty(2);
 }
 
 void Transform3D::RotateZ(float r)
 {
     m_rotation.z += r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotationDirty(4);
 }
 
 
 void Transform3D::Translate(glm::vec3 v)
 {
     m_position += v;
-    m_matrixDirty = m_inverseDirty = true;
+    SetDirty();
+}
+
+glm::quat Transform3D::GetOrientation()
+{
+    UpdateRotation();
+    return m_orientation;
 }
 
 glm::mat4 Transform3D::GetMatrix()
 {
     // If anything has changed, recalculate the matrix
     if (m_matrixDirty) {
-        // scale
-        glm::mat4 s = glm::mat4(
-            m_scale, 0, 0, 0,
-            0, m_scale, 0, 0,
-            0, 0, m_scale, 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the x axis
-        glm::mat4 rx = glm::mat4(
-            1, 0, 0, 0,
-            0, cos(m_rotation.x), sin(m_rotation.x), 0,
-            0, -sin(m_rotation.x), cos(m_rotation.x), 0,
-            0, 0, 0, 1
-            );
-        
-        // rotation on the y axis
-        glm::mat4 ry = glm::mat4(
-            cos(m_rotation.y), 0, sin(m_rotation.y), 0,
-            0, 1, 0, 0,
-            -sin(m_rotation.y), 0, cos(m_rotation.y), 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the z axis
-        glm::mat4 rz = glm::mat4(
-            cos(m_rotation.z), sin(m_rotation.z), 0, 0,
-            -sin(m_rotation.z), cos(m_rotation.z), 0, 0,
-            0, 0, 1, 0,
-            0, 0, 0, 1
+        UpdateRotation();
+
+        // The world matrix is translation * rotation * scale.
+        // That's just the rotation's columns times the scale, with the position in the last column.
+        m_matrix = glm::mat4(
+            glm::vec4(m_rotationMatrix[0] * m_scale, 0),
+            glm::vec4(m_rotationMatrix[1] * m_scale, 0),
+            glm::vec4(m_rotationMatrix[2] * m_scale, 0),
+            glm::vec4(m_position, 1)
             );
 
-        // translation
-        glm::mat4 t = glm::mat4(
-            1, 0, 0, 0,
-            0, 1, 0, 0,
-            0, 0, 1, 0,
-            m_position.x, m_position.y, m_position.z, 1
-            );
-
-        // compose rotation matrix
-        // roll, then yaw, then pitch
-        // (multiply in reverse order)
-        m_rotationMatrix = ry * rx * rz;
-
-        // calculate world matrix
-        m_matrix = t * m_rotationMatrix * s;
-
         m_matrixDirty = false;
     }
 
@@ -153,97 +281,46 @@ glm::mat4 Transform3D::GetInverseMatrix()
 {
     // If anything has changed, recalculate the matrix
     if (m_inverseDirty) {
-
-        // inverse scale just divides by scale
-        glm::mat4 s = glm::mat4(
-            1.f/m_scale, 0, 0, 0,
-            0, 1.f/m_scale, 0, 0,
-            0, 0, 1.f/m_scale, 0,
-            0, 0, 0, 1
+        UpdateRotation();
+
+        // The inverse of a rotation is its transpose, so the inverse is
+        // (1 / scale) * transposed rotation * negative translation.
+        // The rotation's columns become rows, and the translation is moved back through them.
+        float inverseScale = 1.f / m_scale;
+        glm::vec3 x = m_rotationMatrix[0] * inverseScale;
+        glm::vec3 y = m_rotationMatrix[1] * inverseScale;
+        glm::vec3 z = m_rotationMatrix[2] * inverseScale;
+
+        m_inverseMatrix = glm::mat4(
+            x.x, y.x, z.x, 0,
+            x.y, y.y, z.y, 0,
+            x.z, y.z, z.z, 0,
+            -glm::dot(x, m_position), -glm::dot(y, m_position), -glm::dot(z, m_position), 1
             );
 
-        // rotation on the x axis
-        glm::mat4 rx = glm::mat4(
-            1, 0, 0, 0,
-            0, cos(m_rotation.x), -sin(m_rotation.x), 0,
-            0, sin(m_rotation.x), cos(m_rotation.x), 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the y axis
-        glm::mat4 ry = glm::mat4(
-            cos(m_rotation.y), 0, -sin(m_rotation.y), 0,
-            0, 1, 0, 0,
-            sin(m_rotation.y), 0, cos(m_rotation.y), 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the z axis
-        glm::mat4 rz = glm::mat4(
-            cos(m_rotation.z), -sin(m_rotation.z), 0, 0,
-            sin(m_rotation.z), cos(m_rotation.z), 0, 0,
-            0, 0, 1, 0,
-            0, 0, 0, 1
-            );
-
-        // translation
-        glm::mat4 t = glm::mat4(
-            1, 0, 0, 0,
-            0, 1, 0, 0,
-            0, 0, 1, 0,
-            -m_position.x, -m_position.y, -m_position.z, 1
-            );
-
-        // compose rotation matrix
-        // pitch, then yaw, then roll
-        // (multiply in reverse order)
-        glm::mat4 r = rz * rx * ry;
-
-        // calculate world matrix inverse
-        m_inverseMatrix = s * r * t;
-
         m_inverseDirty = false;
     }
 
-    //return the world matrix
+    //return the world matrix inverse
     return m_inverseMatrix;
 }
 
 glm::vec3 Transform3D::GetUp()
 {
-    // Force the transform to recalculate rotation if it's dirty
-    if (m_matrixDirty)
-    {
-        GetMatrix();
-    }
-    // Multiplying an up vector by rotation will give this transforms up vector
-    glm::vec4 up = m_rotationMatrix * glm::vec4(0, 1, 0, 1);
-
-    return glm::vec3(up);
+    // The rotation's columns are already this transform's axes.
+    UpdateRotation();
+    return m_rotationMatrix[1];
 }
 
 glm::vec3 Transform3D::GetForward()
 {
-    // Force the transform to recalculate rotation if it's dirty
-    if (m_matrixDirty)
-    {
-        GetMatrix();
-    }
-
-    glm::vec4 forward = m_rotationMatrix * glm::vec4(0, 0, -1, 1);
-
-    return glm::vec3(forward);
+    // Forward is down the negative z axis.
+    UpdateRotation();
+    return -m_rotationMatrix[2];
 }
 
 glm::vec3 Transform3D::GetRight()
 {
-    // Force the transform to recalculate rotation if it's dirty
-    if (m_matrixDirty)
-    {
-        GetMatrix();
-    }
-
-    glm::vec4 right = m_rotationMatrix * glm::vec4(1, 0, 0, 1);
-
-    return glm::vec3(right);
+    UpdateRotation();
+    return m_rotationMatrix[0];
 }
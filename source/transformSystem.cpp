@@ -0,0 +1,331 @@
+/*
+Title: Instanced Rendering
+File Name: transformSystem.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../header/transformSystem.h"
+#include <cmath>
+
+// Use sse whenever the compiler is allowed to. Every 64 bit x86 cpu has sse2.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SYSTEM_SSE
+#include <emmintrin.h>
+#endif
+
+// Builds a world matrix from precomputed sines and cosines.
+// This is the product t * ry * rx * rz * s from Transform3D::GetMatrix, multiplied out by hand,
+// which skips all the multiplications by zero and one in the separate matrices.
+static void ComposeMatrix(glm::mat4& m, float sx, float cx, float sy, float cy, float sz, float cz, float s, float px, float py, float pz)
+{
+    m[0] = glm::vec4(s * (cy * cz - sy * sx * sz), s * (cx * sz), s * (sy * cz + cy * sx * sz), 0);
+    m[1] = glm::vec4(s * (-cy * sz - sy * sx * cz), s * (cx * cz), s * (-sy * sz + cy * sx * cz), 0);
+    m[2] = glm::vec4(s * (-sy * cx), s * -sx, s * (cy * cx), 0);
+    m[3] = glm::vec4(px, py, pz, 1);
+}
+
+#ifdef TRANSFORM_SYSTEM_SSE
+
+// Calculates the sine and cosine of four angles at once.
+// The angle is reduced to [-pi/4, pi/4] plus a quarter turn count, and polynomials are used from there.
+// (The same approach and constants as the cephes math library's sinf and cosf.)
+static void SinCos4(__m128 x, __m128& sinOut, __m128& cosOut)
+{
+    // Find the nearest multiple of pi/2, and how far we are from it.
+    // pi/2 is split into three parts so that subtracting it loses as little precision as possible.
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236f)));
+    __m128 j = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(1.5703125f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(4.837512969970703125e-4f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(7.54978995489188216e-8f)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    // sin(r) = r + r^3 * (s1 + r^2 * (s2 + r^2 * s3))
+    __m128 s = _mm_add_ps(_mm_set1_ps(8.3321608736e-3f), _mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)));
+    s = _mm_add_ps(_mm_set1_ps(-1.6666654611e-1f), _mm_mul_ps(r2, s));
+    s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r2, r), s));
+
+    // cos(r) = 1 - r^2 / 2 + r^4 * (c1 + r^2 * (c2 + r^2 * c3))
+    __m128 c = _mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f), _mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)));
+    c = _mm_add_ps(_mm_set1_ps(4.166664568298827e-2f), _mm_mul_ps(r2, c));
+    c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_mul_ps(_mm_mul_ps(r2, r2), c));
+
+    // Odd quarter turns swap sine and cosine.
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinResult = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+    __m128 cosResult = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+    // Then the quarter turn decides the signs: sine is negative in quadrants 2 and 3, cosine in 1 and 2.
+    __m128i sinSign = _mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30);
+    __m128i cosSign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30);
+    sinOut = _mm_xor_ps(sinResult, _mm_castsi128_ps(sinSign));
+    cosOut = _mm_xor_ps(cosResult, _mm_castsi128_ps(cosSign));
+}
+
+#endif
+
+TransformSystem::TransformSystem()
+{
+}
+
+unsigned int TransformSystem::Add(glm::vec3 position, glm::vec3 rotation, float scale)
+{
+    m_positionX.push_back(position.x);
+    m_positionY.push_back(position.y);
+    m_positionZ.push_back(position.z);
+    m_rotationX.push_back(rotation.x);
+    m_rotationY.push_back(rotation.y);
+    m_rotationZ.push_back(rotation.z);
+    m_scale.push_back(scale);
+    m_dirty.push_back(1);
+    return m_scale.size() - 1;
+}
+
+unsigned int TransformSystem::GetCount()
+{
+    return m_scale.size();
+}
+
+TransformHandle TransformSystem::GetHandle(unsigned int index)
+{
+    return TransformHandle(this, index);
+}
+
+glm::vec3 TransformSystem::GetPosition(unsigned int index)
+{
+    return glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]);
+}
+
+glm::vec3 TransformSystem::GetRotation(unsigned int index)
+{
+    return glm::vec3(m_rotationX[index], m_rotationY[index], m_rotationZ[index]);
+}
+
+float TransformSystem::GetScale(unsigned int index)
+{
+    return m_scale[index];
+}
+
+void TransformSystem::SetPosition(unsigned int index, glm::vec3 position)
+{
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_positionZ[index] = position.z;
+    m_dirty[index] = 1;
+}
+
+void TransformSystem::SetRotation(unsigned int index, glm::vec3 rotation)
+{
+    m_rotationX[index] = rotation.x;
+    m_rotationY[index] = rotation.y;
+    m_rotationZ[index] = rotation.z;
+    m_dirty[index] = 1;
+}
+
+void TransformSystem::SetScale(unsigned int index, float scale)
+{
+    m_scale[index] = scale;
+    m_dirty[index] = 1;
+}
+
+void TransformSystem::RotateAllY(float r)
+{
+    // With one array per component, this is a single tight loop the compiler can vectorize.
+    for (unsigned int i = 0; i < m_rotationY.size(); i++)
+    {
+        m_rotationY[i] += r;
+    }
+    for (unsigned int i = 0; i < m_dirty.size(); i++)
+    {
+        m_dirty[i] = 1;
+    }
+}
+
+void TransformSystem::BuildRange(glm::mat4* output, unsigned int first, unsigned int count)
+{
+    unsigned int i = first;
+    unsigned int end = first + count;
+
+#ifdef TRANSFORM_SYSTEM_SSE
+    // Build four matrices at a time. Each register holds the same value for four different transforms.
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 sx, cx, sy, cy, sz, cz;
+        SinCos4(_mm_loadu_ps(&m_rotationX[i]), sx, cx);
+        SinCos4(_mm_loadu_ps(&m_rotationY[i]), sy, cy);
+        SinCos4(_mm_loadu_ps(&m_rotationZ[i]), sz, cz);
+        __m128 s = _mm_loadu_ps(&m_scale[i]);
+
+        // Shared terms of the rotation matrix (see ComposeMatrix).
+        __m128 sxsz = _mm_mul_ps(sx, sz);
+        __m128 sxcz = _mm_mul_ps(sx, cz);
+
+        __m128 m00 = _mm_mul_ps(s, _mm_sub_ps(_mm_mul_ps(cy, cz), _mm_mul_ps(sy, sxsz)));
+        __m128 m01 = _mm_mul_ps(s, _mm_mul_ps(cx, sz));
+        __m128 m02 = _mm_mul_ps(s, _mm_add_ps(_mm_mul_ps(sy, cz), _mm_mul_ps(cy, sxsz)));
+        __m128 m10 = _mm_mul_ps(s, _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(cy, sz), _mm_mul_ps(sy, sxcz))));
+        __m128 m11 = _mm_mul_ps(s, _mm_mul_ps(cx, cz));
+        __m128 m12 = _mm_mul_ps(s, _mm_sub_ps(_mm_mul_ps(cy, sxcz), _mm_mul_ps(sy, sz)));
+        __m128 m20 = _mm_mul_ps(s, _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sy, cx)));
+        __m128 m21 = _mm_mul_ps(s, _mm_sub_ps(_mm_setzero_ps(), sx));
+        __m128 m22 = _mm_mul_ps(s, _mm_mul_ps(cy, cx));
+        __m128 m30 = _mm_loadu_ps(&m_positionX[i]);
+        __m128 m31 = _mm_loadu_ps(&m_positionY[i]);
+        __m128 m32 = _mm_loadu_ps(&m_positionZ[i]);
+        __m128 column0 = _mm_setzero_ps();
+        __m128 column1 = _mm_setzero_ps();
+        __m128 column2 = _mm_setzero_ps();
+        __m128 column3 = _mm_set1_ps(1);
+
+        // Transpose so that each register holds one column of one matrix.
+        // Afterwards, m0x holds the columns of the first matrix, m1x the second, and so on, with the last matrix in columnx.
+        _MM_TRANSPOSE4_PS(m00, m01, m02, column0);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, column1);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, column2);
+        _MM_TRANSPOSE4_PS(m30, m31, m32, column3);
+
+        float* out = &output[i - first][0][0];
+        _mm_storeu_ps(out + 0, m00);      _mm_storeu_ps(out + 4, m10);      _mm_storeu_ps(out + 8, m20);      _mm_storeu_ps(out + 12, m30);
+        _mm_storeu_ps(out + 16, m01);     _mm_storeu_ps(out + 20, m11);     _mm_storeu_ps(out + 24, m21);     _mm_storeu_ps(out + 28, m31);
+        _mm_storeu_ps(out + 32, m02);     _mm_storeu_ps(out + 36, m12);     _mm_storeu_ps(out + 40, m22);     _mm_storeu_ps(out + 44, m32);
+        _mm_storeu_ps(out + 48, column0); _mm_storeu_ps(out + 52, column1); _mm_storeu_ps(out + 56, column2); _mm_storeu_ps(out + 60, column3);
+    }
+#endif
+
+    // Whatever is left over (or everything, without sse) is done one at a time.
+    for (; i < end; i++)
+    {
+        ComposeMatrix(output[i - first],
+            std::sin(m_rotationX[i]), std::cos(m_rotationX[i]),
+            std::sin(m_rotationY[i]), std::cos(m_rotationY[i]),
+            std::sin(m_rotationZ[i]), std::cos(m_rotationZ[i]),
+            m_scale[i], m_positionX[i], m_positionY[i], m_positionZ[i]);
+    }
+}
+
+void TransformSystem::BuildMatrices(glm::mat4* output, unsigned int first, unsigned int count)
+{
+    BuildRange(output + first, first, count);
+
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        m_dirty[i] = 0;
+    }
+}
+
+unsigned int TransformSystem::BuildDirtyMatrices(glm::mat4* output)
+{
+    unsigned int count = m_dirty.size();
+    unsigned int built = 0;
+
+    // Work in groups of four, matching the simd width. If anything in a group changed, rebuild the whole group.
+    for (unsigned int first = 0; first < count; first += 4)
+    {
+        unsigned int groupSize = count - first < 4 ? count - first : 4;
+
+        bool dirty = false;
+        for (unsigned int i = first; i < first + groupSize; i++)
+        {
+            dirty = dirty || m_dirty[i];
+        }
+
+        if (dirty)
+        {
+            BuildMatrices(output, first, groupSize);
+            built += groupSize;
+        }
+    }
+
+    return built;
+}
+
+glm::mat4 TransformSystem::GetMatrix(unsigned int index)
+{
+    glm::mat4 matrix;
+    BuildRange(&matrix, index, 1);
+    return matrix;
+}
+
+TransformHandle::TransformHandle(TransformSystem* system, unsigned int index)
+{
+    m_system = system;
+    m_index = index;
+}
+
+unsigned int TransformHandle::GetIndex()
+{
+    return m_index;
+}
+
+float TransformHandle::Scale()
+{
+    return m_system->GetScale(m_index);
+}
+
+glm::vec3 TransformHandle::Rotation()
+{
+    return m_system->GetRotation(m_index);
+}
+
+glm::vec3 TransformHandle::Position()
+{
+    return m_system->GetPosition(m_index);
+}
+
+void TransformHandle::SetScale(float s)
+{
+    m_system->SetScale(m_index, s);
+}
+
+void TransformHandle::SetRotation(glm::vec3 r)
+{
+    m_system->SetRotation(m_index, r);
+}
+
+void TransformHandle::SetPosition(glm::vec3 v)
+{
+    m_system->SetPosition(m_index, v);
+}
+
+void TransformHandle::RotateX(float r)
+{
+    m_system->SetRotation(m_index, m_system->GetRotation(m_index) + glm::vec3(r, 0, 0));
+}
+
+void TransformHandle::RotateY(float r)
+{
+    m_system->SetRotation(m_index, m_system->GetRotation(m_index) + glm::vec3(0, r, 0));
+}
+
+void TransformHandle::RotateZ(float r)
+{
+    m_system->SetRotation(m_index, m_system->GetRotation(m_index) + glm::vec3(0, 0, r));
+}
+
+void TransformHandle::Translate(glm::vec3 v)
+{
+    m_system->SetPosition(m_index, m_system->GetPosition(m_index) + v);
+}
+
+glm::mat4 TransformHandle::GetMatrix()
+{
+    return m_system->GetMatrix(m_index);
+}
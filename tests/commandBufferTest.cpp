@@ -0,0 +1,364 @@
+/*
+Title: Instanced Rendering
+File Name: commandBufferTest.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Records command buffers (some of them on several threads at once) and replays them into a backend that draws
+// nothing, but writes down what it would have drawn. No gpu or opengl context is needed.
+// Materials and meshes are never looked inside of while recording or replaying, so stand-in pointers do.
+
+#include "test.h"
+#include "../header/commandBuffer.h"
+#include <thread>
+#include <vector>
+
+// Stand-ins for real materials and meshes. Only their addresses are used.
+static char s_things[4];
+static Material* const MATERIAL_A = (Material*)&s_things[0];
+static Material* const MATERIAL_B = (Material*)&s_things[1];
+static Mesh* const MESH_A = (Mesh*)&s_things[2];
+static Mesh* const MESH_B = (Mesh*)&s_things[3];
+
+// Writes down every draw that would have been made.
+class RecordingBackend : public CommandBackend
+{
+public:
+    struct Draw
+    {
+        Material* m_material;
+        Mesh* m_mesh;
+        // Zero for a plain draw.
+        unsigned int m_instanceCount;
+        std::vector<float> m_instanceIds;
+    };
+
+    std::vector<Draw> m_draws;
+    Material* m_bound = nullptr;
+    // Set to false to act like a material whose program hasn't finished building.
+    bool m_materialsReady = true;
+
+protected:
+    virtual bool OnBindMaterial(Material* material)
+    {
+        m_bound = material;
+        return m_materialsReady;
+    }
+
+    virtual void OnDrawMesh(Mesh* mesh)
+    {
+        Draw draw;
+        draw.m_material = m_bound;
+        draw.m_mesh = mesh;
+        draw.m_instanceCount = 0;
+        m_draws.push_back(draw);
+    }
+
+    virtual void OnDrawInstanced(Mesh* mesh, const glm::mat4* matrices, unsigned int count)
+    {
+        Draw draw;
+        draw.m_material = m_bound;
+        draw.m_mesh = mesh;
+        draw.m_instanceCount = count;
+        // Each test matrix carries an id in its translation, to check nothing got lost or reordered.
+        for (unsigned int i = 0; i < count; i++)
+        {
+            draw.m_instanceIds.push_back(matrices[i][3][0]);
+        }
+        m_draws.push_back(draw);
+    }
+
+    virtual void OnDrawInstanced(Mesh* mesh, InstanceBuffer* instances)
+    {
+        Draw draw;
+        draw.m_material = m_bound;
+        draw.m_mesh = mesh;
+        // The instance buffer's slots aren't known here.
+        draw.m_instanceCount = 0;
+        m_draws.push_back(draw);
+    }
+};
+
+static glm::mat4 Instance(unsigned int id)
+{
+    glm::mat4 matrix;
+    matrix[3][0] = (float)id;
+    return matrix;
+}
+
+static void Replay(std::vector<CommandBuffer*>& buffers, CommandBackend& backend)
+{
+    for (unsigned int i = 0; i < buffers.size(); i++)
+    {
+        buffers[i]->Replay(backend);
+    }
+    backend.Flush();
+}
+
+// Like the demo's cull jobs: many threads each record a share of the same instanced draw.
+// Replayed together, that has to be a single draw holding every instance, in order.
+static void TestThreadsMergeIntoOneDraw()
+{
+    const unsigned int BUFFERS = 63;
+    const unsigned int INSTANCES_PER_BUFFER = 16;
+    std::vector<CommandBuffer*> buffers;
+    for (unsigned int i = 0; i < BUFFERS; i++)
+    {
+        buffers.push_back(new CommandBuffer());
+    }
+
+    // Each thread takes every fourth buffer.
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&buffers, t, INSTANCES_PER_BUFFER]()
+        {
+            for (unsigned int b = t; b < buffers.size(); b += 4)
+            {
+                std::vector<glm::mat4> instances;
+                for (unsigned int i = 0; i < INSTANCES_PER_BUFFER; i++)
+                {
+                    instances.push_back(Instance(b * INSTANCES_PER_BUFFER + i));
+                }
+                buffers[b]->BindMaterial(MATERIAL_A);
+                buffers[b]->SetInstances(instances);
+                buffers[b]->DrawInstanced(MESH_A);
+            }
+        }));
+    }
+    for (unsigned int t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+    }
+
+    RecordingBackend backend;
+    Replay(buffers, backend);
+
+    CHECK(backend.GetErrorCount() == 0);
+    CHECK(backend.GetCommandCount() == BUFFERS * 3);
+    CHECK(backend.GetMaterialChanges() == 1);
+    CHECK(backend.GetDrawCount() == 1);
+    CHECK(backend.m_draws.size() == 1);
+    if (backend.m_draws.size() == 1)
+    {
+        const RecordingBackend::Draw& draw = backend.m_draws[0];
+        CHECK(draw.m_material == MATERIAL_A);
+        CHECK(draw.m_mesh == MESH_A);
+        CHECK(draw.m_instanceCount == BUFFERS * INSTANCES_PER_BUFFER);
+        bool inOrder = true;
+        for (unsigned int i = 0; i < draw.m_instanceIds.size(); i++)
+        {
+            inOrder = inOrder && draw.m_instanceIds[i] == (float)i;
+        }
+        CHECK(inOrder);
+    }
+
+    for (unsigned int i = 0; i < buffers.size(); i++)
+    {
+        delete buffers[i];
+    }
+}
+
+// Changing the material or mesh, or a draw of another kind in between, ends a merge.
+static void TestMergesStopAtChanges()
+{
+    std::vector<glm::mat4> instances(3, Instance(0));
+    CommandBuffer buffer;
+    buffer.BindMaterial(MATERIAL_A);
+    buffer.SetInstances(instances);
+    buffer.DrawInstanced(MESH_A);
+    buffer.DrawInstanced(MESH_A);
+    buffer.DrawInstanced(MESH_B);
+    buffer.DrawMesh(MESH_A);
+    buffer.DrawInstanced(MESH_B);
+    buffer.BindMaterial(MATERIAL_B);
+    buffer.DrawInstanced(MESH_B);
+    // Setting no instances draws nothing, and doesn't split anything either.
+    buffer.SetInstances(instances.data(), 0);
+    buffer.DrawInstanced(MESH_B);
+
+    RecordingBackend backend;
+    buffer.Replay(backend);
+    backend.Flush();
+
+    CHECK(backend.GetErrorCount() == 0);
+    CHECK(backend.GetDrawCount() == 5);
+    CHECK(backend.m_draws.size() == 5);
+    if (backend.m_draws.size() == 5)
+    {
+        CHECK(backend.m_draws[0].m_mesh == MESH_A && backend.m_draws[0].m_instanceCount == 6);
+        CHECK(backend.m_draws[1].m_mesh == MESH_B && backend.m_draws[1].m_instanceCount == 3);
+        CHECK(backend.m_draws[2].m_mesh == MESH_A && backend.m_draws[2].m_instanceCount == 0);
+        CHECK(backend.m_draws[3].m_mesh == MESH_B && backend.m_draws[3].m_material == MATERIAL_A);
+        CHECK(backend.m_draws[4].m_mesh == MESH_B && backend.m_draws[4].m_material == MATERIAL_B);
+    }
+}
+
+// A material bound by someone else (like the render queue) isn't bound again.
+static void TestAlreadyBoundMaterial()
+{
+    std::vector<glm::mat4> instances(2, Instance(0));
+    CommandBuffer buffer;
+    buffer.BindMaterial(MATERIAL_A);
+    buffer.SetInstances(instances);
+    buffer.DrawInstanced(MESH_A);
+
+    RecordingBackend backend;
+    backend.SetBoundMaterial(MATERIAL_A, true);
+    buffer.Replay(backend);
+    backend.Flush();
+
+    CHECK(backend.m_bound == nullptr);
+    CHECK(backend.GetMaterialChanges() == 0);
+    CHECK(backend.GetDrawCount() == 1);
+    CHECK(backend.GetMaterial() == MATERIAL_A);
+}
+
+// Draws with a material that can't be used yet are dropped, not sent through.
+static void TestUnreadyMaterialSkipsDraws()
+{
+    std::vector<glm::mat4> instances(2, Instance(0));
+    CommandBuffer buffer;
+    buffer.BindMaterial(MATERIAL_A);
+    buffer.SetInstances(instances);
+    buffer.DrawInstanced(MESH_A);
+    buffer.DrawMesh(MESH_A);
+
+    RecordingBackend backend;
+    backend.m_materialsReady = false;
+    buffer.Replay(backend);
+    backend.Flush();
+
+    CHECK(backend.GetErrorCount() == 0);
+    CHECK(backend.GetDrawCount() == 0);
+    CHECK(backend.m_draws.empty());
+    CHECK(!backend.IsMaterialReady());
+}
+
+// Commands that don't make sense are counted as errors, and draw nothing.
+static void TestErrors()
+{
+    std::vector<glm::mat4> instances(2, Instance(0));
+    CommandBuffer buffer;
+    // No material yet.
+    buffer.DrawMesh(MESH_A);
+    buffer.BindMaterial(nullptr);
+    buffer.BindMaterial(MATERIAL_A);
+    // No instances yet.
+    buffer.DrawInstanced(MESH_A);
+    buffer.DrawMesh(nullptr);
+    buffer.DrawInstanced(MESH_A, nullptr);
+
+    std::cout << "(The errors printed next are expected.)" << std::endl;
+    RecordingBackend backend;
+    buffer.Replay(backend);
+    backend.Flush();
+
+    CHECK(backend.GetErrorCount() == 5);
+    CHECK(backend.GetDrawCount() == 0);
+    CHECK(backend.GetCommandCount() == 6);
+}
+
+// Instances set by one buffer aren't there for the next one. Each thread's buffer has to set its own,
+// and the last buffer's memory may already have been reset.
+static void TestInstancesDontLeakAcrossBuffers()
+{
+    std::vector<glm::mat4> instances(2, Instance(0));
+    std::vector<CommandBuffer*> buffers;
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        buffers.push_back(new CommandBuffer());
+        buffers[i]->BindMaterial(MATERIAL_A);
+    }
+    buffers[0]->SetInstances(instances);
+    buffers[0]->DrawInstanced(MESH_A);
+    // No instances set in this buffer.
+    buffers[1]->DrawInstanced(MESH_A);
+
+    std::cout << "(The error printed next is expected.)" << std::endl;
+    RecordingBackend backend;
+    Replay(buffers, backend);
+
+    CHECK(backend.GetErrorCount() == 1);
+    CHECK(backend.GetDrawCount() == 1);
+    CHECK(backend.m_draws.size() == 1 && backend.m_draws[0].m_instanceCount == 2);
+
+    for (unsigned int i = 0; i < buffers.size(); i++)
+    {
+        delete buffers[i];
+    }
+}
+
+// Recording more than fits in one chunk, including a single command bigger than a chunk, still replays everything.
+// Reset keeps the memory, but forgets the commands.
+static void TestChunksAndReset()
+{
+    CommandBuffer buffer;
+    RecordingBackend backend;
+    for (int frame = 0; frame < 2; frame++)
+    {
+        buffer.Reset();
+        CHECK(buffer.GetCommandCount() == 0);
+
+        buffer.BindMaterial(MATERIAL_A);
+        // 2000 matrices is 125kb, more than a chunk.
+        std::vector<glm::mat4> big;
+        for (unsigned int i = 0; i < 2000; i++)
+        {
+            big.push_back(Instance(i));
+        }
+        buffer.SetInstances(big);
+        buffer.DrawInstanced(MESH_A);
+        // Lots of small commands, spilling over into more chunks.
+        for (unsigned int i = 0; i < 5000; i++)
+        {
+            buffer.DrawMesh(MESH_B);
+        }
+
+        backend.Reset();
+        backend.m_draws.clear();
+        buffer.Replay(backend);
+        backend.Flush();
+
+        CHECK(buffer.GetCommandCount() == 5003);
+        CHECK(backend.GetCommandCount() == 5003);
+        CHECK(backend.GetErrorCount() == 0);
+        CHECK(backend.GetDrawCount() == 5001);
+        CHECK(!backend.m_draws.empty() && backend.m_draws[0].m_instanceCount == 2000);
+        CHECK(!backend.m_draws.empty() && backend.m_draws[0].m_instanceIds.back() == 1999.f);
+    }
+
+    buffer.Reset();
+    backend.Reset();
+    buffer.Replay(backend);
+    CHECK(backend.GetCommandCount() == 0);
+}
+
+int main(int argc, char **argv)
+{
+    TestThreadsMergeIntoOneDraw();
+    TestMergesStopAtChanges();
+    TestAlreadyBoundMaterial();
+    TestUnreadyMaterialSkipsDraws();
+    TestErrors();
+    TestInstancesDontLeakAcrossBuffers();
+    TestChunksAndReset();
+    return TestResult();
+}
@@ -0,0 +1,93 @@
+/*
+Title: Instanced Rendering
+File Name: instanceBufferTest.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Checks that instance buffer slots are handed out once each, however often they're removed.
+// Only the slot bookkeeping is tested, so nothing here needs a gl context (the gl buffers are made by the first Update).
+
+#include "test.h"
+#include "../header/instanceBuffer.h"
+#include <vector>
+
+static void TestSlotsAreReused()
+{
+    InstanceBuffer buffer;
+    unsigned int a = buffer.AddInstance(glm::mat4());
+    unsigned int b = buffer.AddInstance(glm::mat4());
+    unsigned int c = buffer.AddInstance(glm::mat4());
+    CHECK(a == 0 && b == 1 && c == 2);
+
+    // A freed slot is the next one handed out, instead of growing the buffer.
+    buffer.RemoveInstance(b);
+    CHECK(buffer.AddInstance(glm::mat4()) == b);
+    CHECK(buffer.GetCount() == 3);
+}
+
+static void TestDoubleRemove()
+{
+    InstanceBuffer buffer;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        buffer.AddInstance(glm::mat4());
+    }
+
+    // Removing a slot again, or one that was never handed out, does nothing.
+    buffer.RemoveInstance(1);
+    buffer.RemoveInstance(1);
+    buffer.RemoveInstance(7);
+
+    // So the next two instances get different slots: the free one, then a new one.
+    unsigned int first = buffer.AddInstance(glm::mat4());
+    unsigned int second = buffer.AddInstance(glm::mat4());
+    CHECK(first == 1);
+    CHECK(second == 3);
+    CHECK(buffer.GetCount() == 4);
+}
+
+static void TestTransformSlots()
+{
+    InstanceBuffer buffer;
+    std::vector<unsigned int> slots;
+    {
+        Transform3D transform;
+        unsigned int slot = buffer.AddInstance(&transform);
+
+        // Removing the slot by hand detaches the transform, so its destructor doesn't remove it a second time.
+        buffer.RemoveInstance(slot);
+        slots.push_back(slot);
+    }
+
+    Transform3D first;
+    Transform3D second;
+    slots.push_back(buffer.AddInstance(&first));
+    slots.push_back(buffer.AddInstance(&second));
+    CHECK(slots[1] == slots[0]);
+    CHECK(slots[2] != slots[1]);
+}
+
+int main(int argc, char **argv)
+{
+    TestSlotsAreReused();
+    TestDoubleRemove();
+    TestTransformSlots();
+    return TestResult();
+}
@@ -0,0 +1,236 @@
+/*
+Title: Instanced Rendering
+File Name: sceneGraphTest.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Checks the flattened scene graph against the obvious way of doing it: a tree of nodes, where each world matrix is
+// found by walking up to the root and multiplying local matrices on the way. Nodes are added, changed, moved to
+// other parents and removed at random, and after every update each world matrix has to match.
+
+#include "test.h"
+#include "../header/sceneGraph.h"
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+static const int STEPS = 5000;
+
+// The same tree, kept the simple way.
+struct ReferenceTree
+{
+    std::map<unsigned int, unsigned int> m_parents;
+    std::map<unsigned int, glm::mat4> m_locals;
+
+    glm::mat4 GetWorldMatrix(unsigned int node)
+    {
+        unsigned int parent = m_parents[node];
+        if (parent == SceneGraph::NO_NODE)
+        {
+            return m_locals[node];
+        }
+        return GetWorldMatrix(parent) * m_locals[node];
+    }
+
+    bool IsInSubtree(unsigned int node, unsigned int root)
+    {
+        for (; node != SceneGraph::NO_NODE; node = m_parents[node])
+        {
+            if (node == root)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Remove(unsigned int root)
+    {
+        std::vector<unsigned int> removed;
+        for (std::map<unsigned int, unsigned int>::iterator i = m_parents.begin(); i != m_parents.end(); ++i)
+        {
+            if (IsInSubtree(i->first, root))
+            {
+                removed.push_back(i->first);
+            }
+        }
+        for (unsigned int i = 0; i < removed.size(); i++)
+        {
+            m_parents.erase(removed[i]);
+            m_locals.erase(removed[i]);
+        }
+    }
+
+    std::vector<unsigned int> GetNodes()
+    {
+        std::vector<unsigned int> nodes;
+        for (std::map<unsigned int, unsigned int>::iterator i = m_parents.begin(); i != m_parents.end(); ++i)
+        {
+            nodes.push_back(i->first);
+        }
+        return nodes;
+    }
+};
+
+// A random rotation, scale and translation mixed together. Values stay small so long chains don't blow up.
+static glm::mat4 RandomMatrix()
+{
+    glm::mat4 matrix;
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            matrix[column][row] = (rand() % 200 - 100) / 100.f;
+        }
+    }
+    return matrix;
+}
+
+static bool Matches(const glm::mat4& a, const glm::mat4& b)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            if (std::fabs(a[column][row] - b[column][row]) > 1e-3f * (1 + std::fabs(b[column][row])))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Updates the graph, and compares every node with the reference.
+static void Compare(SceneGraph& graph, ReferenceTree& reference)
+{
+    graph.Update();
+    CHECK(graph.GetCount() == reference.m_parents.size());
+
+    int wrongParents = 0;
+    int wrongMatrices = 0;
+    std::vector<unsigned int> nodes = reference.GetNodes();
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        if (graph.GetParent(nodes[i]) != reference.m_parents[nodes[i]])
+        {
+            wrongParents++;
+        }
+        if (!Matches(graph.GetWorldMatrix(nodes[i]), reference.GetWorldMatrix(nodes[i])))
+        {
+            wrongMatrices++;
+        }
+    }
+    CHECK(wrongParents == 0);
+    CHECK(wrongMatrices == 0);
+}
+
+static void TestRandomChanges()
+{
+    srand(1);
+    SceneGraph graph;
+    ReferenceTree reference;
+
+    for (int step = 0; step < STEPS; step++)
+    {
+        std::vector<unsigned int> nodes = reference.GetNodes();
+        unsigned int node = nodes.empty() ? SceneGraph::NO_NODE : nodes[rand() % nodes.size()];
+        int change = rand() % 10;
+
+        if (change < 4 || nodes.empty())
+        {
+            // Add a node, usually under an existing one.
+            unsigned int parent = rand() % 4 == 0 ? SceneGraph::NO_NODE : node;
+            glm::mat4 local = RandomMatrix();
+            unsigned int id = graph.AddNode(parent, local);
+            CHECK(reference.m_parents.count(id) == 0);
+            reference.m_parents[id] = parent;
+            reference.m_locals[id] = local;
+        }
+        else if (change < 7)
+        {
+            glm::mat4 local = RandomMatrix();
+            graph.SetLocalMatrix(node, local);
+            reference.m_locals[node] = local;
+        }
+        else if (change < 8 && nodes.size() > 5)
+        {
+            graph.RemoveNode(node);
+            reference.Remove(node);
+        }
+        else
+        {
+            // Move it somewhere else, as long as that isn't under itself.
+            unsigned int parent = rand() % 5 == 0 ? SceneGraph::NO_NODE : nodes[rand() % nodes.size()];
+            if (!reference.IsInSubtree(parent, node))
+            {
+                graph.SetParent(node, parent);
+                reference.m_parents[node] = parent;
+            }
+        }
+
+        // Let a few changes pile up between updates, like a frame would.
+        if (step % 5 == 4)
+        {
+            Compare(graph, reference);
+        }
+    }
+    Compare(graph, reference);
+}
+
+// Changing one leaf should only update that leaf, and changing a parent should update its subtree and nothing else.
+static void TestOnlyChangedSubtreesUpdate()
+{
+    SceneGraph graph;
+    unsigned int root = graph.AddNode();
+    std::vector<unsigned int> groups;
+    std::vector<unsigned int> leaves;
+    for (int i = 0; i < 10; i++)
+    {
+        groups.push_back(graph.AddNode(root, RandomMatrix()));
+        for (int j = 0; j < 10; j++)
+        {
+            leaves.push_back(graph.AddNode(groups.back(), RandomMatrix()));
+        }
+    }
+    graph.Update();
+    CHECK(graph.GetNodesUpdated() == graph.GetCount());
+
+    graph.Update();
+    CHECK(graph.GetNodesUpdated() == 0);
+
+    graph.SetLocalMatrix(leaves[15], RandomMatrix());
+    graph.Update();
+    CHECK(graph.GetNodesUpdated() == 1);
+
+    glm::mat4 local = RandomMatrix();
+    graph.SetLocalMatrix(groups[3], local);
+    graph.Update();
+    CHECK(graph.GetNodesUpdated() == 11);
+    CHECK(Matches(graph.GetWorldMatrix(leaves[30]), local * graph.GetLocalMatrix(leaves[30])));
+}
+
+int main(int argc, char **argv)
+{
+    TestRandomChanges();
+    TestOnlyChangedSubtreesUpdate();
+    return TestResult();
+}
@@ -0,0 +1,183 @@
+/*
+Title: Instanced Rendering
+File Name: sortKeyTest.cpp
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+// Checks that render queue sort keys pack and unpack every field, and that sorting them (with the same radix sort
+// the render queue uses) puts draws in order of pass, then program, material, mesh, and finally depth.
+
+#include "test.h"
+#include "../header/sortKey.h"
+#include "../header/radixSort.h"
+#include "../header/jobSystem.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+static void TestFieldsRoundTrip()
+{
+    uint64_t key = SortKey::Make(3, 517, 9000, 4000, .5f, false);
+    CHECK(SortKey::GetPass(key) == 3);
+    CHECK(SortKey::GetProgram(key) == 517);
+    CHECK(SortKey::GetMaterial(key) == 9000);
+    CHECK(SortKey::GetMesh(key) == 4000);
+    CHECK(SortKey::GetDepth(key) == (unsigned int)(.5f * SortKey::Max(SortKey::DEPTH_BITS)));
+
+    // Every field at its largest value fills the whole key, without spilling into the next field.
+    uint64_t full = SortKey::Make(15, 1023, 16383, 4095, 1, false);
+    CHECK(full == ~(uint64_t)0);
+    CHECK(SortKey::Make(0, 0, 0, 0, 0, false) == 0);
+
+    // Fields next to each other don't bleed together.
+    CHECK(SortKey::GetMesh(SortKey::Make(0, 0, 0, 4095, 0, false)) == 4095);
+    CHECK(SortKey::GetMaterial(SortKey::Make(0, 0, 0, 4095, 1, false)) == 0);
+    CHECK(SortKey::GetPass(SortKey::Make(1, 1023, 16383, 4095, 1, false)) == 1);
+}
+
+static void TestClamping()
+{
+    // Ids that don't fit are clamped, instead of running into the field above.
+    uint64_t key = SortKey::Make(0, 5000, 0, 0, 0, false);
+    CHECK(SortKey::GetProgram(key) == 1023);
+    CHECK(SortKey::GetPass(key) == 0);
+
+    // Depth outside of 0 to 1 sorts as the nearest or furthest possible.
+    CHECK(SortKey::GetDepth(SortKey::Make(0, 0, 0, 0, -3, false)) == 0);
+    CHECK(SortKey::GetDepth(SortKey::Make(0, 0, 0, 0, 7, false)) == SortKey::Max(SortKey::DEPTH_BITS));
+}
+
+static void TestDepthOrder()
+{
+    // Near first normally, far first when blending.
+    CHECK(SortKey::Make(0, 1, 1, 1, .1f, false) < SortKey::Make(0, 1, 1, 1, .2f, false));
+    CHECK(SortKey::Make(2, 1, 1, 1, .1f, true) > SortKey::Make(2, 1, 1, 1, .2f, true));
+}
+
+// Every field has to outrank everything below it, however big the lower fields are.
+static void TestFieldPriority()
+{
+    CHECK(SortKey::Make(0, 1023, 16383, 4095, 1, false) < SortKey::Make(1, 0, 0, 0, 0, false));
+    CHECK(SortKey::Make(0, 1, 16383, 4095, 1, false) < SortKey::Make(0, 2, 0, 0, 0, false));
+    CHECK(SortKey::Make(0, 1, 1, 4095, 1, false) < SortKey::Make(0, 1, 2, 0, 0, false));
+    CHECK(SortKey::Make(0, 1, 1, 1, 1, false) < SortKey::Make(0, 1, 1, 2, 0, false));
+}
+
+// What a key stands for, to check the sorted order against.
+struct Draw
+{
+    unsigned int m_pass;
+    unsigned int m_program;
+    unsigned int m_material;
+    unsigned int m_mesh;
+    float m_depth;
+};
+
+static bool DrawsBefore(const Draw& a, const Draw& b)
+{
+    if (a.m_pass != b.m_pass) return a.m_pass < b.m_pass;
+    if (a.m_program != b.m_program) return a.m_program < b.m_program;
+    if (a.m_material != b.m_material) return a.m_material < b.m_material;
+    if (a.m_mesh != b.m_mesh) return a.m_mesh < b.m_mesh;
+    return a.m_depth < b.m_depth;
+}
+
+static void TestRadixSortOrder()
+{
+    srand(1);
+    std::vector<Draw> draws;
+    std::vector<uint64_t> keys;
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < 10000; i++)
+    {
+        // Small ranges, so plenty of draws share fields and the lower fields get to decide.
+        Draw draw;
+        draw.m_pass = rand() % 4;
+        draw.m_program = rand() % 8;
+        draw.m_material = rand() % 16;
+        draw.m_mesh = rand() % 16;
+        draw.m_depth = (rand() % 1000) / 1000.f;
+        draws.push_back(draw);
+        keys.push_back(SortKey::Make(draw.m_pass, draw.m_program, draw.m_material, draw.m_mesh, draw.m_depth, false));
+        order.push_back(i);
+    }
+
+    RadixSort(keys, order, 8);
+
+    int outOfOrder = 0;
+    int keysOutOfOrder = 0;
+    for (unsigned int i = 1; i < order.size(); i++)
+    {
+        if (DrawsBefore(draws[order[i]], draws[order[i - 1]])) outOfOrder++;
+        if (keys[i] < keys[i - 1]) keysOutOfOrder++;
+    }
+    CHECK(outOfOrder == 0);
+    CHECK(keysOutOfOrder == 0);
+
+    // Nothing lost or doubled up on the way.
+    std::sort(order.begin(), order.end());
+    bool everyDraw = true;
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        everyDraw = everyDraw && order[i] == i;
+    }
+    CHECK(everyDraw);
+}
+
+static void TestParallelRadixSort()
+{
+    // Big enough to be split across the job system's threads. It should come out exactly as the serial sort does,
+    // ties included, since the sort is stable either way.
+    srand(2);
+    std::vector<uint64_t> keys;
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < 100000; i++)
+    {
+        keys.push_back(((uint64_t)rand() << 32) | (rand() % 64));
+        order.push_back(i);
+    }
+    std::vector<uint64_t> parallelKeys = keys;
+    std::vector<unsigned int> parallelOrder = order;
+
+    RadixSort(keys, order, 8);
+    // Three workers, so the chunks really are spread out even on a machine with one core.
+    JobSystem jobs(3);
+    RadixSort(parallelKeys, parallelOrder, 8, &jobs);
+    // Sorting again reuses the same threads.
+    std::vector<uint64_t> againKeys = parallelKeys;
+    std::vector<unsigned int> againOrder = parallelOrder;
+    RadixSort(againKeys, againOrder, 8, &jobs);
+
+    CHECK(parallelKeys == keys);
+    CHECK(parallelOrder == order);
+    CHECK(againKeys == keys);
+    CHECK(againOrder == order);
+}
+
+int main(int argc, char **argv)
+{
+    TestFieldsRoundTrip();
+    TestClamping();
+    TestDepthOrder();
+    TestFieldPriority();
+    TestRadixSortOrder();
+    TestParallelRadixSort();
+    return TestResult();
+}
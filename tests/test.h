@@ -0,0 +1,51 @@
+/*
+Title: Instanced Rendering
+File Name: test.h
+Copyright ? 2016
+Author: David Erbelding
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <iostream>
+
+// Tests are small programs that return nonzero when something failed, so ctest can run them.
+// CHECK prints what failed and where, and keeps going so one run shows every failure.
+static int g_failures = 0;
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cout << __FILE__ << "(" << __LINE__ << "): Failed: " << #condition << std::endl; \
+            g_failures++; \
+        } \
+    } while (false)
+
+// Call at the end of main.
+static int TestResult()
+{
+    if (g_failures == 0)
+    {
+        std::cout << "Passed" << std::endl;
+        return 0;
+    }
+    std::cout << g_failures << " checks failed" << std::endl;
+    return 1;
+}